@@ -46,6 +46,27 @@ struct AppConfig {
         return url
     }
     
+    /// Per-source export checkpoints, so interrupted exports resume instead of restarting.
+    var exportCheckpointsDirectory: URL {
+        let url = appSupportDirectory.appendingPathComponent("ExportCheckpoints", isDirectory: true)
+        try? FileManager.default.createDirectory(at: url, withIntermediateDirectories: true)
+        return url
+    }
+    
+    /// Encoded GOPs shared by all exports, so re-exporting with a new trim only encodes what changed.
+    var encodedGopCacheDirectory: URL {
+        let url = appSupportDirectory.appendingPathComponent("EncodedGOPs", isDirectory: true)
+        try? FileManager.default.createDirectory(at: url, withIntermediateDirectories: true)
+        return url
+    }
+    
+    /// All-intra, low-resolution copies of imported videos used for scrubbing in the editor.
+    var scrubProxiesDirectory: URL {
+        let url = appSupportDirectory.appendingPathComponent("ScrubProxies", isDirectory: true)
+        try? FileManager.default.createDirectory(at: url, withIntermediateDirectories: true)
+        return url
+    }
+    
     var wallpapersDirectory: URL {
         let url = appSupportDirectory.appendingPathComponent("Wallpapers", isDirectory: true)
         try? FileManager.default.createDirectory(at: url, withIntermediateDirectories: true)
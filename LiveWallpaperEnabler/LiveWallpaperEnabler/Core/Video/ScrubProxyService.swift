@@ -0,0 +1,83 @@
+import Foundation
+import os
+@preconcurrency import WebMSupport
+
+/// Owns the all-intra scrubbing proxies. A proxy is named after the source's file
+/// identity, so editing or replacing the source orphans the old proxy instead of
+/// serving stale frames. Orphans and proxies of removed videos are evicted least
+/// recently used first once the directory grows past `capacityBytes`.
+actor ScrubProxyService {
+    static let shared = ScrubProxyService()
+    static let capacityBytes: Int64 = 2 << 30
+
+    private var pending: [URL: Task<URL?, Never>] = [:]
+
+    /// Returns the proxy for `sourceURL`, generating it first if needed. Nil if the
+    /// source can't be opened or generation fails.
+    func ensureProxy(for sourceURL: URL) async -> URL? {
+        if let task = pending[sourceURL] {
+            return await task.value
+        }
+        guard let proxyURL = proxyURL(for: sourceURL) else { return nil }
+        if FileManager.default.fileExists(atPath: proxyURL.path) {
+            // The modification date doubles as the last-use time for eviction
+            try? FileManager.default.setAttributes([.modificationDate: Date()], ofItemAtPath: proxyURL.path)
+            return proxyURL
+        }
+
+        let task = Task<URL?, Never> {
+            // Written under a temporary name so a half-written proxy is never picked up
+            let partialURL = proxyURL.deletingPathExtension().appendingPathExtension("partial.mov")
+            do {
+                Logger.video.info("Generating scrub proxy for \(sourceURL.lastPathComponent)")
+                try await VideoConverterService.shared.generateScrubProxy(inputURL: sourceURL, outputURL: partialURL)
+                try? FileManager.default.removeItem(at: proxyURL)
+                try FileManager.default.moveItem(at: partialURL, to: proxyURL)
+                return proxyURL
+            } catch {
+                Logger.video.error("Scrub proxy generation failed: \(error.localizedDescription)")
+                try? FileManager.default.removeItem(at: partialURL)
+                return nil
+            }
+        }
+        pending[sourceURL] = task
+        let result = await task.value
+        pending[sourceURL] = nil
+        if let result {
+            evict(keeping: result)
+        }
+        return result
+    }
+
+    /// Deletes the least recently used proxies until the directory fits `capacityBytes`.
+    /// Proxies still being written are left alone.
+    private func evict(keeping kept: URL) {
+        let keys: [URLResourceKey] = [.contentModificationDateKey, .totalFileAllocatedSizeKey]
+        guard let files = try? FileManager.default.contentsOfDirectory(
+            at: AppConfig.shared.scrubProxiesDirectory,
+            includingPropertiesForKeys: keys
+        ) else { return }
+
+        var proxies: [(url: URL, date: Date, size: Int64)] = []
+        var total: Int64 = 0
+        for file in files where !file.lastPathComponent.hasSuffix(".partial.mov") {
+            guard let values = try? file.resourceValues(forKeys: Set(keys)) else { continue }
+            let size = Int64(values.totalFileAllocatedSize ?? 0)
+            total += size
+            proxies.append((file, values.contentModificationDate ?? .distantPast, size))
+        }
+
+        for proxy in proxies.sorted(by: { $0.date < $1.date }) where total > Self.capacityBytes {
+            guard proxy.url.standardizedFileURL != kept.standardizedFileURL else { continue }
+            if (try? FileManager.default.removeItem(at: proxy.url)) != nil {
+                total -= proxy.size
+                Logger.video.info("Evicted scrub proxy \(proxy.url.lastPathComponent)")
+            }
+        }
+    }
+
+    private func proxyURL(for sourceURL: URL) -> URL? {
+        guard let identity = (try? FFmpegBridge(path: sourceURL.path))?.fileIdentity else { return nil }
+        return AppConfig.shared.scrubProxiesDirectory.appendingPathComponent("\(identity).mov")
+    }
+}
@@ -248,6 +248,7 @@ class VideoConverterService {
             DispatchQueue.global(qos: .userInitiated).async {
                 do {
                     let bridge = try FFmpegBridge(path: inputPath)
+                    bridge.decodeTier = .preview
                     
                     // Adjust endTime if it's virtually the full duration (FFmpeg behavior)
                     var adjustedEndTime = endTime
@@ -272,6 +273,102 @@ class VideoConverterService {
         progressHandler?(1.0)
     }
 
+    /// Same conversion as `convertToNativelyPlayable`, but starts while the source is still
+    /// downloading into `partialURL`. The input is treated as complete once the downloader
+    /// renames it to `finalURL`; until then reads wait for more data.
+    func convertGrowingDownloadToNativelyPlayable(partialURL: URL, finalURL: URL, outputURL: URL, progressHandler: (@Sendable (Double) -> Void)? = nil) async throws {
+        let remux = finalURL.pathExtension.lowercased() == "mp4"
+        let stopBox = BridgeStopBox()
+        
+        try await withTaskCancellationHandler {
+            try await withCheckedThrowingContinuation { (continuation: CheckedContinuation<Void, Error>) in
+                DispatchQueue.global(qos: .userInitiated).async {
+                    do {
+                        // Blocks until enough of the file has arrived to probe the streams.
+                        let bridge = try FFmpegBridge(growingPath: partialURL.path, completionMarker: finalURL.path)
+                        // A cancel that arrived during the probe had no bridge to stop.
+                        guard stopBox.attach(bridge) else { throw CancellationError() }
+                        let report: FFmpegBridge.ProgressBlock = { progress in
+                            // The operation clears the bridge's stop flag when it starts,
+                            // so a cancel racing its start is re-issued here.
+                            if stopBox.isCancelled {
+                                bridge.stop()
+                            }
+                            DispatchQueue.main.async {
+                                progressHandler?(progress)
+                            }
+                        }
+                        if remux {
+                            try bridge.remuxToMov(outputUrl: outputURL, startTime: 0, endTime: 0, progress: report)
+                        } else {
+                            bridge.decodeTier = .preview
+                            try bridge.prepareToMov(outputUrl: outputURL, startTime: 0, endTime: 0, progress: report)
+                        }
+                        continuation.resume()
+                    } catch {
+                        continuation.resume(throwing: error)
+                    }
+                }
+            }
+        } onCancel: {
+            stopBox.cancel()
+        }
+        progressHandler?(1.0)
+    }
+
+    /// Hands a task cancellation to a bridge that may not exist yet. Guarded by a lock,
+    /// since the cancel handler and the conversion run on different threads.
+    private final class BridgeStopBox: @unchecked Sendable {
+        private let lock = NSLock()
+        private var bridge: FFmpegBridge?
+        private var cancelled = false
+        
+        var isCancelled: Bool {
+            lock.lock(); defer { lock.unlock() }
+            return cancelled
+        }
+        
+        /// False if the task was cancelled before the bridge existed.
+        func attach(_ bridge: FFmpegBridge) -> Bool {
+            lock.lock(); defer { lock.unlock() }
+            self.bridge = bridge
+            return !cancelled
+        }
+        
+        func cancel() {
+            lock.lock()
+            cancelled = true
+            let bridge = self.bridge
+            lock.unlock()
+            bridge?.stop()
+        }
+    }
+
+    /// Writes an all-intra, reduced-resolution scrubbing proxy of `inputURL` using FFmpeg.
+    func generateScrubProxy(inputURL: URL, outputURL: URL, progressHandler: (@Sendable (Double) -> Void)? = nil) async throws {
+        let inputPath = inputURL.path
+        
+        try await withCheckedThrowingContinuation { (continuation: CheckedContinuation<Void, Error>) in
+            DispatchQueue.global(qos: .utility).async {
+                do {
+                    let bridge = try FFmpegBridge(path: inputPath)
+                    try bridge.generateProxy(outputUrl: outputURL) { progress in
+                        if Task.isCancelled {
+                            bridge.stop()
+                        }
+                        DispatchQueue.main.async {
+                            progressHandler?(progress)
+                        }
+                    }
+                    continuation.resume()
+                } catch {
+                    continuation.resume(throwing: error)
+                }
+            }
+        }
+        progressHandler?(1.0)
+    }
+
     /// Full Transcoding with x265 and specific live wallpaper parameters.
     private func applyGoldenFormula(inputURL: URL, outputURL: URL, timeRange: CMTimeRange? = nil, strategy: TranscodeStrategy, progressHandler: (@Sendable (Double) -> Void)? = nil) async throws {
         let inputPath = inputURL.path
@@ -285,6 +382,11 @@ class VideoConverterService {
             DispatchQueue.global(qos: .userInitiated).async {
                 do {
                     let bridge = try FFmpegBridge(path: inputPath)
+                    // Resumes from the last completed GOP if a previous export of this source was interrupted.
+                    bridge.checkpointDirectory = AppConfig.shared.exportCheckpointsDirectory
+                        .appendingPathComponent(inputURL.deletingPathExtension().lastPathComponent, isDirectory: true)
+                    // Re-exports with a different trim reuse the GOPs they share with earlier exports.
+                    bridge.gopCacheDirectory = AppConfig.shared.encodedGopCacheDirectory
                     
                     var adjustedEndTime = endTime
                     if adjustedEndTime > 0 && adjustedEndTime >= (bridge.duration - 0.1) {
@@ -295,7 +397,9 @@ class VideoConverterService {
                         startTime: startTime,
                         endTime: adjustedEndTime,
                         tonemap: tonemap,
-                        tenBit: tenBit
+                        tenBit: tenBit,
+                        dropDuplicateFrames: true,
+                        playbackBudget: true
                     )
                     
                     try bridge.exportToMov(outputUrl: outputURL, settings: settings) { progress in
@@ -306,6 +410,20 @@ class VideoConverterService {
                             progressHandler?(progress)
                         }
                     }
+                    if let stats = bridge.lastStats, stats.framesMerged > 0 {
+                        Logger.video.info("Merged \(stats.framesMerged) duplicate frames, encoded \(stats.framesEncoded)")
+                    }
+                    if let stats = bridge.lastStats, stats.gopsReused > 0 {
+                        Logger.video.info("Reused \(stats.gopsReused) cached GOPs, encoded \(stats.gopsEncoded)")
+                    }
+                    if let stats = bridge.lastStats, stats.playbackLevel > 0 {
+                        let level = "\(stats.playbackLevel / 10).\(stats.playbackLevel % 10)"
+                        if stats.vbvUnderflows > 0 {
+                            Logger.video.warning("Export exceeds its level \(level) VBV budget in \(stats.vbvUnderflows) frames (peak \(stats.peakBitrate) bit/s)")
+                        } else {
+                            Logger.video.info("Export fits level \(level): peak \(stats.peakBitrate) of \(stats.vbvMaxrate) bit/s")
+                        }
+                    }
                     continuation.resume()
                 } catch {
                     continuation.resume(throwing: error)
@@ -18,7 +18,19 @@ class VideoPlayerService: NSObject {
     }
     var playbackLimit: Double?
     
+    /// All-intra proxy of the loaded video (see ScrubProxyService), nil until one is attached.
+    private(set) var scrubProxyURL: URL?
+    private(set) var isScrubbing = false
+    
+    /// The player whose picture belongs on screen: the proxy while scrubbing, the source otherwise.
+    var displayPlayer: AVPlayer? {
+        isScrubbing ? (proxyPlayer ?? player) : player
+    }
+    
     private var displayLink: CADisplayLink?
+    private var proxyPlayer: AVPlayer?
+    private var loadedURL: URL?
+    private var scrubGeneration = 0
     
     override init() {
         super.init()
@@ -53,6 +65,10 @@ class VideoPlayerService: NSObject {
             self.timeScale = naturalTimeScale
             self.currentTime = 0
             self.player = AVPlayer(playerItem: item)
+            self.loadedURL = url
+            self.scrubProxyURL = nil
+            self.proxyPlayer = nil
+            self.isScrubbing = false
             
             NotificationCenter.default.addObserver(
                 forName: .AVPlayerItemDidPlayToEndTime,
@@ -89,11 +105,47 @@ class VideoPlayerService: NSObject {
         
         // Use natural timescale for seeking
         let cmTime = CMTime(seconds: time, preferredTimescale: self.timeScale)
+        if isScrubbing, let proxy = proxyPlayer {
+            proxy.seek(to: cmTime, toleranceBefore: .zero, toleranceAfter: .zero)
+            return
+        }
         player?.seek(to: cmTime, toleranceBefore: .zero, toleranceAfter: .zero)
     }
     
     var loopRange: Range<Double>?
     
+    /// Uses `proxyURL` for scrubbing if `sourceURL` is still the loaded video.
+    func attachScrubProxy(_ proxyURL: URL, for sourceURL: URL) {
+        guard sourceURL == loadedURL else { return }
+        let proxy = AVPlayer(url: proxyURL)
+        proxy.isMuted = true
+        scrubProxyURL = proxyURL
+        proxyPlayer = proxy
+    }
+    
+    /// While scrubbing, seeks go to the all-intra proxy (a single-frame decode each);
+    /// the source player catches up once, when scrubbing ends.
+    func beginScrubbing() {
+        guard proxyPlayer != nil else { return }
+        scrubGeneration += 1
+        isScrubbing = true
+        seek(to: currentTime)
+    }
+    
+    func endScrubbing() {
+        guard isScrubbing, let player = player else { return }
+        scrubGeneration += 1
+        let generation = scrubGeneration
+        let cmTime = CMTime(seconds: currentTime, preferredTimescale: self.timeScale)
+        // Keep showing the proxy until the source has landed on the same frame
+        player.seek(to: cmTime, toleranceBefore: .zero, toleranceAfter: .zero) { [weak self] _ in
+            DispatchQueue.main.async {
+                guard let self = self, self.scrubGeneration == generation else { return }
+                self.isScrubbing = false
+            }
+        }
+    }
+    
     private func setupDisplayLink() {
         displayLink?.invalidate()
         
@@ -104,7 +156,7 @@ class VideoPlayerService: NSObject {
     }
     
     @objc private func displayLinkDidTick() {
-        guard let player = player else { return }
+        guard let player = displayPlayer else { return }
         
         let newTime = player.currentTime().seconds
         guard newTime.isFinite else { return }
@@ -52,6 +52,11 @@ class AssetImportService {
                 self.state.status = "Finished"
             }
             
+            // 6. Build the scrubbing proxy in the background; the editor picks it up when ready
+            Task.detached(priority: .utility) {
+                _ = await ScrubProxyService.shared.ensureProxy(for: processedURL)
+            }
+            
         } catch {
             await MainActor.run {
                 self.state.error = error.localizedDescription
@@ -48,6 +48,42 @@ class YouTubeDownloadService {
         var lastPhase: String = ""
     }
     
+    /// Preview conversion started on the `.part` file while the download is still running.
+    /// Started from the download's progress callback and read by the download task and the
+    /// conversion's progress callback, so every field is guarded by a lock.
+    private final class StreamingPreview: @unchecked Sendable {
+        private let lock = NSLock()
+        private var _task: Task<Void, Error>?
+        private var _sourceURL: URL?
+        private var _progress: Double = 0
+        
+        var task: Task<Void, Error>? { lock.withLock { _task } }
+        var sourceURL: URL? { lock.withLock { _sourceURL } }
+        var isStarted: Bool { lock.withLock { _task != nil } }
+        var progress: Double {
+            get { lock.withLock { _progress } }
+            set { lock.withLock { _progress = newValue } }
+        }
+        
+        /// Runs `makeTask` unless a preview was already started.
+        func start(sourceURL: URL, _ makeTask: () -> Task<Void, Error>) {
+            lock.withLock {
+                guard _task == nil else { return }
+                _sourceURL = sourceURL
+                _task = makeTask()
+            }
+        }
+    }
+    
+    /// Bytes that must be on disk before the streaming preview opens the partial file,
+    /// so probing does not sit waiting on the first few packets.
+    private static let streamingPreviewThreshold: Int64 = 4 << 20
+    
+    private static func previewURL(for downloadedFile: URL) -> URL {
+        let previewFilename = downloadedFile.deletingPathExtension().lastPathComponent + "_preview.mp4"
+        return downloadedFile.deletingLastPathComponent().appendingPathComponent(previewFilename)
+    }
+    
     private func performDownload(
         ingredient: MediaIngredient,
         resolution: Int,
@@ -79,6 +115,8 @@ class YouTubeDownloadService {
             self.helperTaskIDs[id] = helperTaskID
         }
         
+        let streaming = StreamingPreview()
+        
         do {
             guard let webpageURL = URL(string: metadata.webpage_url) else {
                 throw YTDLPError.parsingFailed
@@ -101,8 +139,9 @@ class YouTubeDownloadService {
                 url: webpageURL,
                 formatID: formatSelector,
                 outputDirectory: taskFolder,
-                progressHandler: { [id, self, throttler] observation in
+                progressHandler: { [id, self, throttler, streaming] observation in
                     self.handleDownloadProgress(id: id, throttler: throttler, observation: observation)
+                    self.startStreamingPreviewIfReady(id: id, streaming: streaming, observation: observation)
                 }
             )
             
@@ -120,24 +159,43 @@ class YouTubeDownloadService {
             )
             let originalMeta = try? await VideoMetadataAnalyzer.analyze(url: downloadedFile)
             
-            await updateState(id, status: "Creating Preview...", phase: "preview", progress: 0.65)
-            let previewFilename = downloadedFile.deletingPathExtension().lastPathComponent + "_preview.mp4"
-            let previewURL = downloadedFile.deletingLastPathComponent().appendingPathComponent(previewFilename)
+            await updateState(id, status: "Creating Preview...", phase: "preview", progress: 0.65 + (streaming.progress * 0.25))
+            let previewURL = Self.previewURL(for: downloadedFile)
+            let previewFilename = previewURL.lastPathComponent
             
-            // Decide whether to use FFmpeg or native AVFoundation
-            let needsFFmpeg = originalMeta?.codec != "H.264" && originalMeta?.codec != "HEVC"
+            // Most of the preview is usually done by now if it was started on the partial file.
+            var streamedPreview = false
+            if let task = streaming.task {
+                if streaming.sourceURL?.standardizedFileURL == downloadedFile.standardizedFileURL {
+                    do {
+                        try await task.value
+                        streamedPreview = true
+                    } catch {
+                        try Task.checkCancellation()
+                        print("⚠️ Streaming preview failed, converting the finished download: \(error.localizedDescription)")
+                    }
+                } else {
+                    task.cancel()
+                    _ = try? await task.value
+                }
+            }
             
-            try await VideoConverterService.shared.convertToNativelyPlayable(
-                inputURL: downloadedFile,
-                outputURL: previewURL,
-                forceFFmpeg: needsFFmpeg
-            ) { progress in
-                Task { @MainActor in
-                    guard var state = self.downloadStates[id] else { return }
-                    state.phase = "preview"
-                    state.status = "Creating Preview..."
-                    state.progress = 0.65 + (progress * 0.25)
-                    self.downloadStates[id] = state
+            if !streamedPreview {
+                // Decide whether to use FFmpeg or native AVFoundation
+                let needsFFmpeg = originalMeta?.codec != "H.264" && originalMeta?.codec != "HEVC"
+                
+                try await VideoConverterService.shared.convertToNativelyPlayable(
+                    inputURL: downloadedFile,
+                    outputURL: previewURL,
+                    forceFFmpeg: needsFFmpeg
+                ) { progress in
+                    Task { @MainActor in
+                        guard var state = self.downloadStates[id] else { return }
+                        state.phase = "preview"
+                        state.status = "Creating Preview..."
+                        state.progress = 0.65 + (progress * 0.25)
+                        self.downloadStates[id] = state
+                    }
                 }
             }
             
@@ -178,6 +236,7 @@ class YouTubeDownloadService {
                 self.downloadStates.removeValue(forKey: id)
             }
         } catch {
+            streaming.task?.cancel()
             if Task.isCancelled {
                 _ = await MainActor.run {
                     self.downloadStates.removeValue(forKey: id)
@@ -343,6 +402,40 @@ class YouTubeDownloadService {
         }
     }
     
+    /// Starts converting the partial download once enough of it is on disk, so the preview
+    /// finishes shortly after the download instead of starting after it.
+    private func startStreamingPreviewIfReady(id: UUID, streaming: StreamingPreview, observation: YTDLPDownloadObservation) {
+        guard !streaming.isStarted,
+              observation.phase == "download",
+              observation.downloadedBytes >= Self.streamingPreviewThreshold,
+              observation.detail.hasPrefix("/") else { return }
+        
+        let finalURL = URL(fileURLWithPath: observation.detail)
+        guard ["webm", "mkv", "mp4"].contains(finalURL.pathExtension.lowercased()) else { return }
+        
+        // yt-dlp writes to "<filename>.part" and renames it when the download completes.
+        let partialURL = URL(fileURLWithPath: observation.detail + ".part")
+        guard FileManager.default.fileExists(atPath: partialURL.path) else { return }
+        
+        let outputURL = Self.previewURL(for: finalURL)
+        streaming.start(sourceURL: finalURL) {
+            Task.detached(priority: .userInitiated) { [streaming] in
+                try await VideoConverterService.shared.convertGrowingDownloadToNativelyPlayable(
+                    partialURL: partialURL,
+                    finalURL: finalURL,
+                    outputURL: outputURL
+                ) { progress in
+                    streaming.progress = progress
+                    Task { @MainActor in
+                        guard var state = self.downloadStates[id], state.phase == "preview" else { return }
+                        state.progress = 0.65 + (progress * 0.25)
+                        self.downloadStates[id] = state
+                    }
+                }
+            }
+        }
+    }
+    
     @MainActor
     private func updateDownloadState(id: UUID, observation: YTDLPDownloadObservation, progress: Double) {
         if var state = self.downloadStates[id] {
@@ -230,6 +230,13 @@ class MainViewModel {
                     // Trigger thumbnail generation automatically
                     ThumbnailManager.shared.generateFilmstripIfNeeded(for: url)
                 }
+                
+                // Scrub on the all-intra proxy once it exists (built here for videos imported before proxies)
+                if let proxyURL = await ScrubProxyService.shared.ensureProxy(for: url) {
+                    await MainActor.run {
+                        self.playerService.attachScrubProxy(proxyURL, for: url)
+                    }
+                }
             } catch {
                 Logger.video.error("Failed to load video metadata: \(error.localizedDescription)")
             }
@@ -13,6 +13,8 @@ struct EditorView: View {
                         if viewModel.isSideBySideActive, let url = viewModel.selectedVideoURL {
                             DualVideoComparisonView(
                                 url: url,
+                                scrubProxyURL: viewModel.playerService.scrubProxyURL,
+                                isScrubbing: viewModel.playerService.isScrubbing,
                                 startTime: $viewModel.startTime,
                                 endTime: $viewModel.endTime,
                                 videoSize: viewModel.playerService.videoSize,
@@ -21,7 +23,7 @@ struct EditorView: View {
                             )
                         } else {
                             Color.black
-                            if let player = viewModel.playerService.player {
+                            if let player = viewModel.playerService.displayPlayer {
                                 NativeVideoPlayer(player: player)
                                     .onAppear {
                                         viewModel.playerService.play()
@@ -247,6 +249,13 @@ struct EditorView: View {
                             if viewModel.playerService.isPlaying {
                                 viewModel.playerService.pause()
                             }
+                        },
+                        onScrubbingChanged: { scrubbing in
+                            if scrubbing {
+                                viewModel.playerService.beginScrubbing()
+                            } else {
+                                viewModel.playerService.endScrubbing()
+                            }
                         }
                     )
                     .onAppear {
@@ -3,6 +3,10 @@ import AVFoundation
 
 struct DualVideoComparisonView: View {
     let url: URL
+    /// All-intra proxy of `url`, shown only while `isScrubbing`; settled frames always come
+    /// from the source, since trim and loop points are judged by them.
+    let scrubProxyURL: URL?
+    let isScrubbing: Bool
     @Binding var startTime: Double
     @Binding var endTime: Double
     let videoSize: CGSize
@@ -11,6 +15,10 @@ struct DualVideoComparisonView: View {
     
     @State private var startPlayer = AVPlayer()
     @State private var endPlayer = AVPlayer()
+    @State private var startProxy = AVPlayer()
+    @State private var endProxy = AVPlayer()
+    @State private var showsProxy = false
+    @State private var scrubGeneration = 0
     
     var body: some View {
         GeometryReader { proxy in
@@ -20,7 +28,7 @@ struct DualVideoComparisonView: View {
             HStack(spacing: 0) {
                 // Left: Start Frame
                 ManualFitVideoPlayer(
-                    player: startPlayer,
+                    player: showsProxy ? startProxy : startPlayer,
                     label: "START",
                     time: startTime,
                     containerSize: CGSize(width: halfWidth, height: size.height),
@@ -28,12 +36,12 @@ struct DualVideoComparisonView: View {
                     fps: fps
                 )
                 .onChange(of: startTime) { _, newTime in
-                    seek(player: startPlayer, to: newTime)
+                    seek(player: showsProxy ? startProxy : startPlayer, to: newTime)
                 }
                 
                 // Right: End Frame
                 ManualFitVideoPlayer(
-                    player: endPlayer,
+                    player: showsProxy ? endProxy : endPlayer,
                     label: "END",
                     time: endTime,
                     containerSize: CGSize(width: halfWidth, height: size.height),
@@ -41,7 +49,7 @@ struct DualVideoComparisonView: View {
                     fps: fps
                 )
                 .onChange(of: endTime) { _, newTime in
-                    seek(player: endPlayer, to: newTime)
+                    seek(player: showsProxy ? endProxy : endPlayer, to: newTime)
                 }
             }
         }
@@ -49,26 +57,71 @@ struct DualVideoComparisonView: View {
         .onAppear {
             setupPlayers()
         }
+        .onChange(of: url) { _, _ in
+            setupPlayers()
+        }
+        .onChange(of: scrubProxyURL) { _, _ in
+            setupPlayers()
+        }
+        .onChange(of: isScrubbing) { _, scrubbing in
+            if scrubbing {
+                beginScrubbing()
+            } else {
+                endScrubbing()
+            }
+        }
         .onDisappear {
-            startPlayer.pause()
-            endPlayer.pause()
-            startPlayer.replaceCurrentItem(with: nil)
-            endPlayer.replaceCurrentItem(with: nil)
+            for player in [startPlayer, endPlayer, startProxy, endProxy] {
+                player.pause()
+                player.replaceCurrentItem(with: nil)
+            }
         }
     }
     
     private func setupPlayers() {
-        let startItem = AVPlayerItem(url: url)
-        let endItem = AVPlayerItem(url: url)
-        startPlayer.replaceCurrentItem(with: startItem)
-        endPlayer.replaceCurrentItem(with: endItem)
+        scrubGeneration += 1
+        showsProxy = false
+        startPlayer.replaceCurrentItem(with: AVPlayerItem(url: url))
+        endPlayer.replaceCurrentItem(with: AVPlayerItem(url: url))
+        startProxy.replaceCurrentItem(with: scrubProxyURL.map { AVPlayerItem(url: $0) })
+        endProxy.replaceCurrentItem(with: scrubProxyURL.map { AVPlayerItem(url: $0) })
         seek(player: startPlayer, to: startTime)
         seek(player: endPlayer, to: endTime)
     }
     
-    private func seek(player: AVPlayer, to time: Double) {
+    /// Same hand-off as `VideoPlayerService`: seeks go to the proxies while a handle is dragged.
+    private func beginScrubbing() {
+        guard scrubProxyURL != nil else { return }
+        scrubGeneration += 1
+        seek(player: startProxy, to: startTime)
+        seek(player: endProxy, to: endTime)
+        showsProxy = true
+    }
+    
+    /// Keeps showing the proxies until both source players have landed on their frames.
+    private func endScrubbing() {
+        guard showsProxy else { return }
+        scrubGeneration += 1
+        let generation = scrubGeneration
+        let landed = DispatchGroup()
+        landed.enter()
+        landed.enter()
+        seek(player: startPlayer, to: startTime) { _ in landed.leave() }
+        seek(player: endPlayer, to: endTime) { _ in landed.leave() }
+        landed.notify(queue: .main) {
+            if scrubGeneration == generation {
+                showsProxy = false
+            }
+        }
+    }
+    
+    private func seek(player: AVPlayer, to time: Double, completion: (@Sendable (Bool) -> Void)? = nil) {
         let cmTime = CMTime(seconds: time, preferredTimescale: timeScale)
-        player.seek(to: cmTime, toleranceBefore: .zero, toleranceAfter: .zero)
+        if let completion {
+            player.seek(to: cmTime, toleranceBefore: .zero, toleranceAfter: .zero, completionHandler: completion)
+        } else {
+            player.seek(to: cmTime, toleranceBefore: .zero, toleranceAfter: .zero)
+        }
     }
 }
 
@@ -82,6 +135,7 @@ struct ManualFitVideoPlayer: View {
     
     @State private var observedTime: Double = 0
     @State private var timeObserver: Any?
+    @State private var observedPlayer: AVPlayer?
     
     private var fittedRect: CGRect {
         guard videoSize.width > 0, videoSize.height > 0 else {
@@ -138,6 +192,11 @@ struct ManualFitVideoPlayer: View {
         .onDisappear {
             removeObserver()
         }
+        .onChange(of: player) { _, _ in
+            // The comparison view swaps in the scrub proxy while a handle is dragged
+            removeObserver()
+            setupObserver()
+        }
         .onChange(of: time) { _, _ in
             // Fallback: If player hasn't sought yet, improve responsiveness by pre-setting (optional, but good UX)
             // But user explicitly wanted PLAYER time. So let's stick to observer,
@@ -148,6 +207,7 @@ struct ManualFitVideoPlayer: View {
     
     private func setupObserver() {
         observedTime = player.currentTime().seconds
+        observedPlayer = player
         // Update frequently enough (e.g., 30fps checks) to catch seek completions
         timeObserver = player.addPeriodicTimeObserver(forInterval: CMTime(value: 1, timescale: 30), queue: .main) { cmTime in
             observedTime = cmTime.seconds
@@ -156,8 +216,9 @@ struct ManualFitVideoPlayer: View {
     
     private func removeObserver() {
         if let observer = timeObserver {
-            player.removeTimeObserver(observer)
+            observedPlayer?.removeTimeObserver(observer)
             timeObserver = nil
+            observedPlayer = nil
         }
     }
 }
@@ -11,6 +11,8 @@ struct FilmstripTimeline: View {
     let fps: Double
     
     var onSeek: ((Double) -> Void)?
+    /// True while the playhead or a range handle is being dragged.
+    var onScrubbingChanged: ((Bool) -> Void)?
     
     // Hoisted State for Tooltip Visibility
     @State private var isDraggingStart = false
@@ -112,6 +114,13 @@ struct FilmstripTimeline: View {
         }
         .frame(height: height)
         .padding(.horizontal)
+        .onChange(of: isInteracting) { _, interacting in
+            onScrubbingChanged?(interacting)
+        }
+    }
+    
+    private var isInteracting: Bool {
+        isScrubbing || isDraggingStart || isDraggingEnd || isDraggingRange
     }
     
     private func position(for time: Double, width: CGFloat) -> CGFloat {
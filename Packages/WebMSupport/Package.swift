@@ -51,6 +51,24 @@ let package = Package(
             swiftSettings: [
                 .interoperabilityMode(.Cxx)
             ]
+        ),
+        // C++ checks of the WebMSupportCpp helpers, exposed as C functions
+        // for the test target. They reach the target's internal headers.
+        .target(
+            name: "WebMSupportCppChecks",
+            dependencies: ["WebMSupportCpp"],
+            path: "Tests/WebMSupportCppChecks",
+            cSettings: [
+                .headerSearchPath("../../Sources/WebMSupportCpp"),
+                .headerSearchPath("../../Frameworks/FFmpeg/include")
+            ]
+        ),
+        .testTarget(
+            name: "WebMSupportTests",
+            dependencies: ["WebMSupport", "WebMSupportCppChecks"],
+            swiftSettings: [
+                .interoperabilityMode(.Cxx)
+            ]
         )
     ],
     cxxLanguageStandard: .cxx17
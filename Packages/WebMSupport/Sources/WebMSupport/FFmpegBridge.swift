@@ -17,6 +17,21 @@ public class FFmpegBridge: @unchecked Sendable {
         }
     }
     
+    /// Opens a file that is still being written (e.g. a download's `.part` file).
+    /// Reads wait for more data until `completionMarker` exists or `markInputComplete()`
+    /// is called, so this blocks until enough of the file has arrived to probe it.
+    public init(growingPath: String, completionMarker: String?) throws {
+        guard let ref = FFmpegWrapper_CreateGrowing(growingPath, completionMarker) else {
+            throw NSError(domain: "FFmpegBridge", code: 1, userInfo: [NSLocalizedDescriptionKey: "Failed to create FFmpeg wrapper"])
+        }
+        self.ref = ref
+        if !FFmpegWrapper_IsOpen(ref) {
+            FFmpegWrapper_Destroy(ref)
+            self.ref = nil
+            throw NSError(domain: "FFmpegBridge", code: 2, userInfo: [NSLocalizedDescriptionKey: "Failed to open growing video file at \(growingPath)"])
+        }
+    }
+    
     deinit {
         if let ref = ref {
             FFmpegWrapper_Destroy(ref)
@@ -42,6 +57,99 @@ public class FFmpegBridge: @unchecked Sendable {
         return "unknown"
     }
     
+    /// Identity of the opened file (device, inode, size, modification time).
+    /// Changes whenever the file is replaced or rewritten.
+    public var fileIdentity: String? {
+        guard let ref = ref else { return nil }
+        var buffer = [CChar](repeating: 0, count: 128)
+        guard FFmpegWrapper_GetFileIdentity(ref, &buffer, Int32(buffer.count)) else { return nil }
+        return String(cString: buffer)
+    }
+    
+    public enum DecodeTier: Sendable {
+        /// Bit-exact decoding.
+        case final
+        /// Skips non-reference frames, the loop filter and film grain synthesis for fast scrubbing.
+        case preview
+    }
+    
+    /// Decode tier for `prepareToMov` and sequential decoding. Seeking and exports always decode at `.final`.
+    public var decodeTier: DecodeTier = .final {
+        didSet {
+            guard let ref = ref else { return }
+            FFmpegWrapper_SetDecodeTier(ref, decodeTier == .preview ? FFmpegDecodeTierPreview : FFmpegDecodeTierFinal)
+        }
+    }
+    
+    public enum PreviewEngine: Sendable {
+        /// VideoToolbox, falling back to software when it is missing or rejects the stream.
+        case auto
+        /// `hevc_videotoolbox` at source resolution.
+        case hardware
+        /// x264 ultrafast/zerolatency, downscaled to 720p and capped at 30 fps.
+        case software
+    }
+    
+    /// Encoder used by `prepareToMov`. Forcing `.software` benchmarks the fallback on any machine.
+    public var previewEngine: PreviewEngine = .auto {
+        didSet {
+            guard let ref = ref else { return }
+            let engine: FFmpegPreviewEngine
+            switch previewEngine {
+            case .auto: engine = FFmpegPreviewEngineAuto
+            case .hardware: engine = FFmpegPreviewEngineHardware
+            case .software: engine = FFmpegPreviewEngineSoftware
+            }
+            FFmpegWrapper_SetPreviewEngine(ref, engine)
+        }
+    }
+    
+    /// A decoded picture. `planes` point into the decoder's memory and are only
+    /// valid until the next frame request on the same bridge.
+    public struct DecodedFrame {
+        public var planes: [UnsafePointer<UInt8>?]
+        public var strides: [Int]
+        public var width: Int
+        public var height: Int
+        /// `AVPixelFormat` raw value.
+        public var pixelFormat: Int32
+        public var timestamp: Double
+        public var isKeyframe: Bool
+        
+        init(_ raw: FFmpegVideoFrame) {
+            planes = [raw.planes.0, raw.planes.1, raw.planes.2, raw.planes.3]
+            strides = [Int(raw.strides.0), Int(raw.strides.1), Int(raw.strides.2), Int(raw.strides.3)]
+            width = Int(raw.width)
+            height = Int(raw.height)
+            pixelFormat = raw.pixelFormat
+            timestamp = Double(raw.timestampNs) / 1_000_000_000
+            isKeyframe = raw.isKey
+        }
+    }
+    
+    /// The frame on screen at `time`. Nearby and backward requests are served from a
+    /// cache of whole decoded GOPs instead of re-decoding from the last keyframe.
+    public func frame(at time: Double) -> DecodedFrame? {
+        guard let ref = ref else { return nil }
+        var raw = FFmpegVideoFrame()
+        guard FFmpegWrapper_FrameAt(ref, time, &raw) else { return nil }
+        return DecodedFrame(raw)
+    }
+    
+    /// Like `frame(at:)`, addressed by presentation timestamp in the stream's time base.
+    public func seekToFrame(pts: Int64) -> DecodedFrame? {
+        guard let ref = ref else { return nil }
+        var raw = FFmpegVideoFrame()
+        guard FFmpegWrapper_SeekToFrame(ref, pts, &raw) else { return nil }
+        return DecodedFrame(raw)
+    }
+    
+    /// Memory kept for decoded GOPs (default 256 MB). 0 disables the cache.
+    public func setFrameCacheCapacity(bytes: Int64) {
+        guard let ref = ref else { return }
+        FFmpegWrapper_SetFrameCacheCapacity(ref, bytes)
+    }
+    
     public typealias ProgressBlock = @Sendable (Double) -> Void
     
     public struct FFmpegTranscodeSettings {
@@ -49,15 +157,152 @@ public class FFmpegBridge: @unchecked Sendable {
         public var endTime: Double = 0.0
         public var tonemap: Bool = false
         public var tenBit: Bool = true
+        /// Upper bound for the transcode's memory use in bytes (0 = unbudgeted).
+        /// Decoder/encoder threading and lookahead are derived from it.
+        public var memoryBudgetBytes: Int64 = 0
+        /// Detects letterbox/pillarbox bars over the range and crops them away.
+        public var autoCrop: Bool = true
+        /// Folds frames that repeat the previous one into a longer sample duration.
+        public var dropDuplicateFrames: Bool = false
+        /// Scores every encoded frame (PSNR/SSIM) against the encoder input; see `frameQuality`.
+        public var measureQuality: Bool = false
+        /// Caps HEVC level and VBV by output size and frame rate so the wallpaper player
+        /// decodes the result cheaply; the peak bitrate is checked in `lastStats`.
+        public var playbackBudget: Bool = false
         
-        public init(startTime: Double = 0.0, endTime: Double = 0.0, tonemap: Bool = false, tenBit: Bool = true) {
+        public init(startTime: Double = 0.0, endTime: Double = 0.0, tonemap: Bool = false, tenBit: Bool = true, memoryBudgetBytes: Int64 = 0, autoCrop: Bool = true, dropDuplicateFrames: Bool = false, measureQuality: Bool = false, playbackBudget: Bool = false) {
             self.startTime = startTime
             self.endTime = endTime
             self.tonemap = tonemap
             self.tenBit = tenBit
+            self.memoryBudgetBytes = memoryBudgetBytes
+            self.autoCrop = autoCrop
+            self.dropDuplicateFrames = dropDuplicateFrames
+            self.measureQuality = measureQuality
+            self.playbackBudget = playbackBudget
         }
     }
     
+    public struct TranscodeStats: Sendable {
+        public var framesDecoded: Int64
+        public var framesEncoded: Int64
+        public var elapsedSeconds: Double
+        public var memoryBudgetBytes: Int64
+        public var estimatedMemoryBytes: Int64
+        /// Process footprint high-water mark during the transcode.
+        public var peakResidentBytes: Int64
+        /// Footprint growth attributable to the transcode.
+        public var peakMemoryBytes: Int64
+        public var decoderThreads: Int
+        public var encoderFrameThreads: Int
+        public var encoderRcLookahead: Int
+        public var encoderLookaheadSlices: Int
+        public var filterThreads: Int
+        /// Region kept by auto-crop, in source pixels; nil when nothing was cropped.
+        public var crop: CGRect?
+        /// Repeated frames merged into the previous frame instead of being encoded.
+        public var framesMerged: Int64
+        /// Encoded GOP cache units reused from earlier exports, and encoded by this one.
+        public var gopsReused: Int
+        public var gopsEncoded: Int
+        /// `prepareToMov` encoded with the software preview engine.
+        public var softwarePreview: Bool
+        /// Quality meter summary (luma); zero frames when it was off.
+        public var framesMeasured: Int64
+        public var meanPsnr: Double
+        public var meanSsim: Double
+        public var minSsim: Double
+        /// `concatToMov`: clips stream-copied and clips re-encoded to fit the copied ones.
+        public var clipsCopied: Int
+        public var clipsReencoded: Int
+        /// `loopSeamToMov`: frames crossfaded at the seam, and seconds stream-copied around it.
+        public var seamFramesBlended: Int
+        public var seamSecondsCopied: Double
+        /// `reverseToMov`: GOPs that went through the lossless spill file, and the most
+        /// decoded picture bytes held at once.
+        public var reverseGopsSpilled: Int
+        public var reversePeakBufferedBytes: Int64
+        /// Most bits in any one second of output (bits/s).
+        public var peakBitrate: Int64
+        /// Playback budget: HEVC level x 10 (0 when off), VBV cap in bits/s, frames that
+        /// would have drained the VBV buffer, and the share of the level's capacity used.
+        public var playbackLevel: Int
+        public var vbvMaxrate: Int64
+        public var vbvUnderflows: Int
+        public var decodeLoad: Double
+        /// Frames of a 4:4:4, 4:2:2 or RGB source converted to 10-bit 4:2:0 by the
+        /// chroma fast path instead of the filter graph.
+        public var framesChromaConverted: Int64
+    }
+    
+    public struct FrameQuality: Sendable {
+        /// Source time in seconds.
+        public var time: Double
+        public var psnr: Double
+        public var ssim: Double
+    }
+    
+    /// Per-frame scores of the last export run with `measureQuality`.
+    public var frameQuality: [FrameQuality] {
+        guard let ref = ref else { return [] }
+        let count = Int(FFmpegWrapper_GetFrameQuality(ref, nil, 0))
+        guard count > 0 else { return [] }
+        var raw = [FFmpegFrameQuality](repeating: FFmpegFrameQuality(), count: count)
+        let copied = Int(FFmpegWrapper_GetFrameQuality(ref, &raw, Int32(count)))
+        return raw.prefix(min(copied, count)).map { FrameQuality(time: $0.time, psnr: $0.psnr, ssim: $0.ssim) }
+    }
+    
+    /// Statistics of the most recent prepare/export/remux call.
+    public var lastStats: TranscodeStats? {
+        guard let ref = ref else { return nil }
+        var raw = FFmpegTranscodeStats()
+        guard FFmpegWrapper_GetLastStats(ref, &raw) else { return nil }
+        return TranscodeStats(
+            framesDecoded: raw.framesDecoded,
+            framesEncoded: raw.framesEncoded,
+            elapsedSeconds: raw.elapsedSeconds,
+            memoryBudgetBytes: raw.memoryBudgetBytes,
+            estimatedMemoryBytes: raw.estimatedMemoryBytes,
+            peakResidentBytes: raw.peakResidentBytes,
+            peakMemoryBytes: raw.peakMemoryBytes,
+            decoderThreads: Int(raw.decoderThreads),
+            encoderFrameThreads: Int(raw.encoderFrameThreads),
+            encoderRcLookahead: Int(raw.encoderRcLookahead),
+            encoderLookaheadSlices: Int(raw.encoderLookaheadSlices),
+            filterThreads: Int(raw.filterThreads),
+            crop: raw.cropWidth > 0 ? CGRect(x: Int(raw.cropX), y: Int(raw.cropY), width: Int(raw.cropWidth), height: Int(raw.cropHeight)) : nil,
+            framesMerged: raw.framesMerged,
+            gopsReused: Int(raw.gopsReused),
+            gopsEncoded: Int(raw.gopsEncoded),
+            softwarePreview: raw.softwarePreview,
+            framesMeasured: raw.framesMeasured,
+            meanPsnr: raw.meanPsnr,
+            meanSsim: raw.meanSsim,
+            minSsim: raw.minSsim,
+            clipsCopied: Int(raw.clipsCopied),
+            clipsReencoded: Int(raw.clipsReencoded),
+            seamFramesBlended: Int(raw.seamFramesBlended),
+            seamSecondsCopied: raw.seamSecondsCopied,
+            reverseGopsSpilled: Int(raw.reverseGopsSpilled),
+            reversePeakBufferedBytes: raw.reversePeakBufferedBytes,
+            peakBitrate: raw.peakBitrate,
+            playbackLevel: Int(raw.playbackLevel),
+            vbvMaxrate: raw.vbvMaxrate,
+            vbvUnderflows: Int(raw.vbvUnderflows),
+            decodeLoad: raw.decodeLoad,
+            framesChromaConverted: raw.framesChromaConverted
+        )
+    }
+    
+    /// Content rectangle (in source pixels) over the given range, sampled from a
+    /// few frames. Returns nil when the picture has no bars.
+    public func detectCrop(startTime: Double = 0.0, endTime: Double = 0.0) -> CGRect? {
+        guard let ref = ref else { return nil }
+        var raw = FFmpegCropRect()
+        guard FFmpegWrapper_DetectCrop(ref, startTime, endTime, &raw) else { return nil }
+        return CGRect(x: Int(raw.x), y: Int(raw.y), width: Int(raw.width), height: Int(raw.height))
+    }
+    
     public func prepareToMov(outputUrl: URL, startTime: Double = 0.0, endTime: Double = 0.0, progress: ProgressBlock? = nil) throws {
         guard let ref = ref else { return }
         
@@ -82,6 +327,12 @@ public class FFmpegBridge: @unchecked Sendable {
     public func exportToMov(outputUrl: URL, settings: FFmpegTranscodeSettings, progress: ProgressBlock? = nil) throws {
         guard let ref = ref else { return }
         
+        FFmpegWrapper_SetMemoryBudget(ref, settings.memoryBudgetBytes)
+        FFmpegWrapper_SetAutoCrop(ref, settings.autoCrop)
+        FFmpegWrapper_SetDropDuplicates(ref, settings.dropDuplicateFrames)
+        FFmpegWrapper_SetMeasureQuality(ref, settings.measureQuality)
+        FFmpegWrapper_SetPlaybackBudget(ref, settings.playbackBudget)
+        
         let handlerBox = progress.map { Box($0) }
         let userData = handlerBox.map { Unmanaged.passRetained($0).toOpaque() }
         
@@ -128,11 +379,187 @@ public class FFmpegBridge: @unchecked Sendable {
             throw NSError(domain: "FFmpegBridge", code: 5, userInfo: [NSLocalizedDescriptionKey: "Remux failed"])
         }
     }
+    
+    /// Joins this file and `nextClips` into one HEVC MOV that loops as a single wallpaper.
+    /// Clips sharing identical stream parameters are stream-copied; the rest are re-encoded
+    /// to their frame size and rate first.
+    public func concatToMov(nextClips: [URL], outputUrl: URL, progress: ProgressBlock? = nil) throws {
+        guard let ref = self.ref else { return }
+        
+        let handlerBox = progress.map { Box($0) }
+        let userData = handlerBox.map { Unmanaged.passRetained($0).toOpaque() }
+        
+        let paths = nextClips.map { strdup($0.path) }
+        defer { paths.forEach { free($0) } }
+        let cPaths = paths.map { UnsafePointer<CChar>($0) }
+        
+        let success = cPaths.withUnsafeBufferPointer { buffer in
+            FFmpegWrapper_ConcatToMov(ref, buffer.baseAddress, Int32(buffer.count), outputUrl.path, { p, userData in
+                guard let userData = userData else { return }
+                let box = Unmanaged<Box<ProgressBlock>>.fromOpaque(userData).takeUnretainedValue()
+                box.value(p)
+            }, userData)
+        }
+        
+        if let userData = userData {
+            Unmanaged<Box<ProgressBlock>>.fromOpaque(userData).release()
+        }
+        
+        if !success {
+            throw NSError(domain: "FFmpegBridge", code: 7, userInfo: [NSLocalizedDescriptionKey: "Concatenation failed"])
+        }
+    }
+    
+    /// Writes a copy that loops without a visible jump: the last `blendFrames` frames
+    /// crossfade into the first ones, which are then dropped from the start. When this
+    /// file is a previous export, only the GOPs at either end are re-encoded.
+    public func loopSeamToMov(outputUrl: URL, blendFrames: Int = 15, progress: ProgressBlock? = nil) throws {
+        guard let ref = self.ref else { return }
+        
+        let handlerBox = progress.map { Box($0) }
+        let userData = handlerBox.map { Unmanaged.passRetained($0).toOpaque() }
+        
+        let success = FFmpegWrapper_LoopSeamToMov(ref, outputUrl.path, Int32(blendFrames), { p, userData in
+            guard let userData = userData else { return }
+            let box = Unmanaged<Box<ProgressBlock>>.fromOpaque(userData).takeUnretainedValue()
+            box.value(p)
+        }, userData)
+        
+        if let userData = userData {
+            Unmanaged<Box<ProgressBlock>>.fromOpaque(userData).release()
+        }
+        
+        if !success {
+            throw NSError(domain: "FFmpegBridge", code: 8, userInfo: [NSLocalizedDescriptionKey: "Loop seam failed"])
+        }
+    }
+    
+    /// Exports the range played backwards, or forwards then backwards (`boomerang`) so it
+    /// loops as a ping-pong. Memory stays at a few GOPs regardless of the clip's length.
+    public func reverseToMov(outputUrl: URL, startTime: Double = 0.0, endTime: Double = 0.0, boomerang: Bool = true, progress: ProgressBlock? = nil) throws {
+        guard let ref = self.ref else { return }
+        
+        let handlerBox = progress.map { Box($0) }
+        let userData = handlerBox.map { Unmanaged.passRetained($0).toOpaque() }
+        
+        let success = FFmpegWrapper_ReverseToMov(ref, outputUrl.path, startTime, endTime, boomerang, { p, userData in
+            guard let userData = userData else { return }
+            let box = Unmanaged<Box<ProgressBlock>>.fromOpaque(userData).takeUnretainedValue()
+            box.value(p)
+        }, userData)
+        
+        if let userData = userData {
+            Unmanaged<Box<ProgressBlock>>.fromOpaque(userData).release()
+        }
+        
+        if !success {
+            throw NSError(domain: "FFmpegBridge", code: 9, userInfo: [NSLocalizedDescriptionKey: "Reverse export failed"])
+        }
+    }
+
+    /// Writes an all-intra, reduced-height H.264 copy on the source's timeline.
+    /// Every frame is a keyframe, so seeking it decodes a single frame.
+    public func generateProxy(outputUrl: URL, targetHeight: Int = 540, progress: ProgressBlock? = nil) throws {
+        guard let ref = self.ref else { return }
+        
+        let handlerBox = progress.map { Box($0) }
+        let userData = handlerBox.map { Unmanaged.passRetained($0).toOpaque() }
+        
+        let success = FFmpegWrapper_GenerateProxy(ref, outputUrl.path, Int32(targetHeight), { p, userData in
+            guard let userData = userData else { return }
+            let box = Unmanaged<Box<ProgressBlock>>.fromOpaque(userData).takeUnretainedValue()
+            box.value(p)
+        }, userData)
+        
+        if let userData = userData {
+            Unmanaged<Box<ProgressBlock>>.fromOpaque(userData).release()
+        }
+        
+        if !success {
+            throw NSError(domain: "FFmpegBridge", code: 6, userInfo: [NSLocalizedDescriptionKey: "Proxy generation failed"])
+        }
+    }
+
+    /// Publishes every picture a transcode feeds its encoder to `ring`, so another
+    /// process can show a live preview. The bridge keeps the ring alive; pass nil to stop.
+    public var previewRing: SharedFrameRing? {
+        didSet {
+            guard let ref = self.ref else { return }
+            FFmpegWrapper_SetPreviewRing(ref, previewRing?.ref)
+        }
+    }
 
     public func stop() {
         guard let ref = self.ref else { return }
         FFmpegWrapper_Stop(ref)
     }
+
+    /// Tells a growing input that the writer is done, so reaching the end of the
+    /// file is EOF rather than a wait for more data.
+    public func markInputComplete() {
+        guard let ref = self.ref else { return }
+        FFmpegWrapper_MarkInputComplete(ref)
+    }
+
+    /// Suspends a running transcode between frames; decoder and encoder stay alive.
+    public func pause() {
+        guard let ref = self.ref else { return }
+        FFmpegWrapper_Pause(ref)
+    }
+
+    public func resume() {
+        guard let ref = self.ref else { return }
+        FFmpegWrapper_Resume(ref)
+    }
+
+    /// When set, `exportToMov` checkpoints each closed GOP here and resumes from the
+    /// last completed one if an earlier export of the same source was interrupted.
+    public var checkpointDirectory: URL? {
+        didSet {
+            guard let ref = self.ref else { return }
+            if let path = checkpointDirectory?.path {
+                FFmpegWrapper_SetCheckpointDirectory(ref, path)
+            } else {
+                FFmpegWrapper_SetCheckpointDirectory(ref, nil)
+            }
+        }
+    }
+
+    public func discardCheckpoint() {
+        guard let ref = self.ref else { return }
+        FFmpegWrapper_DiscardCheckpoint(ref)
+    }
+
+    /// When set, every prepare/export/remux writes a per-frame timeline of its stages
+    /// (read, decode, filter, encode, write, flush) here as Chrome trace-event JSON when
+    /// it finishes. Open it in chrome://tracing or Perfetto; each run replaces the file.
+    public var traceFile: URL? {
+        didSet {
+            guard let ref = self.ref else { return }
+            FFmpegWrapper_SetTraceFile(ref, traceFile?.path)
+        }
+    }
+
+    /// When set, `exportToMov` stores every encoded source GOP here, and re-exports of
+    /// the same source and settings only encode the GOPs a new trim doesn't fully reuse.
+    /// Takes over from `checkpointDirectory`: units finished before a cancel are kept.
+    public var gopCacheDirectory: URL? {
+        didSet { applyGopCache() }
+    }
+
+    /// Least recently used GOPs beyond this size are evicted after each export (0 = unbounded).
+    public var gopCacheCapacityBytes: Int64 = 4 << 30 {
+        didSet { applyGopCache() }
+    }
+
+    private func applyGopCache() {
+        guard let ref = self.ref else { return }
+        if let path = gopCacheDirectory?.path {
+            FFmpegWrapper_SetGopCacheDirectory(ref, path, gopCacheCapacityBytes)
+        } else {
+            FFmpegWrapper_SetGopCacheDirectory(ref, nil, 0)
+        }
+    }
 }
 
 // Helper box to wrap non-bit-pattern closure for Unmanaged
@@ -0,0 +1,91 @@
+import Foundation
+import WebMSupportCpp
+
+/// Shared-memory ring of video frames between two processes (one producer, one
+/// consumer). The producer copies each picture in once; the consumer reads it in
+/// place. Pass `fileHandle` over XPC to let the other process attach.
+public final class SharedFrameRing: @unchecked Sendable {
+    let ref: SharedFrameRingRef
+
+    /// Creates a ring as producer. Without a name the memory is anonymous and only
+    /// reachable through `fileHandle`; sandboxed apps naming it must prefix the app group.
+    public init(name: String? = nil, slotCount: Int = 4, slotBytes: Int) throws {
+        let created: SharedFrameRingRef?
+        if let name = name {
+            created = SharedFrameRing_Create(name, UInt32(slotCount), UInt64(slotBytes))
+        } else {
+            created = SharedFrameRing_Create(nil, UInt32(slotCount), UInt64(slotBytes))
+        }
+        guard let ref = created else {
+            throw NSError(domain: "SharedFrameRing", code: 1, userInfo: [NSLocalizedDescriptionKey: "Failed to create shared frame ring"])
+        }
+        self.ref = ref
+    }
+
+    /// Attaches as consumer to a ring received from the producer.
+    public init(fileHandle: FileHandle) throws {
+        guard let ref = SharedFrameRing_Attach(fileHandle.fileDescriptor) else {
+            throw NSError(domain: "SharedFrameRing", code: 2, userInfo: [NSLocalizedDescriptionKey: "Not a shared frame ring"])
+        }
+        self.ref = ref
+    }
+
+    /// Attaches as consumer to a named ring.
+    public init(name: String) throws {
+        guard let ref = SharedFrameRing_Open(name) else {
+            throw NSError(domain: "SharedFrameRing", code: 2, userInfo: [NSLocalizedDescriptionKey: "No shared frame ring named \(name)"])
+        }
+        self.ref = ref
+    }
+
+    deinit {
+        SharedFrameRing_Destroy(ref)
+    }
+
+    /// Descriptor of the mapping, for handing to the consumer process.
+    public var fileHandle: FileHandle {
+        FileHandle(fileDescriptor: SharedFrameRing_GetFileDescriptor(ref), closeOnDealloc: false)
+    }
+
+    public var isClosed: Bool { SharedFrameRing_IsClosed(ref) }
+    public var droppedFrames: UInt64 { SharedFrameRing_GetDroppedFrames(ref) }
+
+    /// Producer: marks the stream finished.
+    public func close() {
+        SharedFrameRing_Close(ref)
+    }
+
+    /// A frame inside the shared mapping.
+    public struct Frame {
+        public var planes: [UnsafePointer<UInt8>?]
+        public var strides: [Int]
+        public var rows: [Int]
+        public var width: Int
+        public var height: Int
+        /// `AVPixelFormat` raw value.
+        public var pixelFormat: Int32
+        public var timestamp: Double
+        public var frameNumber: UInt64
+    }
+
+    /// Consumer: runs `body` on the newest unseen frame while it is fenced against
+    /// overwrite. The planes must not escape `body`. Returns false if there was no
+    /// new frame or it was torn (only possible if the producer restarted).
+    @discardableResult
+    public func withLatestFrame(_ body: (Frame) -> Void) -> Bool {
+        var raw = SharedFrame()
+        guard SharedFrameRing_AcquireLatest(ref, &raw) else { return false }
+        let frame = Frame(
+            planes: [raw.planes.0, raw.planes.1, raw.planes.2, raw.planes.3],
+            strides: [Int(raw.strides.0), Int(raw.strides.1), Int(raw.strides.2), Int(raw.strides.3)],
+            rows: [Int(raw.rows.0), Int(raw.rows.1), Int(raw.rows.2), Int(raw.rows.3)],
+            width: Int(raw.width),
+            height: Int(raw.height),
+            pixelFormat: raw.pixelFormat,
+            timestamp: Double(raw.timestampNs) / 1_000_000_000,
+            frameNumber: raw.frameNumber
+        )
+        body(frame)
+        return SharedFrameRing_Release(ref, &raw)
+    }
+}
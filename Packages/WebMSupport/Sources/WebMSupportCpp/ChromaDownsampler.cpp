@@ -0,0 +1,319 @@
+#include "ChromaDownsampler.hpp"
+#include "PixelKernels.hpp"
+#include "TraceRecorder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixdesc.h>
+}
+
+static const uint16_t kMax10 = 1023;
+// RGB goes through the matrix at this depth before the dithered drop to 10.
+static const int kRgbDepth = 12;
+
+static const uint8_t kBayer8[8][8] = {
+    {0, 32, 8, 40, 2, 34, 10, 42},  {48, 16, 56, 24, 50, 18, 58, 26},
+    {12, 44, 4, 36, 14, 46, 6, 38}, {60, 28, 52, 20, 62, 30, 54, 22},
+    {3, 35, 11, 43, 1, 33, 9, 41},  {51, 19, 59, 27, 49, 17, 57, 25},
+    {15, 47, 7, 39, 13, 45, 5, 37}, {63, 31, 55, 23, 61, 29, 53, 21}};
+
+// Full-range 8-bit RGB to limited-range 12-bit BT.709 Y'CbCr, in 1/65536.
+static const double kKr = 0.2126, kKb = 0.0722, kKg = 1 - kKr - kKb;
+static const double kYScale = 219.0 * 16 / 255 * 65536;
+static const double kCScale = 224.0 * 16 / 255 * 65536;
+static const int kYR = (int)std::lround(kYScale * kKr);
+static const int kYG = (int)std::lround(kYScale * kKg);
+static const int kYB = (int)std::lround(kYScale * kKb);
+static const int kCbR = (int)std::lround(-kCScale * kKr / (2 * (1 - kKb)));
+static const int kCbG = (int)std::lround(-kCScale * kKg / (2 * (1 - kKb)));
+static const int kCrG = (int)std::lround(-kCScale * kKg / (2 * (1 - kKr)));
+static const int kCrB = (int)std::lround(-kCScale * kKb / (2 * (1 - kKr)));
+static const int kCHalf = (int)std::lround(kCScale / 2);
+
+static inline void kernel_444(uint16_t *dst, const uint8_t *r0,
+                              const uint8_t *r1, int n, int shift,
+                              const uint16_t dither[8]) {
+  pk_chroma_444_to_420_u8(dst, r0, r1, n, shift, dither, kMax10);
+}
+
+static inline void kernel_444(uint16_t *dst, const uint16_t *r0,
+                              const uint16_t *r1, int n, int shift,
+                              const uint16_t dither[8]) {
+  pk_chroma_444_to_420_u16(dst, r0, r1, n, shift, dither, kMax10);
+}
+
+// One 4:2:0 row from two 4:4:4 rows of width w. The edge columns repeat the
+// border sample; the rest goes to the kernel, whose dither index starts at
+// column 1.
+template <typename T>
+static void downsample_444_row(uint16_t *dst, const T *r0, const T *r1, int w,
+                               int shift, const uint16_t dither[8]) {
+  int cw = (w + 1) / 2;
+  auto edge = [&](int x) {
+    int l = std::max(2 * x - 1, 0), c = 2 * x, r = std::min(2 * x + 1, w - 1);
+    uint32_t sum = r0[l] + 2 * r0[c] + r0[r] + r1[l] + 2 * r1[c] + r1[r];
+    dst[x] = (uint16_t)std::min<uint32_t>(kMax10,
+                                          (sum + dither[x & 7]) >> shift);
+  };
+  edge(0);
+  if (cw > 2) {
+    uint16_t shifted[8];
+    for (int i = 0; i < 8; i++)
+      shifted[i] = dither[(i + 1) & 7];
+    kernel_444(dst + 1, r0 + 2, r1 + 2, cw - 2, shift, shifted);
+  }
+  if (cw > 1)
+    edge(cw - 1);
+}
+
+ChromaDownsampler *ChromaDownsampler::create(int pix_fmt, int colorspace,
+                                             int color_range,
+                                             int color_primaries,
+                                             int threads) {
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((AVPixelFormat)pix_fmt);
+  if (!desc || desc->nb_components < 3 ||
+      (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM |
+                      AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BE |
+                      AV_PIX_FMT_FLAG_FLOAT)))
+    return nullptr;
+  for (int c = 0; c < 3; c++) {
+    if (desc->comp[c].shift != 0 || desc->comp[c].depth != desc->comp[0].depth)
+      return nullptr;
+  }
+
+  Layout layout;
+  int depth = desc->comp[0].depth;
+  if (desc->flags & AV_PIX_FMT_FLAG_RGB) {
+    // Packed (rgba, bgr0, rgb24...) or planar (gbrp) 8-bit RGB.
+    if (depth != 8 || desc->comp[1].step != desc->comp[0].step ||
+        desc->comp[2].step != desc->comp[0].step)
+      return nullptr;
+    layout = Layout::Rgb;
+  } else {
+    // The source matrix is kept, so it has to be the one the encoder tags.
+    if (!(desc->flags & AV_PIX_FMT_FLAG_PLANAR) || desc->log2_chroma_h != 0 ||
+        desc->log2_chroma_w > 1 || (depth != 8 && depth != 10 && depth != 12) ||
+        pix_fmt == AV_PIX_FMT_YUVJ444P || pix_fmt == AV_PIX_FMT_YUVJ422P ||
+        color_range == AVCOL_RANGE_JPEG ||
+        (colorspace != AVCOL_SPC_BT709 &&
+         colorspace != AVCOL_SPC_UNSPECIFIED) ||
+        (color_primaries != AVCOL_PRI_BT709 &&
+         color_primaries != AVCOL_PRI_UNSPECIFIED))
+      return nullptr;
+    for (int c = 0; c < 3; c++) {
+      if (desc->comp[c].plane != c || desc->comp[c].offset != 0)
+        return nullptr;
+    }
+    layout = desc->log2_chroma_w ? Layout::Yuv422 : Layout::Yuv444;
+  }
+
+  ChromaDownsampler *cd = new ChromaDownsampler();
+  cd->m_pix_fmt = pix_fmt;
+  cd->m_layout = layout;
+  cd->m_depth = depth;
+  switch (layout) {
+  case Layout::Yuv444:
+    cd->m_luma_shift = std::max(depth - 10, 0);
+    cd->m_chroma_shift = depth - 7; // Six taps weighing 8, then to 10 bits
+    break;
+  case Layout::Yuv422:
+    cd->m_luma_shift = std::max(depth - 10, 0);
+    cd->m_chroma_shift = std::max(depth - 9, 0); // Two taps
+    break;
+  case Layout::Rgb:
+    for (int c = 0; c < 3; c++) {
+      cd->m_rgb_plane[c] = desc->comp[c].plane;
+      cd->m_rgb_offset[c] = desc->comp[c].offset;
+    }
+    cd->m_rgb_step = desc->comp[0].step;
+    cd->m_luma_shift = kRgbDepth - 10;
+    cd->m_chroma_shift = kRgbDepth - 7;
+    break;
+  }
+
+  // Planes read the pattern at different offsets so their errors do not
+  // line up in the same pixels.
+  for (int p = 0; p < 3; p++) {
+    int shift = p == 0 ? cd->m_luma_shift : cd->m_chroma_shift;
+    for (int y = 0; y < 8; y++) {
+      for (int x = 0; x < 8; x++)
+        cd->m_dither[p][y][x] = (uint16_t)(
+            kBayer8[(y + 3 * p) & 7][(x + 5 * p) & 7] >> (6 - shift));
+    }
+  }
+
+  if (threads <= 0)
+    threads = (int)std::thread::hardware_concurrency();
+  cd->m_slices = std::min(std::max(threads, 1), kMaxSlices);
+  cd->m_scratch.resize(cd->m_slices);
+  for (int i = 1; i < cd->m_slices; i++)
+    cd->m_workers.emplace_back(&ChromaDownsampler::workerLoop, cd, i);
+  return cd;
+}
+
+ChromaDownsampler::~ChromaDownsampler() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_quit = true;
+  }
+  m_wake.notify_all();
+  for (std::thread &worker : m_workers)
+    worker.join();
+}
+
+bool ChromaDownsampler::convert(const AVFrame *src, AVFrame *dst) {
+  if (src->format != m_pix_fmt || dst->format != AV_PIX_FMT_YUV420P10LE ||
+      src->width != dst->width || src->height != dst->height)
+    return false;
+  av_frame_copy_props(dst, src);
+  dst->color_range = AVCOL_RANGE_MPEG;
+  dst->color_primaries = AVCOL_PRI_BT709;
+  dst->color_trc = AVCOL_TRC_BT709;
+  dst->colorspace = AVCOL_SPC_BT709;
+  dst->chroma_location = AVCHROMA_LOC_LEFT;
+
+  m_src = src;
+  m_dst = dst;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_generation++;
+    m_busy = (int)m_workers.size();
+  }
+  m_wake.notify_all();
+  runSlice(0);
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_done.wait(lock, [this] { return m_busy == 0; });
+  return true;
+}
+
+void ChromaDownsampler::workerLoop(int slice) {
+  int64_t seen = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [&] { return m_quit || m_generation != seen; });
+      if (m_quit)
+        return;
+      seen = m_generation;
+    }
+    runSlice(slice);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (--m_busy == 0)
+      m_done.notify_one();
+  }
+}
+
+void ChromaDownsampler::runSlice(int slice) {
+  int rows = (m_src->height + 1) / 2;
+  int first = (int)((int64_t)rows * slice / m_slices);
+  int last = (int)((int64_t)rows * (slice + 1) / m_slices);
+  if (first >= last)
+    return;
+  TraceSpan span("chroma slice", "slice", slice);
+  if (m_layout == Layout::Rgb)
+    convertRgbRows(first, last, m_scratch[slice]);
+  else
+    convertRows(first, last);
+}
+
+void ChromaDownsampler::convertRows(int first, int last) {
+  const AVFrame *src = m_src;
+  AVFrame *dst = m_dst;
+  int w = src->width, h = src->height;
+  int cw = (w + 1) / 2;
+  bool wide = m_depth > 8;
+
+  for (int cy = first; cy < last; cy++) {
+    for (int y = 2 * cy; y < std::min(2 * cy + 2, h); y++) {
+      const uint8_t *in = src->data[0] + (ptrdiff_t)y * src->linesize[0];
+      uint16_t *out =
+          (uint16_t *)(dst->data[0] + (ptrdiff_t)y * dst->linesize[0]);
+      if (!wide)
+        pk_widen_u8(out, in, w, 2);
+      else if (m_luma_shift == 0)
+        memcpy(out, in, (size_t)w * 2);
+      else
+        pk_narrow_u16(out, (const uint16_t *)in, w, m_luma_shift,
+                      m_dither[0][y & 7], kMax10);
+    }
+
+    // The last row of an odd height pairs with itself.
+    int y0 = 2 * cy, y1 = std::min(2 * cy + 1, h - 1);
+    for (int p = 1; p < 3; p++) {
+      const uint8_t *a = src->data[p] + (ptrdiff_t)y0 * src->linesize[p];
+      const uint8_t *b = src->data[p] + (ptrdiff_t)y1 * src->linesize[p];
+      uint16_t *out =
+          (uint16_t *)(dst->data[p] + (ptrdiff_t)cy * dst->linesize[p]);
+      const uint16_t *dither = m_dither[p][cy & 7];
+      if (m_layout == Layout::Yuv422) {
+        if (!wide)
+          pk_chroma_422_to_420_u8(out, a, b, cw);
+        else
+          pk_chroma_422_to_420_u16(out, (const uint16_t *)a,
+                                   (const uint16_t *)b, cw, m_chroma_shift,
+                                   dither, kMax10);
+      } else if (!wide) {
+        downsample_444_row(out, a, b, w, m_chroma_shift, dither);
+      } else {
+        downsample_444_row(out, (const uint16_t *)a, (const uint16_t *)b, w,
+                           m_chroma_shift, dither);
+      }
+    }
+  }
+}
+
+void ChromaDownsampler::convertRgbRows(int first, int last,
+                                       std::vector<uint16_t> &scratch) {
+  const AVFrame *src = m_src;
+  AVFrame *dst = m_dst;
+  int w = src->width, h = src->height;
+  int step = m_rgb_step;
+  scratch.resize((size_t)w * 5);
+  uint16_t *luma = scratch.data();
+  uint16_t *cb[2] = {luma + w, luma + 2 * w};
+  uint16_t *cr[2] = {luma + 3 * w, luma + 4 * w};
+
+  for (int cy = first; cy < last; cy++) {
+    int rows = std::min(2 * cy + 2, h) - 2 * cy;
+    for (int k = 0; k < rows; k++) {
+      int y = 2 * cy + k;
+      const uint8_t *pr = src->data[m_rgb_plane[0]] +
+                          (ptrdiff_t)y * src->linesize[m_rgb_plane[0]] +
+                          m_rgb_offset[0];
+      const uint8_t *pg = src->data[m_rgb_plane[1]] +
+                          (ptrdiff_t)y * src->linesize[m_rgb_plane[1]] +
+                          m_rgb_offset[1];
+      const uint8_t *pb = src->data[m_rgb_plane[2]] +
+                          (ptrdiff_t)y * src->linesize[m_rgb_plane[2]] +
+                          m_rgb_offset[2];
+      uint16_t *cbk = cb[k], *crk = cr[k];
+      for (int x = 0; x < w; x++) {
+        int r = pr[x * step], g = pg[x * step], b = pb[x * step];
+        luma[x] = (uint16_t)(((256 << 16) + kYR * r + kYG * g + kYB * b +
+                              (1 << 15)) >>
+                             16);
+        cbk[x] = (uint16_t)(((2048 << 16) + kCbR * r + kCbG * g + kCHalf * b +
+                             (1 << 15)) >>
+                            16);
+        crk[x] = (uint16_t)(((2048 << 16) + kCHalf * r + kCrG * g + kCrB * b +
+                             (1 << 15)) >>
+                            16);
+      }
+      uint16_t *out =
+          (uint16_t *)(dst->data[0] + (ptrdiff_t)y * dst->linesize[0]);
+      pk_narrow_u16(out, luma, w, m_luma_shift, m_dither[0][y & 7], kMax10);
+    }
+
+    int pair = rows - 1; // Odd height: the last row pairs with itself
+    downsample_444_row(
+        (uint16_t *)(dst->data[1] + (ptrdiff_t)cy * dst->linesize[1]), cb[0],
+        cb[pair], w, m_chroma_shift, m_dither[1][cy & 7]);
+    downsample_444_row(
+        (uint16_t *)(dst->data[2] + (ptrdiff_t)cy * dst->linesize[2]), cr[0],
+        cr[pair], w, m_chroma_shift, m_dither[2][cy & 7]);
+  }
+}
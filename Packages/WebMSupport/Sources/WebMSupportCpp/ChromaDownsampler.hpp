@@ -0,0 +1,73 @@
+#ifndef CHROMA_DOWNSAMPLER_HPP
+#define CHROMA_DOWNSAMPLER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct AVFrame;
+
+// Converts high-chroma sources to yuv420p10le in one pass per row pair:
+// chroma is filtered and decimated (see pk_chroma_444_to_420_*) and every
+// plane is brought to 10 bits with an 8x8 ordered dither. Handles planar
+// 4:4:4 and 4:2:2 YUV at 8, 10 or 12 bits in BT.709 limited range, and
+// 8-bit RGB (packed or planar), which goes through the BT.709 matrix at 12
+// bits first. Frames are cut into horizontal slices converted in parallel
+// by a few persistent workers.
+class ChromaDownsampler {
+public:
+  static constexpr int kMaxSlices = 16;
+
+  // Null if frames of this format and color description have no fast path.
+  // `threads` 0 means one slice per core.
+  static ChromaDownsampler *create(int pix_fmt, int colorspace,
+                                   int color_range, int color_primaries,
+                                   int threads);
+  ~ChromaDownsampler();
+
+  ChromaDownsampler(const ChromaDownsampler &) = delete;
+  ChromaDownsampler &operator=(const ChromaDownsampler &) = delete;
+
+  // `dst` is a writable yuv420p10le frame of the source's size. False if
+  // `src` is not in the format this converter was created for.
+  bool convert(const AVFrame *src, AVFrame *dst);
+
+private:
+  enum class Layout { Yuv444, Yuv422, Rgb };
+
+  ChromaDownsampler() = default;
+
+  // Converts chroma rows [first, last) and the luma rows they cover.
+  void convertRows(int first, int last);
+  void convertRgbRows(int first, int last, std::vector<uint16_t> &scratch);
+  void runSlice(int slice);
+  void workerLoop(int slice);
+
+  int m_pix_fmt = -1;
+  Layout m_layout = Layout::Yuv444;
+  int m_depth = 8;
+  int m_rgb_plane[3] = {0, 0, 0}; // R, G, B
+  int m_rgb_offset[3] = {0, 0, 0};
+  int m_rgb_step = 1;
+  int m_luma_shift = 0;
+  int m_chroma_shift = 0;
+  uint16_t m_dither[3][8][8]; // Per plane and row, already scaled
+
+  // Current job, shared with the workers.
+  const AVFrame *m_src = nullptr;
+  AVFrame *m_dst = nullptr;
+  int m_slices = 1;
+  std::vector<std::vector<uint16_t>> m_scratch; // RGB intermediate rows
+
+  std::vector<std::thread> m_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+  int64_t m_generation = 0;
+  int m_busy = 0;
+  bool m_quit = false;
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include "CropDetect.hpp"
+#include "PixelKernels.hpp"
+
+#include <algorithm>
+
+// Column statistics use at most this many rows per frame.
+static const int kMaxColumnRows = 512;
+
+CropDetector::CropDetector(int width, int height, int bitDepth,
+                           int chromaShiftX, int chromaShiftY, bool fullRange)
+    : m_width(width), m_height(height), m_depth(bitDepth),
+      m_shift_x(chromaShiftX), m_shift_y(chromaShiftY),
+      m_left(width), m_top(height), m_right(0), m_bottom(0) {
+  int scale = bitDepth - 8;
+  m_black = fullRange ? 0 : (uint16_t)(16 << scale);
+  m_neutral = (uint16_t)(128 << scale);
+  m_luma_limit = 10u << scale;
+  m_chroma_limit = 4u << scale;
+}
+
+uint64_t CropDetector::rowDeviation(const uint8_t *row, int n,
+                                    uint16_t level) const {
+  if (m_depth > 8)
+    return pk_sad_const_u16((const uint16_t *)row, n, level);
+  return pk_sad_const_u8(row, n, (uint8_t)level);
+}
+
+void CropDetector::accumulateColumns(std::vector<uint32_t> &acc,
+                                     const uint8_t *row, int n,
+                                     uint16_t level) const {
+  if (m_depth > 8)
+    pk_accumulate_absdiff_u16(acc.data(), (const uint16_t *)row, n, level);
+  else
+    pk_accumulate_absdiff_u8(acc.data(), row, n, (uint8_t)level);
+}
+
+bool CropDetector::rowIsBar(const uint8_t *const planes[3],
+                            const int strides[3], int y) const {
+  const uint8_t *luma = planes[0] + (int64_t)y * strides[0];
+  if (rowDeviation(luma, m_width, m_black) > (uint64_t)m_luma_limit * m_width)
+    return false;
+  int cw = -((-m_width) >> m_shift_x);
+  int cy = y >> m_shift_y;
+  for (int p = 1; p < 3; p++) {
+    if (!planes[p])
+      continue;
+    const uint8_t *chroma = planes[p] + (int64_t)cy * strides[p];
+    if (rowDeviation(chroma, cw, m_neutral) > (uint64_t)m_chroma_limit * cw)
+      return false;
+  }
+  return true;
+}
+
+void CropDetector::addFrame(const uint8_t *const planes[3],
+                            const int strides[3]) {
+  // Rows from each edge; bars never cover half the picture.
+  int half_h = m_height / 2;
+  int top = 0;
+  while (top < half_h && rowIsBar(planes, strides, top))
+    top++;
+  int bottom = m_height;
+  while (bottom > m_height - half_h && rowIsBar(planes, strides, bottom - 1))
+    bottom--;
+  if (top >= half_h || bottom <= m_height - half_h)
+    return; // Black through the middle: fade or dark frame, no evidence
+
+  // Column means over a subsample of the content rows.
+  int rows = bottom - top;
+  int step = std::max(1, rows / kMaxColumnRows);
+  int cw = -((-m_width) >> m_shift_x);
+  std::vector<uint32_t> luma(m_width, 0);
+  std::vector<uint32_t> chroma(cw, 0);
+  int sampled = 0;
+  for (int y = top; y < bottom; y += step, sampled++) {
+    accumulateColumns(luma, planes[0] + (int64_t)y * strides[0], m_width,
+                      m_black);
+    int cy = y >> m_shift_y;
+    for (int p = 1; p < 3; p++) {
+      if (planes[p])
+        accumulateColumns(chroma, planes[p] + (int64_t)cy * strides[p], cw,
+                          m_neutral);
+    }
+  }
+  int chroma_planes = (planes[1] ? 1 : 0) + (planes[2] ? 1 : 0);
+  uint64_t luma_max = (uint64_t)m_luma_limit * sampled;
+  uint64_t chroma_max = (uint64_t)m_chroma_limit * sampled * chroma_planes;
+  auto column_is_bar = [&](int x) {
+    return luma[x] <= luma_max && chroma[x >> m_shift_x] <= chroma_max;
+  };
+
+  int half_w = m_width / 2;
+  int left = 0;
+  while (left < half_w && column_is_bar(left))
+    left++;
+  int right = m_width;
+  while (right > m_width - half_w && column_is_bar(right - 1))
+    right--;
+  if (left >= half_w || right <= m_width - half_w)
+    return;
+
+  m_left = std::min(m_left, left);
+  m_top = std::min(m_top, top);
+  m_right = std::max(m_right, right);
+  m_bottom = std::max(m_bottom, bottom);
+  m_frames++;
+}
+
+bool CropDetector::result(CropRect *rect) const {
+  if (m_frames < 2)
+    return false;
+
+  // Round outward onto the chroma grid (and even sizes for 4:2:0 encoders),
+  // so content is never cut.
+  int align_x = std::max(2, 1 << m_shift_x);
+  int align_y = std::max(2, 1 << m_shift_y);
+  int left = m_left / align_x * align_x;
+  int top = m_top / align_y * align_y;
+  int right = std::min(m_width, (m_right + align_x - 1) / align_x * align_x);
+  int bottom = std::min(m_height, (m_bottom + align_y - 1) / align_y * align_y);
+
+  // Bars thinner than 1% (or 4 px) are edge noise, not worth a crop.
+  int min_x = std::max(4, m_width / 100);
+  int min_y = std::max(4, m_height / 100);
+  if (m_width - (right - left) < min_x) {
+    left = 0;
+    right = m_width;
+  }
+  if (m_height - (bottom - top) < min_y) {
+    top = 0;
+    bottom = m_height;
+  }
+  if (right - left == m_width && bottom - top == m_height)
+    return false;
+
+  rect->x = left;
+  rect->y = top;
+  rect->width = right - left;
+  rect->height = bottom - top;
+  return true;
+}
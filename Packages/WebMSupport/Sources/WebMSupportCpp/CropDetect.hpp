@@ -0,0 +1,55 @@
+#ifndef CROP_DETECT_HPP
+#define CROP_DETECT_HPP
+
+#include "WebMSupportCpp/FFmpegWrapper.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Finds baked-in letterbox/pillarbox bars in planar YUV frames. A border row
+// or column counts as bar when its luma stays near black and its chroma near
+// neutral, which keeps dark but coloured content from being cut. Each frame
+// yields the extent of its content; the result is the union over all frames
+// (so a dark scene cannot shrink it), aligned to the chroma grid. Frames
+// that are black from edge to middle (fades) are ignored.
+class CropDetector {
+public:
+  // bitDepth 8 uses 8-bit samples, 9-16 uses 16-bit words. Chroma shifts
+  // are the pixel format's log2 subsampling factors.
+  CropDetector(int width, int height, int bitDepth, int chromaShiftX,
+               int chromaShiftY, bool fullRange);
+
+  // planes[1]/planes[2] may be null for gray formats, or to judge bars on
+  // luma alone.
+  void addFrame(const uint8_t *const planes[3], const int strides[3]);
+
+  // False unless at least two frames were usable and the bars are wide
+  // enough to be worth cropping.
+  bool result(CropRect *rect) const;
+  int framesUsed() const { return m_frames; }
+
+private:
+  bool rowIsBar(const uint8_t *const planes[3], const int strides[3],
+                int y) const;
+  uint64_t rowDeviation(const uint8_t *row, int n, uint16_t level) const;
+  void accumulateColumns(std::vector<uint32_t> &acc, const uint8_t *row,
+                         int n, uint16_t level) const;
+
+  int m_width;
+  int m_height;
+  int m_depth;
+  int m_shift_x;
+  int m_shift_y;
+  uint16_t m_black;
+  uint16_t m_neutral;
+  uint32_t m_luma_limit;   // Mean deviation from black
+  uint32_t m_chroma_limit; // Mean deviation from neutral
+
+  int m_frames = 0;
+  int m_left;
+  int m_top;
+  int m_right;  // Exclusive
+  int m_bottom; // Exclusive
+};
+
+#endif
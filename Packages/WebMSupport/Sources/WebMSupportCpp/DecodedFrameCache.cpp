@@ -0,0 +1,95 @@
+#include "DecodedFrameCache.hpp"
+
+#include <algorithm>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+static void free_frames(std::vector<AVFrame *> &frames) {
+  for (AVFrame *frame : frames)
+    av_frame_free(&frame);
+  frames.clear();
+}
+
+DecodedFrameCache::DecodedFrameCache(int64_t capacityBytes)
+    : m_capacity(capacityBytes) {}
+
+DecodedFrameCache::~DecodedFrameCache() { clear(); }
+
+int64_t DecodedFrameCache::frameBytes(const AVFrame *frame) {
+  int64_t bytes = 0;
+  for (int i = 0; i < AV_NUM_DATA_POINTERS && frame->buf[i]; i++)
+    bytes += (int64_t)frame->buf[i]->size;
+  return bytes;
+}
+
+void DecodedFrameCache::setCapacity(int64_t bytes) {
+  m_capacity = std::max<int64_t>(0, bytes);
+  evictTo(m_capacity);
+}
+
+const AVFrame *DecodedFrameCache::lookup(int64_t pts) {
+  auto it = m_gops.upper_bound(pts);
+  if (it == m_gops.begin()) {
+    m_misses++;
+    return nullptr;
+  }
+  --it;
+  Gop &gop = it->second;
+  if (pts >= gop.endPts || gop.frames.empty()) {
+    m_misses++;
+    return nullptr;
+  }
+
+  m_lru.splice(m_lru.begin(), m_lru, gop.lru);
+  m_hits++;
+
+  auto frame = std::upper_bound(
+      gop.frames.begin(), gop.frames.end(), pts,
+      [](int64_t value, const AVFrame *f) { return value < f->pts; });
+  return frame == gop.frames.begin() ? gop.frames.front() : *(frame - 1);
+}
+
+bool DecodedFrameCache::insert(int64_t startPts, int64_t endPts,
+                               std::vector<AVFrame *> frames) {
+  int64_t bytes = 0;
+  for (const AVFrame *frame : frames)
+    bytes += frameBytes(frame);
+  if (frames.empty() || bytes > m_capacity) {
+    free_frames(frames);
+    return false;
+  }
+
+  auto existing = m_gops.find(startPts);
+  if (existing != m_gops.end())
+    erase(existing);
+  evictTo(m_capacity - bytes);
+
+  m_lru.push_front(startPts);
+  Gop gop;
+  gop.endPts = endPts;
+  gop.frames = std::move(frames);
+  gop.bytes = bytes;
+  gop.lru = m_lru.begin();
+  m_gops.emplace(startPts, std::move(gop));
+  m_size += bytes;
+  return true;
+}
+
+void DecodedFrameCache::clear() {
+  while (!m_gops.empty())
+    erase(m_gops.begin());
+}
+
+void DecodedFrameCache::erase(std::map<int64_t, Gop>::iterator it) {
+  m_size -= it->second.bytes;
+  m_lru.erase(it->second.lru);
+  free_frames(it->second.frames);
+  m_gops.erase(it);
+}
+
+void DecodedFrameCache::evictTo(int64_t bytes) {
+  while (m_size > bytes && !m_lru.empty())
+    erase(m_gops.find(m_lru.back()));
+}
@@ -0,0 +1,63 @@
+#ifndef DECODED_FRAME_CACHE_HPP
+#define DECODED_FRAME_CACHE_HPP
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <vector>
+
+struct AVFrame;
+
+// Byte-bounded LRU of decoded pictures, held a GOP at a time. A GOP spans
+// [startPts, endPts) in stream time base: from its keyframe up to the next
+// keyframe, so any pts inside it resolves to a cached picture without
+// touching the decoder. Whole GOPs are evicted, least recently used first.
+class DecodedFrameCache {
+public:
+  explicit DecodedFrameCache(int64_t capacityBytes);
+  ~DecodedFrameCache();
+
+  DecodedFrameCache(const DecodedFrameCache &) = delete;
+  DecodedFrameCache &operator=(const DecodedFrameCache &) = delete;
+
+  // Evicts down to the new capacity. 0 disables caching.
+  void setCapacity(int64_t bytes);
+  int64_t capacity() const { return m_capacity; }
+  int64_t sizeBytes() const { return m_size; }
+
+  // Picture on screen at `pts` (the last one with pts <= `pts`), or nullptr
+  // if no cached GOP covers it. The pointer stays valid until the next
+  // insert(), setCapacity() or clear().
+  const AVFrame *lookup(int64_t pts);
+
+  // Takes ownership of `frames` (ascending pts). GOPs that cannot fit even
+  // in an empty cache are freed and false is returned.
+  bool insert(int64_t startPts, int64_t endPts, std::vector<AVFrame *> frames);
+  void clear();
+
+  int64_t hits() const { return m_hits; }
+  int64_t misses() const { return m_misses; }
+
+  // Size of the buffers backing a picture.
+  static int64_t frameBytes(const AVFrame *frame);
+
+private:
+  struct Gop {
+    int64_t endPts;
+    std::vector<AVFrame *> frames;
+    int64_t bytes;
+    std::list<int64_t>::iterator lru;
+  };
+
+  void erase(std::map<int64_t, Gop>::iterator it);
+  void evictTo(int64_t bytes);
+
+  std::map<int64_t, Gop> m_gops; // By start pts
+  std::list<int64_t> m_lru;      // Start pts, most recently used first
+  int64_t m_capacity;
+  int64_t m_size = 0;
+  int64_t m_hits = 0;
+  int64_t m_misses = 0;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#include "DuplicateDetector.hpp"
+#include "PixelKernels.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+DuplicateDetector::DuplicateDetector(int width, int height, int bitDepth)
+    : m_width(width), m_height(height), m_wide(bitDepth > 8) {
+  // About 540 sampled rows whatever the resolution.
+  m_row_step = std::max(1, height / 540);
+  m_block_limit = (uint64_t)kBlock << std::max(0, bitDepth - 8);
+  m_row_bytes = (size_t)width * (m_wide ? 2 : 1);
+  m_reference.resize(m_row_bytes * ((height + m_row_step - 1) / m_row_step));
+}
+
+bool DuplicateDetector::matchesReference(const uint8_t *luma,
+                                         int stride) const {
+  if (!m_has_reference)
+    return false;
+
+  const uint8_t *ref = m_reference.data();
+  for (int y = 0; y < m_height; y += m_row_step, ref += m_row_bytes) {
+    const uint8_t *row = luma + (ptrdiff_t)y * stride;
+    for (int x = 0; x < m_width; x += kBlock) {
+      int n = std::min(kBlock, m_width - x);
+      uint64_t sad =
+          m_wide ? pk_sad_u16((const uint16_t *)row + x,
+                              (const uint16_t *)ref + x, n)
+                 : pk_sad_u8(row + x, ref + x, n);
+      // Partial blocks at the right edge get a proportional limit.
+      if (sad * kBlock > m_block_limit * n)
+        return false;
+    }
+  }
+  return true;
+}
+
+void DuplicateDetector::setReference(const uint8_t *luma, int stride) {
+  uint8_t *ref = m_reference.data();
+  for (int y = 0; y < m_height; y += m_row_step, ref += m_row_bytes)
+    memcpy(ref, luma + (ptrdiff_t)y * stride, m_row_bytes);
+  m_has_reference = true;
+}
@@ -0,0 +1,38 @@
+#ifndef DUPLICATE_DETECTOR_HPP
+#define DUPLICATE_DETECTOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Recognises frames that repeat the previous kept frame (static shots, or
+// low-fps animation uploaded at 60 fps). Only luma is compared, on every
+// m_row_step-th row, split into blocks of kBlock samples; a frame matches
+// when no block's mean difference exceeds one code value (8-bit scale). The
+// per-block limit catches small moving objects a whole-frame mean would
+// average away, and comparing against the last kept frame rather than the
+// last seen one stops slow fades from drifting through unnoticed.
+class DuplicateDetector {
+public:
+  static constexpr int kBlock = 128;
+
+  // bitDepth counts the significant bits of a sample word including any
+  // padding shift (16 for P010); above 8 the plane holds 16-bit words.
+  DuplicateDetector(int width, int height, int bitDepth);
+
+  bool hasReference() const { return m_has_reference; }
+  bool matchesReference(const uint8_t *luma, int stride) const;
+  void setReference(const uint8_t *luma, int stride);
+
+private:
+  int m_width;
+  int m_height;
+  bool m_wide;
+  int m_row_step;
+  uint64_t m_block_limit;
+  size_t m_row_bytes;
+  std::vector<uint8_t> m_reference; // Sampled rows, packed
+  bool m_has_reference = false;
+};
+
+#endif
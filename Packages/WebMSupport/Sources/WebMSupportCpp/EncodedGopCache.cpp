@@ -0,0 +1,174 @@
+#include "EncodedGopCache.hpp"
+#include "FileIdentity.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
+#include <system_error>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+namespace fs = std::filesystem;
+
+static void close_output(AVFormatContext *ctx) {
+  if (!ctx)
+    return;
+  if (!(ctx->oformat->flags & AVFMT_NOFILE))
+    avio_closep(&ctx->pb);
+  avformat_free_context(ctx);
+}
+
+EncodedGopCache::EncodedGopCache(const std::string &directory,
+                                 int64_t capacityBytes)
+    : m_dir(directory), m_capacity(capacityBytes) {
+  std::error_code ec;
+  fs::create_directories(m_dir, ec);
+}
+
+std::string EncodedGopCache::unitKey(const std::string &sourceIdentity,
+                                     const std::string &settingsKey,
+                                     double startTime, double endTime) {
+  // Microseconds: keyframe times come from the same demuxer on every run, so
+  // they round identically.
+  char range[64];
+  snprintf(range, sizeof(range), "|%lld|%lld", llround(startTime * 1e6),
+           llround(endTime * 1e6));
+  std::string text = sourceIdentity + "|" + settingsKey + range;
+  return to_hex64(fnv1a_64(text)) +
+         to_hex64(fnv1a_64(text.data(), text.size(), 0x84222325cbf29ce4ULL));
+}
+
+std::string EncodedGopCache::unitPath(const std::string &key) const {
+  return (fs::path(m_dir) / ("gop_" + key + ".mov")).string();
+}
+
+bool EncodedGopCache::lookup(const std::string &key) const {
+  std::error_code ec;
+  fs::path path = unitPath(key);
+  if (!fs::is_regular_file(path, ec) || fs::file_size(path, ec) == 0)
+    return false;
+  fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+  return true;
+}
+
+void EncodedGopCache::evict() const {
+  if (m_capacity <= 0)
+    return;
+
+  struct Entry {
+    fs::file_time_type mtime;
+    int64_t size;
+    fs::path path;
+  };
+  std::vector<Entry> entries;
+  int64_t total = 0;
+  std::error_code ec;
+  for (const auto &entry : fs::directory_iterator(m_dir, ec)) {
+    std::string name = entry.path().filename().string();
+    if (name.rfind("gop_", 0) != 0)
+      continue;
+    std::error_code entry_ec;
+    int64_t size = (int64_t)entry.file_size(entry_ec);
+    if (entry_ec)
+      continue;
+    entries.push_back({entry.last_write_time(entry_ec), size, entry.path()});
+    total += size;
+  }
+  if (total <= m_capacity)
+    return;
+
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) { return a.mtime < b.mtime; });
+  for (const Entry &entry : entries) {
+    if (total <= m_capacity)
+      break;
+    if (fs::remove(entry.path, ec))
+      total -= entry.size;
+  }
+}
+
+EncodedGopCache::Writer::Writer(const EncodedGopCache &cache,
+                                const std::vector<GopUnit> &units)
+    : m_cache(cache), m_units(units) {}
+
+EncodedGopCache::Writer::~Writer() { abandon(); }
+
+bool EncodedGopCache::Writer::openUnit(size_t unit,
+                                       const AVCodecContext *enc_ctx,
+                                       int timescale) {
+  m_unit = unit;
+  std::string path = m_cache.unitPath(m_units[unit].key) + ".part";
+  if (avformat_alloc_output_context2(&m_ctx, nullptr, "mov", path.c_str()) <
+      0)
+    return false;
+
+  m_stream = avformat_new_stream(m_ctx, nullptr);
+  if (!m_stream ||
+      avcodec_parameters_from_context(m_stream->codecpar, enc_ctx) < 0) {
+    close_output(m_ctx);
+    m_ctx = nullptr;
+    return false;
+  }
+  if (enc_ctx->codec_id == AV_CODEC_ID_HEVC)
+    m_stream->codecpar->codec_tag = MKTAG('h', 'v', 'c', '1');
+  if (timescale > 0)
+    m_stream->time_base = {1, timescale};
+
+  if (avio_open(&m_ctx->pb, path.c_str(), AVIO_FLAG_WRITE) < 0 ||
+      avformat_write_header(m_ctx, nullptr) < 0) {
+    close_output(m_ctx);
+    m_ctx = nullptr;
+    return false;
+  }
+  m_packets = 0;
+  return true;
+}
+
+bool EncodedGopCache::Writer::closeUnit(bool commit) {
+  if (!m_ctx)
+    return true;
+
+  std::string path = m_cache.unitPath(m_units[m_unit].key);
+  std::string part_path = path + ".part";
+  bool ok = av_write_trailer(m_ctx) >= 0;
+  close_output(m_ctx);
+  m_ctx = nullptr;
+  m_stream = nullptr;
+
+  if (!commit || !ok || m_packets == 0) {
+    std::remove(part_path.c_str());
+    return ok;
+  }
+  return rename(part_path.c_str(), path.c_str()) == 0;
+}
+
+bool EncodedGopCache::Writer::writePacket(AVPacket *pkt,
+                                          const AVCodecContext *enc_ctx,
+                                          int timescale) {
+  auto start = m_starts.find(pkt->pts);
+  if ((pkt->flags & AV_PKT_FLAG_KEY) && start != m_starts.end()) {
+    // Closed GOP: nothing after this key packet references the unit being
+    // closed.
+    if (!closeUnit(true) || !openUnit(start->second, enc_ctx, timescale))
+      return false;
+    m_starts.erase(m_starts.begin(), std::next(start));
+  } else if (!m_ctx) {
+    return false; // Encoder did not start on a marked keyframe
+  }
+
+  av_packet_rescale_ts(pkt, enc_ctx->time_base, m_stream->time_base);
+  pkt->stream_index = m_stream->index;
+  if (av_interleaved_write_frame(m_ctx, pkt) < 0)
+    return false;
+  m_packets++;
+  return true;
+}
+
+bool EncodedGopCache::Writer::finish() { return closeUnit(true); }
+
+void EncodedGopCache::Writer::abandon() { closeUnit(false); }
@@ -0,0 +1,81 @@
+#ifndef ENCODED_GOP_CACHE_HPP
+#define ENCODED_GOP_CACHE_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+struct AVCodecContext;
+struct AVFormatContext;
+struct AVPacket;
+struct AVStream;
+
+// One cache unit: a source GOP, or the part of one inside the trim.
+struct GopUnit {
+  double startTime;
+  double endTime;
+  std::string key;
+};
+
+// Content-addressed store of encoded closed GOPs, so re-exporting a source
+// with a different trim only encodes the GOPs that changed.
+//
+// An export is cut into units at the source's keyframes (the first and last
+// unit are clipped to the trim). A unit's key hashes the source identity,
+// the encode settings and its source time range, so the same GOP exported
+// with the same settings maps to the same file whatever the trim. Each unit
+// is stored as a MOV holding one closed GOP (more if the encoder placed
+// extra keyframes inside it) and export output is the concatenation of the
+// unit files. Hits refresh the file's mtime; evict() drops the least
+// recently used units beyond the capacity.
+class EncodedGopCache {
+public:
+  EncodedGopCache(const std::string &directory, int64_t capacityBytes);
+
+  static std::string unitKey(const std::string &sourceIdentity,
+                             const std::string &settingsKey, double startTime,
+                             double endTime);
+  std::string unitPath(const std::string &key) const;
+  // True if the unit is stored; marks it recently used.
+  bool lookup(const std::string &key) const;
+  void evict() const;
+
+  // Receives the packets of one encoder session covering `units` (a run of
+  // consecutive misses). The encoder must start a closed GOP at every unit
+  // start; markUnitStart() tells the writer which pts that is, and the key
+  // packet carrying it switches to the unit's file. Units are committed
+  // (renamed from *.part) as soon as the next one starts.
+  class Writer {
+  public:
+    Writer(const EncodedGopCache &cache, const std::vector<GopUnit> &units);
+    ~Writer();
+
+    void markUnitStart(size_t unit, int64_t pts) { m_starts[pts] = unit; }
+    // Packets in encoder time base.
+    bool writePacket(AVPacket *pkt, const AVCodecContext *enc_ctx,
+                     int timescale);
+    // Commits the unit in progress after the encoder has been flushed.
+    bool finish();
+    // Drops the unit in progress (operation cancelled).
+    void abandon();
+
+  private:
+    bool openUnit(size_t unit, const AVCodecContext *enc_ctx, int timescale);
+    bool closeUnit(bool commit);
+
+    const EncodedGopCache &m_cache;
+    const std::vector<GopUnit> &m_units;
+    std::map<int64_t, size_t> m_starts; // Encoder pts -> unit index
+    size_t m_unit = 0;
+    AVFormatContext *m_ctx = nullptr;
+    AVStream *m_stream = nullptr;
+    int64_t m_packets = 0;
+  };
+
+private:
+  std::string m_dir;
+  int64_t m_capacity;
+};
+
+#endif
@@ -0,0 +1,389 @@
+#include "ExportCheckpoint.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <system_error>
+#include <unistd.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+namespace fs = std::filesystem;
+
+static const char *kJournalName = "journal.txt";
+static const char *kJournalMagic = "livid-export-journal 1";
+
+static bool interrupted(const AVIOInterruptCB *int_cb) {
+  return int_cb && int_cb->callback && int_cb->callback(int_cb->opaque);
+}
+
+static void close_output(AVFormatContext *ctx) {
+  if (!ctx)
+    return;
+  if (!(ctx->oformat->flags & AVFMT_NOFILE))
+    avio_closep(&ctx->pb);
+  avformat_free_context(ctx);
+}
+
+bool concat_mov_segments(const std::vector<std::string> &inputs,
+                         const char *outputPath, int timescale,
+                         const AVIOInterruptCB *int_cb) {
+  if (inputs.empty())
+    return false;
+
+  AVFormatContext *out_ctx = nullptr;
+  if (avformat_alloc_output_context2(&out_ctx, nullptr, "mov", outputPath) < 0)
+    return false;
+
+  AVStream *out_stream = nullptr;
+  AVPacket *pkt = av_packet_alloc();
+  int64_t next_pts = 0; // Where the next segment starts (output time base)
+  int64_t last_dts = AV_NOPTS_VALUE;
+  bool ok = true;
+
+  for (const std::string &input : inputs) {
+    AVFormatContext *in_ctx = nullptr;
+    if (avformat_open_input(&in_ctx, input.c_str(), nullptr, nullptr) < 0 ||
+        avformat_find_stream_info(in_ctx, nullptr) < 0) {
+      printf("[FFmpegWrapper] Error: Cannot open segment %s\n", input.c_str());
+      if (in_ctx)
+        avformat_close_input(&in_ctx);
+      ok = false;
+      break;
+    }
+
+    int stream_idx = -1;
+    for (unsigned int i = 0; i < in_ctx->nb_streams; i++) {
+      if (in_ctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+        stream_idx = (int)i;
+        break;
+      }
+    }
+    if (stream_idx < 0) {
+      avformat_close_input(&in_ctx);
+      ok = false;
+      break;
+    }
+    AVStream *in_stream = in_ctx->streams[stream_idx];
+
+    if (!out_stream) {
+      out_stream = avformat_new_stream(out_ctx, nullptr);
+      if (!out_stream) {
+        avformat_close_input(&in_ctx);
+        ok = false;
+        break;
+      }
+      avcodec_parameters_copy(out_stream->codecpar, in_stream->codecpar);
+      if (out_stream->codecpar->codec_id == AV_CODEC_ID_HEVC) {
+        out_stream->codecpar->codec_tag = MKTAG('h', 'v', 'c', '1');
+      } else {
+        out_stream->codecpar->codec_tag = 0;
+      }
+      if (timescale > 0)
+        out_stream->time_base = {1, timescale};
+
+      if (avio_open(&out_ctx->pb, outputPath, AVIO_FLAG_WRITE) < 0 ||
+          avformat_write_header(out_ctx, nullptr) < 0) {
+        avformat_close_input(&in_ctx);
+        ok = false;
+        break;
+      }
+    }
+
+    // Shift the whole segment so its first (key) packet lands where the
+    // previous one ended, keeping dts strictly increasing across the seam.
+    int64_t offset = AV_NOPTS_VALUE;
+    int64_t segment_end = next_pts;
+    while (ok && av_read_frame(in_ctx, pkt) >= 0) {
+      if (interrupted(int_cb)) {
+        ok = false;
+      } else if (pkt->stream_index == stream_idx) {
+        av_packet_rescale_ts(pkt, in_stream->time_base, out_stream->time_base);
+        if (pkt->dts == AV_NOPTS_VALUE)
+          pkt->dts = pkt->pts;
+        if (offset == AV_NOPTS_VALUE) {
+          offset = next_pts - pkt->pts;
+          if (last_dts != AV_NOPTS_VALUE && pkt->dts + offset <= last_dts)
+            offset = last_dts + 1 - pkt->dts;
+        }
+        pkt->pts += offset;
+        pkt->dts += offset;
+        last_dts = pkt->dts;
+        segment_end = std::max(segment_end, pkt->pts + pkt->duration);
+
+        pkt->pos = -1;
+        pkt->stream_index = out_stream->index;
+        if (av_interleaved_write_frame(out_ctx, pkt) < 0)
+          ok = false;
+      }
+      av_packet_unref(pkt);
+    }
+    next_pts = segment_end;
+    avformat_close_input(&in_ctx);
+    if (!ok)
+      break;
+  }
+
+  if (out_stream && out_ctx->pb)
+    av_write_trailer(out_ctx);
+  av_packet_free(&pkt);
+  close_output(out_ctx);
+
+  if (!ok)
+    std::remove(outputPath);
+  return ok;
+}
+
+ExportCheckpoint::ExportCheckpoint(const std::string &directory)
+    : m_dir(directory) {}
+
+ExportCheckpoint::~ExportCheckpoint() { abandon(); }
+
+std::string ExportCheckpoint::segmentPath(size_t index) const {
+  char name[32];
+  snprintf(name, sizeof(name), "seg_%05zu.mov", index);
+  return (fs::path(m_dir) / name).string();
+}
+
+std::string ExportCheckpoint::journalPath() const {
+  return (fs::path(m_dir) / kJournalName).string();
+}
+
+bool ExportCheckpoint::open(const std::string &sourceIdentity,
+                            const std::string &settingsKey) {
+  std::error_code ec;
+  fs::create_directories(m_dir, ec);
+  if (ec)
+    return false;
+
+  std::string header = std::string(kJournalMagic) + "\nsource " +
+                       sourceIdentity + "\nsettings " + settingsKey + "\n";
+
+  m_segments.clear();
+  m_complete = false;
+
+  if (FILE *f = fopen(journalPath().c_str(), "r")) {
+    char line[512];
+    std::string read_header;
+    int header_lines = 0;
+    while (fgets(line, sizeof(line), f)) {
+      if (header_lines < 3) {
+        read_header += line;
+        header_lines++;
+        continue;
+      }
+      if (read_header != header)
+        break;
+
+      unsigned int index = 0;
+      long long next_pts = 0;
+      double next_time = 0;
+      if (sscanf(line, "segment %u %lld %lf", &index, &next_pts, &next_time) ==
+              3 &&
+          index == m_segments.size() && fs::exists(segmentPath(index))) {
+        m_segments.push_back({(int64_t)next_pts, next_time});
+      } else if (strncmp(line, "complete", 8) == 0 && !m_segments.empty()) {
+        m_complete = true;
+      } else {
+        break; // Torn write: keep everything up to the last good line
+      }
+    }
+    fclose(f);
+    if (read_header != header) {
+      m_segments.clear();
+      m_complete = false;
+    }
+  }
+
+  if (m_segments.empty()) {
+    remove();
+    fs::create_directories(m_dir, ec);
+  }
+
+  // Drop half-written segments and anything past the last journaled one.
+  for (const auto &entry : fs::directory_iterator(m_dir, ec)) {
+    std::string name = entry.path().filename().string();
+    if (name.size() > 5 && name.compare(name.size() - 5, 5, ".part") == 0)
+      fs::remove(entry.path(), ec);
+  }
+  for (size_t i = m_segments.size(); fs::exists(segmentPath(i)); i++)
+    fs::remove(segmentPath(i), ec);
+
+  // Rewrite the journal from what survived validation.
+  std::string tmp_path = journalPath() + ".tmp";
+  FILE *f = fopen(tmp_path.c_str(), "w");
+  if (!f)
+    return false;
+  fputs(header.c_str(), f);
+  for (size_t i = 0; i < m_segments.size(); i++) {
+    fprintf(f, "segment %zu %lld %.6f\n", i, (long long)m_segments[i].nextPts,
+            m_segments[i].nextTime);
+  }
+  if (m_complete)
+    fputs("complete\n", f);
+  fflush(f);
+  fsync(fileno(f));
+  fclose(f);
+  if (rename(tmp_path.c_str(), journalPath().c_str()) != 0)
+    return false;
+
+  if (isResuming()) {
+    printf("[FFmpegWrapper] Resuming export after %zu segment(s) at %.3fs\n",
+           m_segments.size(), resumeTime());
+  }
+  return true;
+}
+
+int64_t ExportCheckpoint::resumePts() const {
+  return m_segments.empty() ? 0 : m_segments.back().nextPts;
+}
+
+double ExportCheckpoint::resumeTime() const {
+  return m_segments.empty() ? 0 : m_segments.back().nextTime;
+}
+
+void ExportCheckpoint::noteFrame(int64_t pts, double sourceTime) {
+  m_frame_times[pts] = sourceTime;
+}
+
+bool ExportCheckpoint::appendJournal(const char *line) {
+  FILE *f = fopen(journalPath().c_str(), "a");
+  if (!f)
+    return false;
+  fputs(line, f);
+  fflush(f);
+  fsync(fileno(f));
+  fclose(f);
+  return true;
+}
+
+bool ExportCheckpoint::openSegment(const AVCodecContext *enc_ctx,
+                                   int timescale) {
+  std::string path = segmentPath(m_segments.size()) + ".part";
+  if (avformat_alloc_output_context2(&m_seg_ctx, nullptr, "mov",
+                                     path.c_str()) < 0)
+    return false;
+
+  m_seg_stream = avformat_new_stream(m_seg_ctx, nullptr);
+  if (!m_seg_stream ||
+      avcodec_parameters_from_context(m_seg_stream->codecpar, enc_ctx) < 0) {
+    close_output(m_seg_ctx);
+    m_seg_ctx = nullptr;
+    return false;
+  }
+  if (enc_ctx->codec_id == AV_CODEC_ID_HEVC)
+    m_seg_stream->codecpar->codec_tag = MKTAG('h', 'v', 'c', '1');
+  if (timescale > 0)
+    m_seg_stream->time_base = {1, timescale};
+
+  if (avio_open(&m_seg_ctx->pb, path.c_str(), AVIO_FLAG_WRITE) < 0 ||
+      avformat_write_header(m_seg_ctx, nullptr) < 0) {
+    close_output(m_seg_ctx);
+    m_seg_ctx = nullptr;
+    return false;
+  }
+  m_seg_packets = 0;
+  return true;
+}
+
+bool ExportCheckpoint::closeSegment(bool commit, int64_t nextPts,
+                                    double nextTime) {
+  if (!m_seg_ctx)
+    return true;
+
+  size_t index = m_segments.size();
+  std::string part_path = segmentPath(index) + ".part";
+  bool ok = av_write_trailer(m_seg_ctx) >= 0;
+  close_output(m_seg_ctx);
+  m_seg_ctx = nullptr;
+  m_seg_stream = nullptr;
+
+  if (!commit || !ok) {
+    std::remove(part_path.c_str());
+    return ok;
+  }
+
+  if (rename(part_path.c_str(), segmentPath(index).c_str()) != 0)
+    return false;
+
+  char line[128];
+  snprintf(line, sizeof(line), "segment %zu %lld %.6f\n", index,
+           (long long)nextPts, nextTime);
+  if (!appendJournal(line))
+    return false;
+  m_segments.push_back({nextPts, nextTime});
+  return true;
+}
+
+bool ExportCheckpoint::writePacket(AVPacket *pkt,
+                                   const AVCodecContext *enc_ctx,
+                                   int timescale) {
+  if ((pkt->flags & AV_PKT_FLAG_KEY) && m_seg_ctx && m_seg_packets > 0) {
+    // Closed GOP: nothing after this key packet references the segment
+    // being closed, so it is safe to commit.
+    double next_time = 0;
+    auto it = m_frame_times.upper_bound(pkt->pts);
+    if (it != m_frame_times.begin())
+      next_time = std::prev(it)->second;
+    if (!closeSegment(true, pkt->pts, next_time))
+      return false;
+    m_frame_times.erase(m_frame_times.begin(),
+                        m_frame_times.lower_bound(pkt->pts));
+  }
+
+  if (!m_seg_ctx && !openSegment(enc_ctx, timescale))
+    return false;
+
+  av_packet_rescale_ts(pkt, enc_ctx->time_base, m_seg_stream->time_base);
+  pkt->stream_index = m_seg_stream->index;
+  if (av_interleaved_write_frame(m_seg_ctx, pkt) < 0)
+    return false;
+  m_seg_packets++;
+  return true;
+}
+
+bool ExportCheckpoint::finish(int64_t endPts, double endTime) {
+  if (!closeSegment(m_seg_packets > 0, endPts, endTime))
+    return false;
+  if (m_segments.empty() || !appendJournal("complete\n"))
+    return false;
+  m_complete = true;
+  return true;
+}
+
+void ExportCheckpoint::abandon() { closeSegment(false, 0, 0); }
+
+bool ExportCheckpoint::concatenate(const char *outputPath, int timescale,
+                                   const AVIOInterruptCB *int_cb) const {
+  std::vector<std::string> inputs;
+  for (size_t i = 0; i < m_segments.size(); i++)
+    inputs.push_back(segmentPath(i));
+  return concat_mov_segments(inputs, outputPath, timescale, int_cb);
+}
+
+void ExportCheckpoint::remove() {
+  abandon();
+  m_segments.clear();
+  m_complete = false;
+  m_frame_times.clear();
+  removeDirectory(m_dir);
+}
+
+void ExportCheckpoint::removeDirectory(const std::string &directory) {
+  std::error_code ec;
+  if (!fs::is_directory(directory, ec))
+    return;
+
+  // Only touch files we created; the directory may be shared.
+  for (const auto &entry : fs::directory_iterator(directory, ec)) {
+    std::string name = entry.path().filename().string();
+    if (name.rfind("seg_", 0) == 0 || name.rfind(kJournalName, 0) == 0)
+      fs::remove(entry.path(), ec);
+  }
+  fs::remove(directory, ec); // Fails harmlessly if not empty
+}
@@ -0,0 +1,91 @@
+#ifndef EXPORT_CHECKPOINT_HPP
+#define EXPORT_CHECKPOINT_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+struct AVCodecContext;
+struct AVFormatContext;
+struct AVIOInterruptCB;
+struct AVPacket;
+struct AVStream;
+
+// Concatenates MOV/MP4 files holding a single video stream into one MOV,
+// rebasing timestamps so the segments play back to back. The first input's
+// codec parameters (and hvcC extradata) describe the whole output.
+bool concat_mov_segments(const std::vector<std::string> &inputs,
+                         const char *outputPath, int timescale,
+                         const AVIOInterruptCB *int_cb);
+
+// Writes an export as a series of closed-GOP segment files plus a journal so
+// an interrupted export can pick up at the last completed GOP.
+//
+// Layout of the checkpoint directory:
+//   journal.txt        header (source identity, settings key) followed by one
+//                      "segment <index> <next_pts> <next_time>" line per
+//                      committed segment, and "complete" once encoding ends.
+//   seg_00000.mov ...  one closed GOP per file, timestamps in encoder units.
+//
+// A segment is committed (renamed from *.part and journaled with fsync) only
+// once the encoder emits the key packet that starts the next GOP, so every
+// journaled segment is independently decodable.
+class ExportCheckpoint {
+public:
+  explicit ExportCheckpoint(const std::string &directory);
+  ~ExportCheckpoint();
+
+  // Loads a journal written for the same source and settings, or starts a
+  // fresh one (discarding stale segments). Returns false on I/O failure.
+  bool open(const std::string &sourceIdentity, const std::string &settingsKey);
+
+  bool isResuming() const { return !m_segments.empty(); }
+  bool isComplete() const { return m_complete; }
+  // Output frame index and source time the next segment starts at.
+  int64_t resumePts() const;
+  double resumeTime() const;
+
+  // Remembers which source time produced output frame `pts`, so the resume
+  // point of each segment can be journaled.
+  void noteFrame(int64_t pts, double sourceTime);
+
+  // Takes packets in encoder time base; starts a new segment at each key
+  // packet.
+  bool writePacket(AVPacket *pkt, const AVCodecContext *enc_ctx,
+                   int timescale);
+  // Commits the last segment after the encoder has been flushed.
+  bool finish(int64_t endPts, double endTime);
+  // Drops the in-progress segment (operation cancelled).
+  void abandon();
+
+  bool concatenate(const char *outputPath, int timescale,
+                   const AVIOInterruptCB *int_cb) const;
+  // Deletes all segments and the journal.
+  void remove();
+
+  static void removeDirectory(const std::string &directory);
+
+private:
+  struct Segment {
+    int64_t nextPts;
+    double nextTime;
+  };
+
+  std::string segmentPath(size_t index) const;
+  std::string journalPath() const;
+  bool openSegment(const AVCodecContext *enc_ctx, int timescale);
+  bool closeSegment(bool commit, int64_t nextPts, double nextTime);
+  bool appendJournal(const char *line);
+
+  std::string m_dir;
+  std::vector<Segment> m_segments;
+  bool m_complete = false;
+  std::map<int64_t, double> m_frame_times;
+
+  AVFormatContext *m_seg_ctx = nullptr;
+  AVStream *m_seg_stream = nullptr;
+  int64_t m_seg_packets = 0;
+};
+
+#endif
@@ -1,7 +1,27 @@
 #include "WebMSupportCpp/FFmpegWrapper.hpp"
 #include "WebMSupportCpp/FFmpegWrapperC.h"
+#include "ChromaDownsampler.hpp"
+#include "CropDetect.hpp"
+#include "DecodedFrameCache.hpp"
+#include "DuplicateDetector.hpp"
+#include "EncodedGopCache.hpp"
+#include "ExportCheckpoint.hpp"
+#include "FileIdentity.hpp"
+#include "GrowingFileInput.hpp"
+#include "LoopSeam.hpp"
+#include "MemoryBudget.hpp"
+#include "PlaybackBudget.hpp"
+#include "QualityMeter.hpp"
+#include "ReverseFrameSource.hpp"
+#include "SharedFrameRing.hpp"
+#include "TraceRecorder.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <string>
 
 extern "C" {
@@ -25,9 +45,17 @@ static void init_ffmpeg() {
   }
 }
 
+// AVIOInterruptCB hook: lets stop() abort reads blocked inside the demuxer.
+static int interrupt_cb(void *opaque) {
+  return ((const FFmpegWrapper *)opaque)->isStopRequested() ? 1 : 0;
+}
+
+// `in_pix_fmt` is the format frames enter the graph in, normally the
+// decoder's.
 static int init_filter_graph(AVFilterGraph **graph, AVFilterContext **src,
                              AVFilterContext **sink, const char *filters_descr,
-                             AVCodecContext *dec_ctx, AVCodecContext *enc_ctx) {
+                             AVCodecContext *dec_ctx, AVCodecContext *enc_ctx,
+                             int in_pix_fmt, int nb_threads) {
   char args[512];
   int ret = 0;
   AVFilterGraph *filter_graph = avfilter_graph_alloc();
@@ -37,9 +65,12 @@ static int init_filter_graph(AVFilterGraph **graph, AVFilterContext **src,
     return ret;
   }
 
+  // Must be set before any filter is added (0 = one per core)
+  filter_graph->nb_threads = nb_threads;
+
   snprintf(args, sizeof(args),
            "video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:pixel_aspect=%d/%d",
-           dec_ctx->width, dec_ctx->height, dec_ctx->pix_fmt,
+           dec_ctx->width, dec_ctx->height, in_pix_fmt,
            dec_ctx->time_base.num, dec_ctx->time_base.den,
            dec_ctx->sample_aspect_ratio.num, dec_ctx->sample_aspect_ratio.den);
 
@@ -100,12 +131,104 @@ static int init_filter_graph(AVFilterGraph **graph, AVFilterContext **src,
   return 0;
 }
 
+static int bytes_per_sample(int pix_fmt) {
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((AVPixelFormat)pix_fmt);
+  return (desc && desc->comp[0].depth > 8) ? 2 : 1;
+}
+
+// Memory plan for transcoding `par` at `target_height` (0 = source height).
+static MemoryPlan plan_for_stream(const AVCodecParameters *par, int64_t budget,
+                                  int target_height, bool ten_bit,
+                                  bool float_filters) {
+  MemoryBudgetInput input;
+  input.budgetBytes = budget;
+  input.decodeWidth = par->width;
+  input.decodeHeight = par->height;
+  input.decodeBytesPerSample = bytes_per_sample(par->format);
+  input.encodeWidth = par->width;
+  input.encodeHeight = par->height;
+  if (target_height > 0 && par->height > target_height) {
+    input.encodeWidth =
+        ((int)((int64_t)par->width * target_height / par->height)) & ~1;
+    input.encodeHeight = target_height;
+  }
+  input.tenBitOutput = ten_bit;
+  input.floatFilters = float_filters;
+  return plan_memory_budget(input);
+}
+
+// Copies a software frame into the preview ring; drops silently when the
+// consumer is behind.
+static void publish_preview(SharedFrameRing *ring, const AVFrame *frame,
+                            double source_time) {
+  const AVPixFmtDescriptor *desc =
+      av_pix_fmt_desc_get((AVPixelFormat)frame->format);
+  if (!desc || (desc->flags & AV_PIX_FMT_FLAG_HWACCEL))
+    return;
+  SharedFrameRing::Frame out = {};
+  out.width = frame->width;
+  out.height = frame->height;
+  out.format = frame->format;
+  out.planeCount = std::min(av_pix_fmt_count_planes((AVPixelFormat)frame->format),
+                            (int)SharedFrameRing::kMaxPlanes);
+  for (int p = 0; p < out.planeCount; p++) {
+    out.planes[p] = frame->data[p];
+    out.strides[p] = frame->linesize[p];
+    out.rows[p] = (p == 1 || p == 2)
+                      ? AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h)
+                      : frame->height;
+  }
+  out.timestampNs = llround(source_time * 1e9);
+  ring->publish(out);
+}
+
+// True if `name` exists and accepts an 8-bit 4:2:0 stream of this size.
+// VideoToolbox refuses sizes beyond the hardware's limits at open time.
+static bool encoder_opens(const char *name, int width, int height) {
+  const AVCodec *codec = avcodec_find_encoder_by_name(name);
+  if (!codec || width <= 0 || height <= 0)
+    return false;
+  AVCodecContext *ctx = avcodec_alloc_context3(codec);
+  if (!ctx)
+    return false;
+  ctx->width = width & ~1;
+  ctx->height = height & ~1;
+  ctx->pix_fmt = AV_PIX_FMT_NV12;
+  ctx->time_base = {1, 30};
+  bool ok = avcodec_open2(ctx, codec, nullptr) >= 0;
+  avcodec_free_context(&ctx);
+  return ok;
+}
+
 FFmpegWrapper::FFmpegWrapper(const char *path)
+    : FFmpegWrapper(path, nullptr, false) {}
+
+FFmpegWrapper::FFmpegWrapper(const char *path, const char *completionMarker)
+    : FFmpegWrapper(path, completionMarker, true) {}
+
+FFmpegWrapper::FFmpegWrapper(const char *path, const char *completionMarker,
+                             bool growing)
     : m_fmt_ctx(nullptr), m_dec_ctx(nullptr), m_frame(nullptr), m_pkt(nullptr),
-      m_video_stream_idx(-1), m_decoder_initialized(false) {
+      m_video_stream_idx(-1), m_decoder_initialized(false),
+      m_path(path ? path : ""),
+      m_frame_cache(new DecodedFrameCache(256LL << 20)) {
 
   init_ffmpeg();
 
+  m_fmt_ctx = avformat_alloc_context();
+  if (!m_fmt_ctx)
+    return;
+  m_fmt_ctx->interrupt_callback.callback = interrupt_cb;
+  m_fmt_ctx->interrupt_callback.opaque = this;
+
+  if (growing) {
+    m_growing_input.reset(
+        GrowingFileInput::open(path, completionMarker, &m_should_stop));
+    if (!m_growing_input)
+      return;
+    m_fmt_ctx->pb = m_growing_input->avio();
+  }
+
   if (avformat_open_input(&m_fmt_ctx, path, nullptr, nullptr) < 0) {
     return;
   }
@@ -136,6 +259,7 @@ void FFmpegWrapper::cleanup() {
     avformat_close_input(&m_fmt_ctx);
     m_fmt_ctx = nullptr;
   }
+  m_growing_input.reset(); // Custom AVIO outlives the format context
   if (m_frame) {
     av_frame_free(&m_frame);
     m_frame = nullptr;
@@ -150,8 +274,97 @@ FFmpegWrapper *FFmpegWrapper::create(const char *path) {
   return new FFmpegWrapper(path);
 }
 
+void FFmpegWrapper::markInputComplete() {
+  if (m_growing_input)
+    m_growing_input->markComplete();
+}
+
 void FFmpegWrapper::destroy(FFmpegWrapper *wrapper) { delete wrapper; }
 
+void FFmpegWrapper::stop() {
+  m_should_stop = true;
+  // Wake a paused transcode so it can observe the stop request.
+  std::lock_guard<std::mutex> lock(m_pause_mutex);
+  for (FFmpegWrapper *child : m_children)
+    child->stop();
+  m_pause_cv.notify_all();
+}
+
+void FFmpegWrapper::pause() {
+  m_paused = true;
+  std::lock_guard<std::mutex> lock(m_pause_mutex);
+  for (FFmpegWrapper *child : m_children)
+    child->pause();
+}
+
+void FFmpegWrapper::resume() {
+  std::lock_guard<std::mutex> lock(m_pause_mutex);
+  m_paused = false;
+  for (FFmpegWrapper *child : m_children)
+    child->resume();
+  m_pause_cv.notify_all();
+}
+
+void FFmpegWrapper::adoptClip(FFmpegWrapper *clip) {
+  clip->m_memory_budget = m_memory_budget;
+  // Spans are recorded globally while our session is open; a clip's own
+  // sessions only nest in it.
+  clip->m_trace_path = m_trace_path;
+  clip->m_trace_depth = 1;
+  clip->m_owns_stop = false;
+  std::lock_guard<std::mutex> lock(m_pause_mutex);
+  clip->m_should_stop = m_should_stop.load();
+  clip->m_paused = m_paused.load();
+  m_children.push_back(clip);
+}
+
+void FFmpegWrapper::waitWhilePaused() {
+  if (!m_paused)
+    return;
+  std::unique_lock<std::mutex> lock(m_pause_mutex);
+  m_pause_cv.wait(lock, [this] { return !m_paused || m_should_stop; });
+}
+
+void FFmpegWrapper::setCheckpointDirectory(const char *dir) {
+  m_checkpoint_dir = dir ? dir : "";
+}
+
+void FFmpegWrapper::discardCheckpoint() {
+  if (!m_checkpoint_dir.empty())
+    ExportCheckpoint::removeDirectory(m_checkpoint_dir);
+}
+
+void FFmpegWrapper::setGopCacheDirectory(const char *dir,
+                                         int64_t capacityBytes) {
+  m_gop_cache_dir = dir ? dir : "";
+  m_gop_cache_capacity = capacityBytes;
+}
+
+std::string FFmpegWrapper::settingsKey(const TranscodeSettings &settings) {
+  // Everything that changes the encoded bitstream or the trimmed range.
+  char buf[256];
+  snprintf(buf, sizeof(buf),
+           "%s|%d|%d|%lld|%d|%d|%d|%d|%d|%d|%d|%d|%d,%d,%d,%d|%dx%d|%d|%d|"
+           "%.6f|%.6f|",
+           settings.encoderName ? settings.encoderName : "", settings.targetHeight,
+           settings.targetFps, (long long)settings.bitrate, settings.profile,
+           settings.timescale, settings.tonemap, settings.tenBit,
+           settings.useFilterGraph, settings.intraOnly, settings.autoCrop,
+           settings.dropDuplicates, settings.crop.x, settings.crop.y,
+           settings.crop.width, settings.crop.height, settings.fitWidth,
+           settings.fitHeight, settings.exactFps, settings.playbackBudget,
+           settings.startTime, settings.endTime);
+  std::string key = buf;
+  key += settings.x265Params ? settings.x265Params : "";
+  key += "|";
+  key += settings.preset ? settings.preset : "";
+  key += "|";
+  key += settings.crf ? settings.crf : "";
+  key += "|";
+  key += settings.tune ? settings.tune : "";
+  return to_hex64(fnv1a_64(key));
+}
+
 bool FFmpegWrapper::isOpen() const {
   return m_fmt_ctx != nullptr && m_video_stream_idx != -1;
 }
@@ -182,9 +395,23 @@ const char *FFmpegWrapper::getCodecName() const {
   return desc ? desc->name : "unknown";
 }
 
-bool FFmpegWrapper::initDecoder() {
-  if (m_decoder_initialized)
-    return true;
+bool FFmpegWrapper::initDecoder() { return openDecoder(m_decode_tier); }
+
+void FFmpegWrapper::closeDecoder() {
+  if (m_dec_ctx)
+    avcodec_free_context(&m_dec_ctx);
+  m_decoder_initialized = false;
+}
+
+bool FFmpegWrapper::openDecoder(DecodeTier tier) {
+  if (m_decoder_initialized) {
+    if (tier == m_decoder_tier)
+      return true;
+    // Skip/lowres options only take effect in avcodec_open2. Cached pictures
+    // were decoded at the old fidelity.
+    closeDecoder();
+    m_frame_cache->clear();
+  }
   if (!isOpen())
     return false;
 
@@ -219,7 +446,8 @@ bool FFmpegWrapper::initDecoder() {
   if (!codec)
     return false;
 
-  printf("[FFmpegWrapper] Using decoder: %s\n", codec->name);
+  printf("[FFmpegWrapper] Using decoder: %s (%s tier)\n", codec->name,
+         tier == DecodeTier::Preview ? "preview" : "final");
 
   m_dec_ctx = avcodec_alloc_context3(codec);
   if (avcodec_parameters_to_context(m_dec_ctx, params) < 0)
@@ -230,19 +458,48 @@ bool FFmpegWrapper::initDecoder() {
   m_dec_ctx->framerate = av_guess_frame_rate(
       m_fmt_ctx, m_fmt_ctx->streams[m_video_stream_idx], nullptr);
 
-  // Multi-threading
-  m_dec_ctx->thread_count = 0;
-  m_dec_ctx->thread_type = FF_THREAD_FRAME;
+  // Multi-threading (narrowed by the memory budget, if any)
+  m_dec_ctx->thread_count = m_decoder_threads;
+  m_dec_ctx->thread_type =
+      m_decoder_frame_threads ? FF_THREAD_FRAME : FF_THREAD_SLICE;
+
+  AVDictionary *opts = nullptr;
+  if (tier == DecodeTier::Preview) {
+    // Nothing references non-reference frames, so dropping them is safe.
+    // Skipping the loop filter is not: reference pictures differ from the
+    // encoder's, and the error drifts through inter frames until the next
+    // keyframe. Acceptable for a throwaway preview only.
+    m_dec_ctx->skip_frame = AVDISCARD_NONREF;
+    m_dec_ctx->skip_loop_filter = AVDISCARD_ALL;
+    m_dec_ctx->flags2 |= AV_CODEC_FLAG2_FAST;
+    // AV1 film grain is exported as side data instead of being synthesized.
+    m_dec_ctx->export_side_data |= AV_CODEC_EXPORT_DATA_FILM_GRAIN;
+
+    // None of the long-GOP codecs we ship support lowres, but honor it for
+    // those that do (e.g. MJPEG screen captures).
+    if (codec->max_lowres > 0 && params->height > 1080)
+      m_dec_ctx->lowres = 1;
+
+    if (strcmp(codec->name, "libdav1d") == 0) {
+      // dav1d's automatic frame delay (up to 8 frames in flight) favors
+      // throughput; scrubbing wants the first picture back quickly.
+      av_dict_set(&opts, "max_frame_delay", "2", 0);
+    }
+  }
 
-  if (avcodec_open2(m_dec_ctx, codec, nullptr) < 0)
+  int ret = avcodec_open2(m_dec_ctx, codec, &opts);
+  av_dict_free(&opts);
+  if (ret < 0)
     return false;
 
+  m_decoder_tier = tier;
   m_decoder_initialized = true;
   return true;
 }
 
 VideoFrameInfo FFmpegWrapper::decodeNextFrame() {
   VideoFrameInfo info = {0};
+  OperationScope operation(this);
   if (!initDecoder())
     return info;
 
@@ -254,19 +511,8 @@ VideoFrameInfo FFmpegWrapper::decodeNextFrame() {
         continue;
 
       ret = avcodec_receive_frame(m_dec_ctx, m_frame);
-      if (ret == 0) {
-        info.width = m_frame->width;
-        info.height = m_frame->height;
-        for (int i = 0; i < 3; i++) {
-          info.planes[i] = m_frame->data[i];
-          info.strides[i] = m_frame->linesize[i];
-        }
-        info.timestamp_ns = av_rescale_q(
-            m_frame->pts, m_fmt_ctx->streams[m_video_stream_idx]->time_base,
-            {1, 1000000000});
-        info.is_key = (m_frame->flags & AV_FRAME_FLAG_KEY);
-        return info;
-      }
+      if (ret == 0)
+        return currentFrameInfo();
     } else {
       av_packet_unref(m_pkt);
     }
@@ -274,19 +520,272 @@ VideoFrameInfo FFmpegWrapper::decodeNextFrame() {
   return info;
 }
 
+VideoFrameInfo FFmpegWrapper::currentFrameInfo() const {
+  VideoFrameInfo info = {0};
+  if (!m_frame->buf[0])
+    return info;
+  info.width = m_frame->width;
+  info.height = m_frame->height;
+  info.format = m_frame->format;
+  for (int i = 0; i < 3; i++) {
+    info.planes[i] = m_frame->data[i];
+    info.strides[i] = m_frame->linesize[i];
+  }
+  info.timestamp_ns = av_rescale_q(
+      m_frame->pts, m_fmt_ctx->streams[m_video_stream_idx]->time_base,
+      {1, 1000000000});
+  info.is_key = (m_frame->flags & AV_FRAME_FLAG_KEY);
+  return info;
+}
+
+void FFmpegWrapper::setFrameCacheCapacity(int64_t bytes) {
+  m_frame_cache->setCapacity(bytes);
+}
+
+VideoFrameInfo FFmpegWrapper::frameAt(double time) {
+  if (!isOpen())
+    return VideoFrameInfo{};
+  AVRational tb = m_fmt_ctx->streams[m_video_stream_idx]->time_base;
+  return seekToFrame(llround(time / av_q2d(tb)));
+}
+
+VideoFrameInfo FFmpegWrapper::seekToFrame(int64_t pts) {
+  OperationScope operation(this);
+  // Frame-accurate access needs every reference picture exactly as encoded.
+  if (!openDecoder(DecodeTier::Final))
+    return VideoFrameInfo{};
+
+  if (const AVFrame *cached = m_frame_cache->lookup(pts)) {
+    av_frame_unref(m_frame);
+    if (av_frame_ref(m_frame, cached) < 0)
+      return VideoFrameInfo{};
+    return currentFrameInfo();
+  }
+
+  if (!decodeGopsAround(pts))
+    return VideoFrameInfo{};
+  return currentFrameInfo();
+}
+
+// Decodes from the keyframe at or before `target` until the GOP containing it
+// is complete, caching each finished GOP. Leaves the picture on screen at
+// `target` in m_frame; it is valid even when its GOP was too big to cache.
+bool FFmpegWrapper::decodeGopsAround(int64_t target) {
+  if (av_seek_frame(m_fmt_ctx, m_video_stream_idx, target,
+                    AVSEEK_FLAG_BACKWARD) < 0 &&
+      av_seek_frame(m_fmt_ctx, m_video_stream_idx, target, 0) < 0)
+    return false;
+  avcodec_flush_buffers(m_dec_ctx);
+  av_frame_unref(m_frame);
+
+  std::vector<AVFrame *> gop;
+  int64_t gop_start = AV_NOPTS_VALUE;
+  int64_t gop_bytes = 0;
+  bool oversized = false;
+  bool done = false;
+
+  auto drop_gop = [&]() {
+    for (AVFrame *frame : gop)
+      av_frame_free(&frame);
+    gop.clear();
+    gop_bytes = 0;
+  };
+
+  auto close_gop = [&](int64_t end_pts) {
+    if (!oversized && !gop.empty())
+      m_frame_cache->insert(gop_start, end_pts, std::move(gop));
+    gop.clear();
+    drop_gop();
+    oversized = false;
+    if (end_pts > target)
+      done = true;
+  };
+
+  // Frames arrive in presentation order, so a key frame cleanly separates
+  // one GOP from the next.
+  auto take_frame = [&](AVFrame *frame) {
+    frame->pts = frame->best_effort_timestamp;
+    if (frame->pts == AV_NOPTS_VALUE)
+      return;
+    if (frame->flags & AV_FRAME_FLAG_KEY) {
+      if (gop_start != AV_NOPTS_VALUE)
+        close_gop(frame->pts);
+      if (done)
+        return;
+      gop_start = frame->pts;
+    }
+    // Leading pictures of the GOP we landed in reference frames we skipped.
+    if (gop_start == AV_NOPTS_VALUE || frame->pts < gop_start)
+      return;
+
+    if (frame->pts <= target || !m_frame->buf[0]) {
+      av_frame_unref(m_frame);
+      av_frame_ref(m_frame, frame);
+    }
+
+    if (oversized)
+      return;
+    int64_t bytes = DecodedFrameCache::frameBytes(frame);
+    if (gop_bytes + bytes > m_frame_cache->capacity()) {
+      oversized = true;
+      drop_gop();
+      return;
+    }
+    AVFrame *copy = av_frame_clone(frame);
+    if (!copy)
+      return;
+    gop.push_back(copy);
+    gop_bytes += bytes;
+  };
+
+  AVFrame *dec_frame = av_frame_alloc();
+  while (!done && !m_should_stop) {
+    if (av_read_frame(m_fmt_ctx, m_pkt) < 0) {
+      // End of stream: the last GOP runs to the end.
+      avcodec_send_packet(m_dec_ctx, nullptr);
+      while (avcodec_receive_frame(m_dec_ctx, dec_frame) == 0) {
+        take_frame(dec_frame);
+        av_frame_unref(dec_frame);
+      }
+      if (gop_start != AV_NOPTS_VALUE)
+        close_gop(INT64_MAX);
+      break;
+    }
+    if (m_pkt->stream_index == m_video_stream_idx &&
+        avcodec_send_packet(m_dec_ctx, m_pkt) == 0) {
+      while (!done && avcodec_receive_frame(m_dec_ctx, dec_frame) == 0) {
+        take_frame(dec_frame);
+        av_frame_unref(dec_frame);
+      }
+    }
+    av_packet_unref(m_pkt);
+  }
+  av_frame_free(&dec_frame);
+  drop_gop();
+
+  return m_frame->buf[0] != nullptr;
+}
+
+// Decodes the first picture at or after the keyframe preceding `time` into
+// m_frame. Cheaper than an exact seek; used where any nearby frame will do.
+bool FFmpegWrapper::decodeFrameNear(double time) {
+  AVRational tb = m_fmt_ctx->streams[m_video_stream_idx]->time_base;
+  if (av_seek_frame(m_fmt_ctx, m_video_stream_idx, llround(time / av_q2d(tb)),
+                    AVSEEK_FLAG_BACKWARD) < 0)
+    return false;
+  avcodec_flush_buffers(m_dec_ctx);
+
+  while (av_read_frame(m_fmt_ctx, m_pkt) >= 0) {
+    bool sent = m_pkt->stream_index == m_video_stream_idx &&
+                avcodec_send_packet(m_dec_ctx, m_pkt) == 0;
+    av_packet_unref(m_pkt);
+    if (sent && avcodec_receive_frame(m_dec_ctx, m_frame) == 0)
+      return true;
+    if (m_should_stop)
+      return false;
+  }
+  return false;
+}
+
+bool FFmpegWrapper::detectCrop(double startTime, double endTime,
+                               CropRect *rect) {
+  OperationScope operation(this);
+  if (!m_decoder_initialized && !openDecoder(DecodeTier::Final))
+    return false;
+
+  double end = endTime > 0 ? endTime : getDuration();
+  if (end <= startTime)
+    end = startTime + 1;
+
+  // Midpoints of equal spans, so fades at either end weigh less.
+  const int kSamples = 8;
+  std::unique_ptr<CropDetector> detector;
+  for (int i = 0; i < kSamples && !m_should_stop; i++) {
+    double t = startTime + (end - startTime) * (i + 0.5) / kSamples;
+    if (!decodeFrameNear(t))
+      continue;
+
+    const AVPixFmtDescriptor *desc =
+        av_pix_fmt_desc_get((AVPixelFormat)m_frame->format);
+    // Samples must sit in the low bits (P010 and friends store them MSB
+    // aligned).
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_HWACCEL)) ||
+        !(desc->flags & AV_PIX_FMT_FLAG_PLANAR) || desc->nb_components < 3 ||
+        desc->comp[0].shift != 0) {
+      printf("[FFmpegWrapper] Crop detection skipped: unsupported format %s\n",
+             desc ? desc->name : "unknown");
+      break;
+    }
+    // Semi-planar formats (NV12) interleave U and V in one plane, which the
+    // detector would read as planar chroma; judge those on luma alone.
+    bool semi_planar = desc->comp[1].plane == desc->comp[2].plane;
+    if (!detector) {
+      bool full_range = m_frame->color_range == AVCOL_RANGE_JPEG ||
+                        strncmp(desc->name, "yuvj", 4) == 0;
+      detector.reset(new CropDetector(m_frame->width, m_frame->height,
+                                      desc->comp[0].depth, desc->log2_chroma_w,
+                                      desc->log2_chroma_h, full_range));
+    }
+    const uint8_t *planes[3] = {m_frame->data[0],
+                                semi_planar ? nullptr : m_frame->data[1],
+                                semi_planar ? nullptr : m_frame->data[2]};
+    int strides[3] = {m_frame->linesize[0], m_frame->linesize[1],
+                      m_frame->linesize[2]};
+    detector->addFrame(planes, strides);
+  }
+
+  // Leave the demuxer where a fresh open would.
+  av_seek_frame(m_fmt_ctx, -1, 0, AVSEEK_FLAG_BACKWARD);
+  avcodec_flush_buffers(m_dec_ctx);
+
+  if (!detector || !detector->result(rect))
+    return false;
+  printf("[FFmpegWrapper] Detected crop %dx%d+%d+%d from %d frames\n",
+         rect->width, rect->height, rect->x, rect->y, detector->framesUsed());
+  return true;
+}
+
 bool FFmpegWrapper::prepareToMov(const char *outputPath, double startTime,
                                  double endTime, ProgressCallback cb,
                                  void *user_data) {
+  if (!isOpen())
+    return false;
+
+  bool software = m_preview_engine == PreviewEngine::Software;
+  if (m_preview_engine == PreviewEngine::Auto &&
+      !encoder_opens("hevc_videotoolbox", getWidth(), getHeight())) {
+    printf("[FFmpegWrapper] VideoToolbox unavailable for %dx%d, using "
+           "software preview\n",
+           getWidth(), getHeight());
+    software = true;
+  }
+
   TranscodeSettings settings;
-  settings.encoderName = "hevc_videotoolbox";
-  settings.targetHeight = 0; // Use original resolution
-  settings.targetFps = 0;    // Use original frame rate
-  settings.bitrate = 10000000;
-  settings.profile = AV_PROFILE_HEVC_MAIN;
-  settings.swsFlags = SWS_POINT;
-  settings.x265Params = nullptr;
-  settings.preset = nullptr;
-  settings.crf = nullptr;
+  if (software) {
+    // Preview quality only has to survive a thumbnail-sized player, so spend
+    // as little CPU as possible: fewer pixels, fewer frames, no lookahead.
+    settings.encoderName =
+        avcodec_find_encoder_by_name("libx264") ? "libx264" : "libx265";
+    settings.targetHeight = kSoftwarePreviewHeight;
+    settings.targetFps = kSoftwarePreviewFps;
+    settings.bitrate = 0;
+    settings.profile = -1;
+    settings.swsFlags = SWS_FAST_BILINEAR;
+    settings.x265Params = nullptr;
+    settings.preset = "ultrafast";
+    settings.crf = "26";
+    settings.tune = "zerolatency";
+  } else {
+    settings.encoderName = "hevc_videotoolbox";
+    settings.targetHeight = 0; // Use original resolution
+    settings.targetFps = 0;    // Use original frame rate
+    settings.bitrate = 10000000;
+    settings.profile = AV_PROFILE_HEVC_MAIN;
+    settings.swsFlags = SWS_POINT;
+    settings.x265Params = nullptr;
+    settings.preset = nullptr;
+    settings.crf = nullptr;
+  }
   settings.timescale = 0; // Let FFmpeg decide (Auto)
   settings.realtime = true;
   settings.tonemap = false;
@@ -296,7 +795,10 @@ bool FFmpegWrapper::prepareToMov(const char *outputPath, double startTime,
   settings.useFilterGraph =
       false; // Never use filters in prepare mode (keep it fast)
   settings.useStreamCopy = false;
-  return transcodeInternal(outputPath, settings, cb, user_data);
+  settings.decodeTier = m_decode_tier;
+  bool ok = transcodeInternal(outputPath, settings, cb, user_data);
+  m_last_stats.softwarePreview = software;
+  return ok;
 }
 
 bool FFmpegWrapper::remuxToMov(const char *outputPath, double startTime,
@@ -323,9 +825,40 @@ bool FFmpegWrapper::remuxToMov(const char *outputPath, double startTime,
   return transcodeInternal(outputPath, settings, cb, user_data);
 }
 
-bool FFmpegWrapper::exportToMov(const char *outputPath, double startTime,
-                                double endTime, ProgressCallback cb,
-                                void *user_data) {
+bool FFmpegWrapper::generateProxy(const char *outputPath, int targetHeight,
+                                  ProgressCallback cb, void *user_data) {
+  TranscodeSettings settings;
+  settings.encoderName = "libx264";
+  settings.targetHeight = targetHeight > 0 ? targetHeight : 540;
+  settings.targetFps = 0; // Every source frame must be addressable
+  settings.bitrate = 0;
+  settings.profile = -1;
+  settings.swsFlags = SWS_BILINEAR;
+  settings.x265Params = nullptr;
+  settings.preset = "ultrafast";
+  settings.crf = "23";
+  settings.tune = "fastdecode"; // CAVLC, no deblocking: cheapest to seek
+  settings.timescale = 0;
+  settings.realtime = true;
+  settings.tonemap = false;
+  settings.tenBit = false;
+  settings.startTime = 0;
+  settings.endTime = 0;
+  settings.useFilterGraph = false;
+  settings.useStreamCopy = false;
+  settings.decodeTier = DecodeTier::Final;
+  settings.intraOnly = true;
+  return transcodeInternal(outputPath, settings, cb, user_data);
+}
+
+std::string FFmpegWrapper::getFileIdentity() const {
+  return file_identity(m_path.c_str());
+}
+
+// Encoder settings shared by every x265 export; callers set the trim and
+// whatever they deliberately do differently. GOPs are closed so a later pass
+// (loop seam, concat) can cut the export at any keyframe and copy the rest.
+FFmpegWrapper::TranscodeSettings FFmpegWrapper::defaultExportSettings() const {
   TranscodeSettings settings;
   settings.encoderName = "libx265";
   settings.targetHeight = 0; // Original
@@ -334,44 +867,41 @@ bool FFmpegWrapper::exportToMov(const char *outputPath, double startTime,
   settings.profile = -1;
   settings.swsFlags = SWS_BICUBIC;
   settings.x265Params =
-      "keyint=60:min-keyint=60:scenecut=0:bframes=4:b-adapt=2:b-pyramid=1:temporal-layers=3";
+      "keyint=60:min-keyint=60:scenecut=0:bframes=4:b-adapt=2:b-pyramid=1:temporal-layers=3:open-gop=0";
   settings.preset = "medium";
   settings.crf = "18";
   settings.timescale = 240000;
   settings.realtime = false;
-  settings.tonemap =
-      false; // Default to false, detected in transcodeInternal or set via Ext
-  settings.tenBit = true; // Default export to 10-bit for quality
+  settings.tonemap = false; // Detected in transcodeInternal or set via Ext
+  settings.tenBit = true;   // 10-bit for quality
+  settings.startTime = 0;
+  settings.endTime = 0;
+  settings.useFilterGraph = true; // Filters (including HDR tone mapping)
+  settings.useStreamCopy = false;
+  settings.autoCrop = m_auto_crop;
+  settings.dropDuplicates = m_drop_duplicates;
+  settings.measureQuality = m_measure_quality;
+  settings.playbackBudget = m_playback_budget;
+  return settings;
+}
+
+bool FFmpegWrapper::exportToMov(const char *outputPath, double startTime,
+                                double endTime, ProgressCallback cb,
+                                void *user_data) {
+  TranscodeSettings settings = defaultExportSettings();
   settings.startTime = startTime;
   settings.endTime = endTime;
-  settings.useFilterGraph =
-      true; // Use filters (including HDR tone mapping) for export
-  settings.useStreamCopy = false;
   return transcodeInternal(outputPath, settings, cb, user_data);
 }
 
 bool FFmpegWrapper::exportToMovExt(const char *outputPath, double startTime,
                                    double endTime, bool tonemap, bool tenBit,
                                    ProgressCallback cb, void *user_data) {
-  TranscodeSettings settings;
-  settings.encoderName = "libx265";
-  settings.targetHeight = 0;
-  settings.targetFps = 0;
-  settings.bitrate = 0;
-  settings.profile = -1;
-  settings.swsFlags = SWS_BICUBIC;
-  settings.x265Params =
-      "keyint=60:min-keyint=60:scenecut=0:bframes=4:b-adapt=2:b-pyramid=1:temporal-layers=3";
-  settings.preset = "medium";
-  settings.crf = "18";
-  settings.timescale = 240000;
-  settings.realtime = false;
+  TranscodeSettings settings = defaultExportSettings();
   settings.tonemap = tonemap;
   settings.tenBit = tenBit;
   settings.startTime = startTime;
   settings.endTime = endTime;
-  settings.useFilterGraph = true;
-  settings.useStreamCopy = false;
   return transcodeInternal(outputPath, settings, cb, user_data);
 }
 
@@ -381,8 +911,33 @@ bool FFmpegWrapper::transcodeInternal(const char *outputPath,
                                       void *user_data) {
   if (!isOpen())
     return false;
-
-  m_should_stop = false;
+  TraceSession trace(m_trace_path, &m_trace_depth);
+  OperationScope operation(this);
+
+  bool software_encoder =
+      settings.encoderName && (strcmp(settings.encoderName, "libx265") == 0 ||
+                               strcmp(settings.encoderName, "libx264") == 0);
+  if (!m_gop_cache_dir.empty() && !settings.gopUnits && software_encoder &&
+      !settings.realtime && !settings.intraOnly && !settings.useStreamCopy &&
+      !settings.blendFrames && !settings.reverseFrames)
+    return exportWithGopCache(outputPath, settings, progressCallback,
+                              user_data);
+
+  m_last_stats = TranscodeStats();
+  m_last_stats.memoryBudgetBytes = m_memory_budget;
+  m_frame_quality.clear();
+  ResidentMemorySampler memory;
+  memory.start();
+  auto started_at = std::chrono::steady_clock::now();
+  auto record_stats = [&]() {
+    memory.sample();
+    m_last_stats.peakResidentBytes = memory.peakBytes();
+    m_last_stats.peakMemoryBytes = memory.peakGrowthBytes();
+    m_last_stats.elapsedSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                      started_at)
+            .count();
+  };
 
   AVFormatContext *out_fmt_ctx = nullptr;
   if (avformat_alloc_output_context2(&out_fmt_ctx, nullptr, nullptr,
@@ -435,7 +990,19 @@ bool FFmpegWrapper::transcodeInternal(const char *outputPath,
             : asset_duration_sec;
     double duration_sec = effective_end - settings.startTime;
 
-    while (av_read_frame(m_fmt_ctx, pkt) >= 0) {
+    // Only AVERROR_EOF ends the input; anything else (a stalled download,
+    // an I/O error) leaves the output truncated.
+    bool read_failed = false;
+    while (true) {
+      int read = av_read_frame(m_fmt_ctx, pkt);
+      if (read < 0) {
+        if (read != AVERROR_EOF && !m_should_stop) {
+          printf("[FFmpegWrapper] Remux: read failed (%d)\n", read);
+          read_failed = true;
+        }
+        break;
+      }
+      waitWhilePaused();
       if (m_should_stop) {
         av_packet_unref(pkt);
         break;
@@ -456,7 +1023,10 @@ bool FFmpegWrapper::transcodeInternal(const char *outputPath,
         pkt->pos = -1;
         pkt->stream_index = 0;
 
-        av_interleaved_write_frame(out_fmt_ctx, pkt);
+        {
+          TraceSpan span("write");
+          av_interleaved_write_frame(out_fmt_ctx, pkt);
+        }
 
         if (progressCallback && duration_sec > 0) {
           double progress = (current_time - settings.startTime) / duration_sec;
@@ -473,15 +1043,97 @@ bool FFmpegWrapper::transcodeInternal(const char *outputPath,
       avio_closep(&out_fmt_ctx->pb);
     }
     avformat_free_context(out_fmt_ctx);
-    return true;
+    record_stats();
+    return !read_failed;
   }
   // --- END FAST PATH ---
 
-  if (!initDecoder()) {
+  // --- MEMORY BUDGET ---
+  AVCodecParameters *in_par = m_fmt_ctx->streams[m_video_stream_idx]->codecpar;
+  bool float_filters = settings.useFilterGraph &&
+                       (settings.tonemap ||
+                        in_par->color_trc == AVCOL_TRC_SMPTE2084 ||
+                        in_par->color_trc == AVCOL_TRC_ARIB_STD_B67);
+  MemoryPlan plan = plan_for_stream(in_par, m_memory_budget,
+                                    settings.targetHeight, settings.tenBit,
+                                    float_filters);
+  int decoder_threads = m_memory_budget > 0 ? plan.decoderThreads : 0;
+  bool decoder_frame_threads =
+      m_memory_budget > 0 ? plan.decoderFrameThreads : true;
+  if (m_decoder_initialized && (decoder_threads != m_decoder_threads ||
+                                decoder_frame_threads != m_decoder_frame_threads)) {
+    // Threading is fixed once the decoder is open.
+    closeDecoder();
+  }
+  m_decoder_threads = decoder_threads;
+  m_decoder_frame_threads = decoder_frame_threads;
+  if (m_memory_budget > 0) {
+    printf("[FFmpegWrapper] Memory budget %lld MB (estimate %lld MB%s): "
+           "decoder %d %s threads, x265 frame-threads=%d rc-lookahead=%d "
+           "pools=%d, filter threads %d\n",
+           (long long)(m_memory_budget >> 20),
+           (long long)(plan.estimatedBytes >> 20),
+           plan.withinBudget ? "" : ", over budget", plan.decoderThreads,
+           plan.decoderFrameThreads ? "frame" : "slice", plan.x265FrameThreads,
+           plan.x265RcLookahead, plan.x265Pools, plan.filterThreads);
+  }
+  m_last_stats.estimatedMemoryBytes = plan.estimatedBytes;
+  m_last_stats.decoderThreads = plan.decoderThreads;
+  m_last_stats.encoderFrameThreads = plan.x265FrameThreads;
+  m_last_stats.encoderRcLookahead = plan.x265RcLookahead;
+  m_last_stats.encoderLookaheadSlices = plan.x265LookaheadSlices;
+  m_last_stats.filterThreads = plan.filterThreads;
+  // ---------------------
+
+  if (!openDecoder(settings.decodeTier)) {
     avformat_free_context(out_fmt_ctx);
     return false;
   }
 
+  // --- CHECKPOINTING ---
+  // Offline exports only: realtime previews are cheap to redo and hardware
+  // encoders don't guarantee the closed GOPs segments rely on. Reverse
+  // passes have no source position to resume from, and a loop seam's
+  // crossfade weights depend on how far into the fade it is, which the
+  // journal doesn't record (nor does its key tell it from a plain export).
+  std::unique_ptr<ExportCheckpoint> checkpoint;
+  if (!m_checkpoint_dir.empty() && !settings.realtime && !settings.gopUnits &&
+      !settings.reverseFrames && !settings.blendFrames) {
+    checkpoint.reset(new ExportCheckpoint(m_checkpoint_dir));
+    if (!checkpoint->open(file_identity(m_path.c_str()),
+                          settingsKey(settings))) {
+      printf("[FFmpegWrapper] Warning: Checkpoint directory unusable, "
+             "exporting without checkpoints\n");
+      checkpoint.reset();
+    }
+  }
+
+  if (checkpoint && checkpoint->isComplete()) {
+    // A previous run encoded everything but never produced the output.
+    bool ok = checkpoint->concatenate(outputPath, settings.timescale,
+                                      &m_fmt_ctx->interrupt_callback);
+    if (ok)
+      checkpoint->remove();
+    avformat_free_context(out_fmt_ctx);
+    return ok;
+  }
+  // ---------------------
+
+  // --- CROP DETECTION ---
+  CropRect crop = {0, 0, m_dec_ctx->width, m_dec_ctx->height};
+  bool cropping = false;
+  if (settings.crop.width > 0) {
+    crop = settings.crop;
+    cropping = true;
+  } else if (settings.autoCrop) {
+    cropping = detectCrop(settings.startTime, settings.endTime, &crop);
+  }
+  if (cropping)
+    m_last_stats.crop = crop;
+  int src_width = crop.width;
+  int src_height = crop.height;
+  // ----------------------
+
   const AVCodec *enc = nullptr;
   if (settings.encoderName) {
     enc = avcodec_find_encoder_by_name(settings.encoderName);
@@ -498,22 +1150,35 @@ bool FFmpegWrapper::transcodeInternal(const char *outputPath,
 
   AVCodecContext *enc_ctx = avcodec_alloc_context3(enc);
 
-  if (settings.targetHeight > 0 && m_dec_ctx->height > settings.targetHeight) {
-    double scale = (double)settings.targetHeight / m_dec_ctx->height;
-    enc_ctx->width = ((int)(m_dec_ctx->width * scale)) & ~1;
+  // Fitting happens first in the filter graph, so the rest of it sees the
+  // output geometry.
+  bool fitting = settings.useFilterGraph && settings.fitWidth > 0 &&
+                 settings.fitHeight > 0;
+  if (fitting) {
+    enc_ctx->width = settings.fitWidth & ~1;
+    enc_ctx->height = settings.fitHeight & ~1;
+    src_width = enc_ctx->width;
+    src_height = enc_ctx->height;
+  } else if (settings.targetHeight > 0 && src_height > settings.targetHeight) {
+    double scale = (double)settings.targetHeight / src_height;
+    enc_ctx->width = ((int)(src_width * scale)) & ~1;
     enc_ctx->height = settings.targetHeight;
   } else {
-    enc_ctx->width = m_dec_ctx->width;
-    enc_ctx->height = m_dec_ctx->height;
+    enc_ctx->width = src_width;
+    enc_ctx->height = src_height;
   }
 
-  enc_ctx->sample_aspect_ratio = m_dec_ctx->sample_aspect_ratio;
+  enc_ctx->sample_aspect_ratio =
+      fitting ? AVRational{1, 1} : m_dec_ctx->sample_aspect_ratio;
 
   if (std::string(enc->name).find("videotoolbox") != std::string::npos) {
     enc_ctx->pix_fmt = AV_PIX_FMT_NV12;
     if (settings.profile >= 0) {
       enc_ctx->profile = settings.profile;
     }
+  } else if (std::string(enc->name) == "libx264") {
+    // 8-bit 4:2:0 is the only H.264 flavour AVFoundation decodes in hardware.
+    enc_ctx->pix_fmt = AV_PIX_FMT_YUV420P;
   } else {
     if (settings.tenBit || m_dec_ctx->pix_fmt == AV_PIX_FMT_YUV420P10LE ||
         m_dec_ctx->color_trc == AVCOL_TRC_SMPTE2084 ||
@@ -537,17 +1202,77 @@ bool FFmpegWrapper::transcodeInternal(const char *outputPath,
     input_frame_rate = {60, 1};
 
   AVRational target_frame_rate = input_frame_rate;
-  if (settings.targetFps > 0 &&
-      av_q2d(input_frame_rate) > (double)settings.targetFps) {
+  bool exact_fps = settings.exactFps && settings.targetFps > 0 &&
+                   settings.useFilterGraph;
+  if (exact_fps || (settings.targetFps > 0 &&
+                    av_q2d(input_frame_rate) > (double)settings.targetFps)) {
     target_frame_rate = {settings.targetFps, 1};
   }
   enc_ctx->time_base = av_inv_q(target_frame_rate);
 
+  // Segments and cache units are cut at key packets, so every GOP must be
+  // closed.
+  bool cut_at_keyframes = checkpoint || settings.gopUnits;
+  if (cut_at_keyframes)
+    enc_ctx->flags |= AV_CODEC_FLAG_CLOSED_GOP;
+
+  if (settings.intraOnly) {
+    enc_ctx->gop_size = 1;
+    enc_ctx->max_b_frames = 0;
+  }
+
+  // Decode cost cap for the output's size and rate. The fps filter rounds
+  // near-integer rates up, so those count as the integer.
+  double output_fps = std::max(av_q2d(target_frame_rate),
+                               std::round(av_q2d(target_frame_rate)));
+  double luma_rate = (double)enc_ctx->width * enc_ctx->height * output_fps;
+  PlaybackLimits limits = {};
+  bool budgeted = settings.playbackBudget &&
+                  std::string(enc->name) == "libx265" &&
+                  playback_limits(enc_ctx->width, enc_ctx->height, output_fps,
+                                  &limits);
+  if (settings.playbackBudget && !budgeted)
+    printf("[FFmpegWrapper] Warning: No playback budget for %dx%d@%.2f with "
+           "%s\n",
+           enc_ctx->width, enc_ctx->height, output_fps, enc->name);
+
   if (std::string(enc->name) == "libx265") {
-    if (settings.x265Params)
-      av_opt_set(enc_ctx->priv_data, "x265-params", settings.x265Params, 0);
+    std::string x265_params = settings.x265Params ? settings.x265Params : "";
+    if (cut_at_keyframes && x265_params.find("open-gop") == std::string::npos)
+      x265_params += x265_params.empty() ? "open-gop=0" : ":open-gop=0";
+    if (budgeted) {
+      char level_params[128];
+      snprintf(level_params, sizeof(level_params),
+               "level-idc=%d:high-tier=0:vbv-maxrate=%lld:vbv-bufsize=%lld",
+               limits.level, (long long)(limits.vbvMaxrate / 1000),
+               (long long)(limits.vbvBufsize / 1000));
+      if (!x265_params.empty())
+        x265_params += ":";
+      x265_params += level_params;
+    }
+    if (m_memory_budget > 0) {
+      char budget_params[128];
+      snprintf(budget_params, sizeof(budget_params),
+               "frame-threads=%d:lookahead-slices=%d:rc-lookahead=%d:pools=%d",
+               plan.x265FrameThreads, plan.x265LookaheadSlices,
+               plan.x265RcLookahead, plan.x265Pools);
+      if (!x265_params.empty())
+        x265_params += ":";
+      x265_params += budget_params;
+    }
+    if (!x265_params.empty())
+      av_opt_set(enc_ctx->priv_data, "x265-params", x265_params.c_str(), 0);
+    if (settings.preset)
+      av_opt_set(enc_ctx->priv_data, "preset", settings.preset, 0);
+    if (settings.tune)
+      av_opt_set(enc_ctx->priv_data, "tune", settings.tune, 0);
+    if (settings.crf)
+      av_opt_set(enc_ctx->priv_data, "crf", settings.crf, 0);
+  } else if (std::string(enc->name) == "libx264") {
     if (settings.preset)
       av_opt_set(enc_ctx->priv_data, "preset", settings.preset, 0);
+    if (settings.tune)
+      av_opt_set(enc_ctx->priv_data, "tune", settings.tune, 0);
     if (settings.crf)
       av_opt_set(enc_ctx->priv_data, "crf", settings.crf, 0);
   } else if (std::string(enc->name).find("videotoolbox") != std::string::npos) {
@@ -559,6 +1284,10 @@ bool FFmpegWrapper::transcodeInternal(const char *outputPath,
     }
   }
 
+  // Cache units start on keyframes forced through pict_type; make them IDR.
+  if (settings.gopUnits)
+    av_opt_set_int(enc_ctx->priv_data, "forced-idr", 1, 0);
+
   if (out_fmt_ctx->oformat->flags & AVFMT_GLOBALHEADER) {
     enc_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
   }
@@ -569,37 +1298,81 @@ bool FFmpegWrapper::transcodeInternal(const char *outputPath,
     return false;
   }
 
-  AVStream *out_stream = avformat_new_stream(out_fmt_ctx, nullptr);
-  avcodec_parameters_from_context(out_stream->codecpar, enc_ctx);
-  out_stream->codecpar->codec_tag = MKTAG('h', 'v', 'c', '1');
+  std::unique_ptr<QualityMeter> meter;
+  if (settings.measureQuality)
+    meter.reset(QualityMeter::create(enc_ctx));
 
-  if (settings.timescale > 0) {
-    out_stream->time_base = {1, settings.timescale};
+  BitrateMeter bitrate;
+  if (budgeted) {
+    bitrate.setVbv(limits.vbvMaxrate, limits.vbvBufsize);
+    m_last_stats.playbackLevel = limits.level;
+    m_last_stats.vbvMaxrate = limits.vbvMaxrate;
   }
 
-  if (!(out_fmt_ctx->oformat->flags & AVFMT_NOFILE)) {
-    if (avio_open(&out_fmt_ctx->pb, outputPath, AVIO_FLAG_WRITE) < 0) {
+  // With checkpoints the encoded GOPs go to segment files and outputPath is
+  // only written once they are concatenated at the end. Cache units are
+  // concatenated by exportWithGopCache.
+  std::unique_ptr<EncodedGopCache::Writer> gop_writer;
+  if (settings.gopUnits)
+    gop_writer.reset(
+        new EncodedGopCache::Writer(*settings.gopCache, *settings.gopUnits));
+
+  AVStream *out_stream = nullptr;
+  if (!checkpoint && !gop_writer) {
+    out_stream = avformat_new_stream(out_fmt_ctx, nullptr);
+    avcodec_parameters_from_context(out_stream->codecpar, enc_ctx);
+    out_stream->codecpar->codec_tag =
+        enc_ctx->codec_id == AV_CODEC_ID_HEVC ? MKTAG('h', 'v', 'c', '1') : 0;
+
+    if (settings.intraOnly) {
+      // Lets a proxy be matched back to the file it was made from.
+      std::string tag = "livid-proxy " + file_identity(m_path.c_str());
+      av_dict_set(&out_fmt_ctx->metadata, "comment", tag.c_str(), 0);
+    }
+
+    if (settings.timescale > 0) {
+      out_stream->time_base = {1, settings.timescale};
+    }
+
+    if (!(out_fmt_ctx->oformat->flags & AVFMT_NOFILE)) {
+      if (avio_open(&out_fmt_ctx->pb, outputPath, AVIO_FLAG_WRITE) < 0) {
+        avcodec_free_context(&enc_ctx);
+        avformat_free_context(out_fmt_ctx);
+        return false;
+      }
+    }
+
+    if (avformat_write_header(out_fmt_ctx, nullptr) < 0) {
       avcodec_free_context(&enc_ctx);
       avformat_free_context(out_fmt_ctx);
       return false;
     }
   }
 
-  if (avformat_write_header(out_fmt_ctx, nullptr) < 0) {
-    avcodec_free_context(&enc_ctx);
-    avformat_free_context(out_fmt_ctx);
-    return false;
-  }
+  int64_t pts_counter = 0;
 
   // --- SEEK LOGIC ---
-  if (settings.startTime > 0) {
-    int64_t seek_target = (int64_t)(settings.startTime * AV_TIME_BASE);
+  // Decoded frames before skip_until only prime the decoder. A resumed export
+  // restarts at the first frame of the next uncommitted GOP, with half a frame
+  // of slack for timestamp rounding.
+  double seek_time = settings.startTime;
+  double skip_until = settings.startTime;
+  if (checkpoint && checkpoint->isResuming()) {
+    seek_time = checkpoint->resumeTime();
+    skip_until = seek_time - 0.5 / av_q2d(input_frame_rate);
+    pts_counter = checkpoint->resumePts();
+  }
+  if (seek_time > 0) {
+    int64_t seek_target = (int64_t)(seek_time * AV_TIME_BASE);
     av_seek_frame(m_fmt_ctx, -1, seek_target, AVSEEK_FLAG_BACKWARD);
     // Flush decoder after seek
     avcodec_flush_buffers(m_dec_ctx);
   }
   // ------------------
 
+  size_t blend_idx = 0;
+  double blend_from = settings.blendStart - 0.5 / av_q2d(input_frame_rate);
+
   AVPacket *in_pkt = av_packet_alloc();
   AVPacket *out_pkt = av_packet_alloc();
   AVFrame *dec_frame = av_frame_alloc();
@@ -616,6 +1389,8 @@ bool FFmpegWrapper::transcodeInternal(const char *outputPath,
 
   AVFrame *filt_frame = av_frame_alloc();    // For filter output
   AVFrame *sws_out_frame = av_frame_alloc(); // For manual sws output
+  std::unique_ptr<ChromaDownsampler> chroma; // High-chroma/RGB fast path
+  AVFrame *chroma_frame = av_frame_alloc();
 
   // Calculate effective duration for progress
   double asset_duration_sec = (double)m_fmt_ctx->duration / AV_TIME_BASE;
@@ -627,9 +1402,150 @@ bool FFmpegWrapper::transcodeInternal(const char *outputPath,
   if (duration_sec < 0)
     duration_sec = 0;
 
-  int64_t pts_counter = 0;
   int64_t frame_idx = 0;
   bool stop_encoding = false;
+  bool write_failed = false;
+  bool read_failed = false; // Input ended with an error rather than EOF
+  double last_source_time = seek_time;
+
+  // --- ENCODER OUTPUT ---
+  auto write_packet = [&](AVPacket *pkt) {
+    if (pkt->duration <= 0)
+      pkt->duration = 1; // One frame in encoder time base
+    TraceSpan span("write", "pts", pkt->pts);
+    if (meter) {
+      TraceSpan quality_span("quality");
+      meter->addPacket(pkt);
+    }
+    bitrate.addFrame((pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts) *
+                         av_q2d(enc_ctx->time_base),
+                     pkt->size);
+    if (gop_writer) {
+      if (!gop_writer->writePacket(pkt, enc_ctx, settings.timescale))
+        write_failed = true;
+    } else if (checkpoint) {
+      if (!checkpoint->writePacket(pkt, enc_ctx, settings.timescale))
+        write_failed = true;
+    } else {
+      av_packet_rescale_ts(pkt, enc_ctx->time_base, out_stream->time_base);
+      pkt->stream_index = out_stream->index;
+      av_interleaved_write_frame(out_fmt_ctx, pkt);
+    }
+    av_packet_unref(pkt);
+  };
+
+  auto drain_encoder = [&]() {
+    while (avcodec_receive_packet(enc_ctx, out_pkt) == 0)
+      write_packet(out_pkt);
+  };
+
+  // The preview tier drops non-reference frames, so frames are placed at
+  // their source time instead of being numbered consecutively. Proxies do the
+  // same so a seek lands on the frame the source shows at that time.
+  bool timestamps_from_source =
+      settings.decodeTier == DecodeTier::Preview || settings.intraOnly;
+
+  // pts, duration and pict_type must be set; pts in encoder time base.
+  auto send_frame = [&](AVFrame *frame, double source_time) {
+    if (checkpoint)
+      checkpoint->noteFrame(frame->pts, source_time);
+    if (m_preview_ring)
+      publish_preview(m_preview_ring, frame, source_time);
+    if (meter)
+      meter->addSource(frame, source_time);
+    if ((m_last_stats.framesEncoded++ & 15) == 0)
+      memory.sample();
+    int sent;
+    {
+      TraceSpan span("encode", "pts", frame->pts);
+      sent = avcodec_send_frame(enc_ctx, frame);
+    }
+    if (sent == 0)
+      drain_encoder();
+  };
+
+  // --- DUPLICATE MERGING ---
+  // The newest distinct frame is held back until the next one arrives, so
+  // its duration can cover the repeats in between. Durations end up in the
+  // packets, which keeps the timeline exact across checkpoint segments. Runs
+  // are capped at a second so no sample outlasts that.
+  std::unique_ptr<DuplicateDetector> duplicates;
+  if (settings.dropDuplicates) {
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(enc_ctx->pix_fmt);
+    if (desc && !(desc->flags & AV_PIX_FMT_FLAG_HWACCEL))
+      duplicates.reset(new DuplicateDetector(
+          enc_ctx->width, enc_ctx->height,
+          desc->comp[0].depth + desc->comp[0].shift));
+  }
+  AVFrame *held_frame = av_frame_alloc();
+  double held_time = 0;
+  int held_repeats = 0;
+  int max_repeats =
+      std::max(1, (int)llround(1.0 / av_q2d(enc_ctx->time_base)) - 1);
+
+  auto release_held = [&](int64_t end_pts) {
+    if (!held_frame->buf[0])
+      return;
+    held_frame->duration = std::max<int64_t>(1, end_pts - held_frame->pts);
+    send_frame(held_frame, held_time);
+    av_frame_unref(held_frame);
+  };
+  // -------------------------
+
+  // A GOP-cached run forces a keyframe on the first frame of each unit.
+  size_t next_unit = 0;
+  double unit_slack = 0.5 * av_q2d(enc_ctx->time_base);
+  auto starts_unit = [&](double source_time, int64_t pts) {
+    const std::vector<GopUnit> *units = settings.gopUnits;
+    if (!units || next_unit >= units->size() ||
+        source_time < (*units)[next_unit].startTime - unit_slack)
+      return false;
+    // Units too short to hold a frame of their own are skipped.
+    while (next_unit + 1 < units->size() &&
+           source_time >= (*units)[next_unit + 1].startTime - unit_slack)
+      next_unit++;
+    gop_writer->markUnitStart(next_unit++, pts);
+    return true;
+  };
+
+  auto encode_frame = [&](AVFrame *frame, double source_time) {
+    if (timestamps_from_source) {
+      int64_t source_pts = llround((source_time - settings.startTime) /
+                                   av_q2d(enc_ctx->time_base));
+      pts_counter = std::max(pts_counter, source_pts);
+    }
+    frame->pts = pts_counter++;
+    frame->duration = 1;
+    bool forced_key = starts_unit(source_time, frame->pts);
+    frame->pict_type = forced_key ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+    if (!duplicates || !frame->buf[0]) {
+      send_frame(frame, source_time);
+      return;
+    }
+
+    if (!forced_key && held_frame->buf[0] && held_repeats < max_repeats &&
+        duplicates->matchesReference(frame->data[0], frame->linesize[0])) {
+      held_repeats++;
+      m_last_stats.framesMerged++;
+      return;
+    }
+    release_held(frame->pts);
+    duplicates->setReference(frame->data[0], frame->linesize[0]);
+    if (av_frame_ref(held_frame, frame) < 0) {
+      send_frame(frame, source_time);
+      return;
+    }
+    held_time = source_time;
+    held_repeats = 0;
+  };
+
+  // Source time of a filter graph output frame (before its pts is replaced).
+  auto filtered_time = [&](const AVFrame *frame) {
+    if (frame->pts == AV_NOPTS_VALUE)
+      return last_source_time;
+    return frame->pts * av_q2d(av_buffersink_get_time_base(filt_sink));
+  };
+  // ----------------------
 
   // Decide on filters
   std::string filter_descr = "null";
@@ -643,11 +1559,19 @@ bool FFmpegWrapper::transcodeInternal(const char *outputPath,
   bool needs_fps_fix = std::abs(input_fps - target_fps) > 0.001 &&
                        std::abs(input_fps - target_fps) < 0.1;
   std::string fps_filter = "";
-  if (needs_fps_fix && target_fps > 0) {
+  if (exact_fps) {
+    fps_filter = "fps=fps=" + std::to_string(settings.targetFps);
+  } else if (needs_fps_fix && target_fps > 0 && !settings.intraOnly) {
     fps_filter = "fps=fps=" + std::to_string((int)target_fps);
     printf("[FFmpegWrapper] Normalizing FPS: %f -> %f\n", input_fps, target_fps);
   }
 
+  if (settings.useFilterGraph && !is_hdr && !settings.tonemap &&
+      enc_ctx->pix_fmt == AV_PIX_FMT_YUV420P10LE)
+    chroma.reset(ChromaDownsampler::create(
+        m_dec_ctx->pix_fmt, m_dec_ctx->colorspace, m_dec_ctx->color_range,
+        m_dec_ctx->color_primaries, plan.filterThreads));
+
   if (settings.useFilterGraph) {
     if (is_hdr || settings.tonemap) {
       // HDR to SDR Tone Mapping with proper color space conversion
@@ -660,15 +1584,24 @@ bool FFmpegWrapper::transcodeInternal(const char *outputPath,
                      std::string(av_get_pix_fmt_name(enc_ctx->pix_fmt));
       printf("[FFmpegWrapper] Tone mapping enabled. Filter: %s\n",
              filter_descr.c_str());
-    } else if (m_dec_ctx->width != enc_ctx->width ||
-               m_dec_ctx->height != enc_ctx->height ||
+    } else if (chroma) {
+      // 4:4:4, 4:2:2 and RGB sources: frames are converted to the encoder's
+      // format before the graph, which is left with resizing (and the fit,
+      // crop and fps filters below).
+      if (src_width != enc_ctx->width || src_height != enc_ctx->height) {
+        filter_descr = "zscale=w=" + std::to_string(enc_ctx->width) +
+                       ":h=" + std::to_string(enc_ctx->height) +
+                       ":f=spline36,format=yuv420p10le";
+      }
+      printf("[FFmpegWrapper] Chroma fast path %s -> yuv420p10le. Filter: %s\n",
+             av_get_pix_fmt_name(m_dec_ctx->pix_fmt), filter_descr.c_str());
+    } else if (src_width != enc_ctx->width || src_height != enc_ctx->height ||
                m_dec_ctx->pix_fmt != enc_ctx->pix_fmt) {
       // Optimized SDR path: Use zscale for high-quality scaling and bit-depth
       // expansion. This avoids the 'bgr48le' accelerated path warning by
       // staying in the YUV domain.
       std::string scale_part = "";
-      if (m_dec_ctx->width != enc_ctx->width ||
-          m_dec_ctx->height != enc_ctx->height) {
+      if (src_width != enc_ctx->width || src_height != enc_ctx->height) {
         scale_part = "zscale=w=" + std::to_string(enc_ctx->width) +
                      ":h=" + std::to_string(enc_ctx->height) + ":f=spline36,";
       }
@@ -685,6 +1618,29 @@ bool FFmpegWrapper::transcodeInternal(const char *outputPath,
     }
   }
 
+  if (fitting) {
+    std::string w = std::to_string(enc_ctx->width);
+    std::string h = std::to_string(enc_ctx->height);
+    std::string fit_filter =
+        "scale=w=" + w + ":h=" + h +
+        ":force_original_aspect_ratio=decrease:force_divisible_by=2,pad=w=" +
+        w + ":h=" + h + ":x=(ow-iw)/2:y=(oh-ih)/2";
+    filter_descr = filter_descr == "null" ? fit_filter
+                                          : fit_filter + "," + filter_descr;
+  }
+
+  // Cropping only offsets plane pointers. It joins the graph when there is
+  // one (always with the chroma fast path, whose output frame is reused);
+  // the sws path below crops each decoded frame instead.
+  if (cropping && (filter_descr != "null" || !fps_filter.empty() || chroma)) {
+    std::string crop_filter =
+        "crop=w=" + std::to_string(crop.width) +
+        ":h=" + std::to_string(crop.height) + ":x=" + std::to_string(crop.x) +
+        ":y=" + std::to_string(crop.y) + ":exact=1";
+    filter_descr = filter_descr == "null" ? crop_filter
+                                          : crop_filter + "," + filter_descr;
+  }
+
   if (filter_descr != "null" || !fps_filter.empty()) {
     std::string final_filter = filter_descr;
     if (final_filter == "null")
@@ -703,158 +1659,335 @@ bool FFmpegWrapper::transcodeInternal(const char *outputPath,
         final_filter = "null";
 
     if (init_filter_graph(&filter_graph, &filt_src, &filt_sink,
-                          final_filter.c_str(), m_dec_ctx, enc_ctx) < 0) {
+                          final_filter.c_str(), m_dec_ctx, enc_ctx,
+                          chroma ? AV_PIX_FMT_YUV420P10LE : m_dec_ctx->pix_fmt,
+                          plan.filterThreads) < 0) {
       printf("[FFmpegWrapper] Error: Failed to initialize filter graph\n");
-      // Fallback to null or fail
+      // Fallback to null or fail; sws then converts the decoded frames.
+      chroma.reset();
     }
   }
 
-  while (av_read_frame(m_fmt_ctx, in_pkt) >= 0) {
-    if (m_should_stop) {
-      av_packet_unref(in_pkt);
-      break;
+  // Everything after trimming: rate control, filtering or scaling, encoding.
+  double progress_origin = settings.startTime;
+  double progress_span = settings.reverseFrames && settings.boomerang
+                             ? 2 * duration_sec
+                             : duration_sec;
+  auto process_frame = [&](AVFrame *frame, double current_time) {
+    m_last_stats.framesDecoded++;
+    TraceSpan frame_span("frame", "frame", m_last_stats.framesDecoded);
+
+    if (settings.blendFrames && blend_idx < settings.blendFrames->size() &&
+        current_time >= blend_from) {
+      // Weights (k + 1) / (N + 1): the last frame is nearly the first
+      // blend frame's successor, which is where the loop resumes.
+      int weight = (int)((256 * (blend_idx + 1)) /
+                         (settings.blendFrames->size() + 1));
+      TraceSpan span("blend");
+      if (blend_frame_into(frame, (*settings.blendFrames)[blend_idx], weight))
+        m_last_stats.seamFramesBlended++;
+      blend_idx++;
     }
-    if (in_pkt->stream_index == m_video_stream_idx) {
-      if (avcodec_send_packet(m_dec_ctx, in_pkt) == 0) {
-        while (avcodec_receive_frame(m_dec_ctx, dec_frame) == 0) {
-
-          // Get current frame timestamp in seconds
-          double current_time =
-              dec_frame->pts *
-              av_q2d(m_fmt_ctx->streams[m_video_stream_idx]->time_base);
-
-          // Trimming Logic
-          if (current_time < settings.startTime)
-            continue;
-          if (settings.endTime > 0 && current_time > settings.endTime) {
-            stop_encoding = true;
-            break;
-          }
 
-          // Frame rate control/skipping
-          if (settings.targetFps > 0 &&
-              av_q2d(input_frame_rate) > (double)settings.targetFps) {
-            double ratio =
-                av_q2d(input_frame_rate) / (double)settings.targetFps;
-            if (frame_idx++ % (int)ratio != 0)
-              continue;
-          } else {
-            frame_idx++;
-          }
+    // Frame rate control/skipping: keep a frame whenever it reaches
+    // a new output slot, so non-integer ratios (50 -> 30) keep the
+    // right share of frames instead of all of them.
+    if (!exact_fps && settings.targetFps > 0 &&
+        av_q2d(input_frame_rate) > (double)settings.targetFps) {
+      double ratio = (double)settings.targetFps / av_q2d(input_frame_rate);
+      int64_t slot = (int64_t)(frame_idx * ratio);
+      bool keep = frame_idx == 0 || slot != (int64_t)((frame_idx - 1) * ratio);
+      frame_idx++;
+      if (!keep)
+        return;
+    } else {
+      frame_idx++;
+    }
 
-          // --- PROCESSING & ENCODING ---
-          // Filter Graph 경로
-          if (filter_graph) {
-            if (av_buffersrc_add_frame_flags(filt_src, dec_frame,
-                                             AV_BUFFERSRC_FLAG_KEEP_REF) >= 0) {
-              while (true) {
-                av_frame_unref(filt_frame);
-                int ret = av_buffersink_get_frame(filt_sink, filt_frame);
-                if (ret < 0)
-                  break;
-
-                filt_frame->pts = pts_counter++;
-                filt_frame->pict_type = AV_PICTURE_TYPE_NONE; // ← 추가!
-
-                if (avcodec_send_frame(enc_ctx, filt_frame) == 0) {
-                  while (avcodec_receive_packet(enc_ctx, out_pkt) == 0) {
-                    av_packet_rescale_ts(out_pkt, enc_ctx->time_base,
-                                         out_stream->time_base);
-                    out_pkt->stream_index = out_stream->index;
-                    av_interleaved_write_frame(out_fmt_ctx, out_pkt);
-                    av_packet_unref(out_pkt);
-                  }
-                }
-              }
-            }
-          } // Legacy Path (Manual Scaling)
-          else {
-            if (!sws_ctx) {
-              sws_ctx = sws_getContext(dec_frame->width, dec_frame->height,
-                                       (AVPixelFormat)dec_frame->format,
-                                       enc_ctx->width, enc_ctx->height,
-                                       enc_ctx->pix_fmt, settings.swsFlags,
-                                       nullptr, nullptr, nullptr);
-
-              sws_out_frame->format = enc_ctx->pix_fmt;
-              sws_out_frame->width = enc_ctx->width;
-              sws_out_frame->height = enc_ctx->height;
-              av_frame_get_buffer(sws_out_frame, 0);
-            }
-
-            if (sws_ctx) {
-              sws_scale(sws_ctx, dec_frame->data, dec_frame->linesize, 0,
-                        dec_frame->height, sws_out_frame->data,
-                        sws_out_frame->linesize);
-              sws_out_frame->pts = pts_counter++;
-              sws_out_frame->pict_type = AV_PICTURE_TYPE_NONE; // ← 추가!
-
-              if (avcodec_send_frame(enc_ctx, sws_out_frame) == 0) {
-                while (avcodec_receive_packet(enc_ctx, out_pkt) == 0) {
-                  av_packet_rescale_ts(out_pkt, enc_ctx->time_base,
-                                       out_stream->time_base);
-                  out_pkt->stream_index = out_stream->index;
-                  av_interleaved_write_frame(out_fmt_ctx, out_pkt);
-                  av_packet_unref(out_pkt);
-                }
-              }
-            }
-          }
+    // --- PROCESSING & ENCODING ---
+    if (chroma) {
+      // The previous output may still be referenced by the encoder, the
+      // graph or the duplicate holder. Every sample gets overwritten, so a
+      // fresh buffer beats av_frame_make_writable's copy.
+      if (!av_frame_is_writable(chroma_frame)) {
+        av_frame_unref(chroma_frame);
+        chroma_frame->format = AV_PIX_FMT_YUV420P10LE;
+        chroma_frame->width = frame->width;
+        chroma_frame->height = frame->height;
+      }
+      TraceSpan span("chroma");
+      bool allocated =
+          chroma_frame->buf[0] || av_frame_get_buffer(chroma_frame, 0) >= 0;
+      // The graph (or encoder) was set up for the converted format, so the
+      // source frame cannot stand in for it. Dropping the frame would shift
+      // every later one; fail the export instead.
+      if (!allocated || !chroma->convert(frame, chroma_frame)) {
+        printf("[FFmpegWrapper] Chroma fast path: cannot convert %s frame "
+               "%dx%d, aborting\n",
+               av_get_pix_fmt_name((AVPixelFormat)frame->format), frame->width,
+               frame->height);
+        write_failed = true;
+        return;
+      }
+      m_last_stats.framesChromaConverted++;
+      frame = chroma_frame;
+    }
 
-          if (progressCallback && duration_sec > 0) {
-            double progress =
-                (current_time - settings.startTime) / duration_sec;
-            if (progress < 0)
-              progress = 0;
-            if (progress > 1.0)
-              progress = 1.0;
-            progressCallback(progress, user_data);
+    // Filter Graph 경로
+    if (filter_graph) {
+      int added;
+      {
+        TraceSpan span("filter");
+        added = av_buffersrc_add_frame_flags(filt_src, frame,
+                                             AV_BUFFERSRC_FLAG_KEEP_REF);
+      }
+      if (added >= 0) {
+        // One input can release several outputs (fps duplicating).
+        while (true) {
+          av_frame_unref(filt_frame);
+          int ret;
+          {
+            TraceSpan span("filter out");
+            ret = av_buffersink_get_frame(filt_sink, filt_frame);
           }
+          if (ret < 0)
+            break;
+
+          encode_frame(filt_frame, filtered_time(filt_frame));
         }
       }
-    }
-    av_packet_unref(in_pkt);
-    if (stop_encoding)
-      break;
-  }
+    } else if (chroma) {
+      encode_frame(frame, current_time);
+    } // Legacy Path (Manual Scaling)
+    else {
+      if (cropping) {
+        frame->crop_left = crop.x;
+        frame->crop_top = crop.y;
+        frame->crop_right = frame->width - crop.x - crop.width;
+        frame->crop_bottom = frame->height - crop.y - crop.height;
+        av_frame_apply_cropping(frame, AV_FRAME_CROP_UNALIGNED);
+      }
+      if (!sws_ctx) {
+        sws_ctx = sws_getContext(frame->width, frame->height,
+                                 (AVPixelFormat)frame->format, enc_ctx->width,
+                                 enc_ctx->height, enc_ctx->pix_fmt,
+                                 settings.swsFlags, nullptr, nullptr, nullptr);
+
+        sws_out_frame->format = enc_ctx->pix_fmt;
+        sws_out_frame->width = enc_ctx->width;
+        sws_out_frame->height = enc_ctx->height;
+        av_frame_get_buffer(sws_out_frame, 0);
+      }
 
-  // --- FINAL FLUSHING ---
-  if (filter_graph) {
-    av_buffersrc_add_frame_flags(filt_src, nullptr, 0);
-    while (av_buffersink_get_frame(filt_sink, filt_frame) >= 0) {
-      filt_frame->pts = pts_counter++;
-      filt_frame->pict_type = AV_PICTURE_TYPE_NONE; // ← 추가!
-
-      if (avcodec_send_frame(enc_ctx, filt_frame) == 0) {
-        while (avcodec_receive_packet(enc_ctx, out_pkt) == 0) {
-          av_packet_rescale_ts(out_pkt, enc_ctx->time_base,
-                               out_stream->time_base);
-          out_pkt->stream_index = out_stream->index;
-          av_interleaved_write_frame(out_fmt_ctx, out_pkt);
-          av_packet_unref(out_pkt);
-        }
+      // The previous output may still be referenced by the encoder
+      // or held back as a duplicate candidate.
+      if (sws_ctx && av_frame_make_writable(sws_out_frame) == 0) {
+        TraceSpan span("scale");
+        sws_scale(sws_ctx, frame->data, frame->linesize, 0, frame->height,
+                  sws_out_frame->data, sws_out_frame->linesize);
+        encode_frame(sws_out_frame, current_time);
       }
-      av_frame_unref(filt_frame);
     }
-  }
-  avcodec_send_frame(enc_ctx, nullptr);
-  while (avcodec_receive_packet(enc_ctx, out_pkt) == 0) {
-    av_packet_rescale_ts(out_pkt, enc_ctx->time_base, out_stream->time_base);
-    out_pkt->stream_index = out_stream->index;
-    av_interleaved_write_frame(out_fmt_ctx, out_pkt);
-    av_packet_unref(out_pkt);
-  }
 
-  av_write_trailer(out_fmt_ctx);
+    if (progressCallback && duration_sec > 0) {
+      double progress = (current_time - progress_origin) / progress_span;
+      if (progress < 0)
+        progress = 0;
+      if (progress > 1.0)
+        progress = 1.0;
+      progressCallback(progress, user_data);
+    }
+  };
 
-  if (filter_graph)
-    avfilter_graph_free(&filter_graph);
-  if (sws_ctx)
-    sws_freeContext(sws_ctx);
+  // Passes every frame the decoder has ready to process_frame, within the
+  // trim; sets stop_encoding once past its end.
+  auto receive_frames = [&]() {
+    while (avcodec_receive_frame(m_dec_ctx, dec_frame) == 0) {
 
-  av_frame_free(&filt_frame);
-  av_frame_free(&sws_out_frame);
-  av_frame_free(&dec_frame);
+      // Get current frame timestamp in seconds
+      double current_time =
+          dec_frame->pts *
+          av_q2d(m_fmt_ctx->streams[m_video_stream_idx]->time_base);
+
+      // Trimming Logic
+      if (current_time < skip_until)
+        continue;
+      if (settings.endTime > 0 && current_time > settings.endTime) {
+        stop_encoding = true;
+        break;
+      }
+      last_source_time = current_time;
+      process_frame(dec_frame, current_time);
+    }
+  };
+
+  bool forward_pass = !settings.reverseFrames || settings.boomerang;
+  while (forward_pass) {
+    int read;
+    {
+      TraceSpan span("read");
+      read = av_read_frame(m_fmt_ctx, in_pkt);
+    }
+    if (read == AVERROR_EOF && !m_should_stop && !write_failed) {
+      // The decoder still holds the frames it reorders (B-frames) or has in
+      // flight on its threads; without them a boomerang would turn on a
+      // frame past the last one the forward half shows.
+      {
+        TraceSpan span("decode");
+        avcodec_send_packet(m_dec_ctx, nullptr);
+      }
+      receive_frames();
+      avcodec_flush_buffers(m_dec_ctx); // Ready for the next operation
+      break;
+    }
+    if (read < 0) {
+      if (read != AVERROR_EOF && !m_should_stop) {
+        printf("[FFmpegWrapper] Read failed (%d), output is incomplete\n",
+               read);
+        read_failed = true;
+      }
+      break;
+    }
+    waitWhilePaused();
+    if (m_should_stop || write_failed) {
+      av_packet_unref(in_pkt);
+      break;
+    }
+    if (in_pkt->stream_index == m_video_stream_idx) {
+      int sent;
+      {
+        TraceSpan span("decode", "pts", in_pkt->pts);
+        sent = avcodec_send_packet(m_dec_ctx, in_pkt);
+      }
+      if (sent == 0)
+        receive_frames();
+    }
+    av_packet_unref(in_pkt);
+    if (stop_encoding)
+      break;
+  }
+
+  // Reverse pass: the frames again, last to first, with pts mirrored around
+  // the last one so the timeline keeps moving forward. A boomerang skips the
+  // turning frame, which the forward pass ended on, and the first frame,
+  // which the loop shows next.
+  if (settings.reverseFrames) {
+    double tb = av_q2d(m_fmt_ctx->streams[m_video_stream_idx]->time_base);
+    int64_t mirror = AV_NOPTS_VALUE;
+    while (!m_should_stop && !write_failed) {
+      {
+        TraceSpan span("reverse next");
+        if (!settings.reverseFrames->next(dec_frame))
+          break;
+      }
+      waitWhilePaused();
+      bool turning = mirror == AV_NOPTS_VALUE;
+      if (turning) {
+        mirror = 2 * dec_frame->pts;
+        if (!settings.boomerang)
+          progress_origin = dec_frame->pts * tb;
+      }
+      if (settings.boomerang &&
+          (turning || settings.reverseFrames->exhausted())) {
+        av_frame_unref(dec_frame);
+        continue;
+      }
+      dec_frame->pts = mirror - dec_frame->pts;
+      double current_time = dec_frame->pts * tb;
+      last_source_time = current_time;
+      process_frame(dec_frame, current_time);
+      av_frame_unref(dec_frame);
+    }
+  }
+
+  // A cancelled or interrupted checkpointed or GOP-cached export keeps its
+  // committed segments for the next run; the GOP in flight is dropped instead
+  // of being flushed short.
+  bool keep_checkpoint = (checkpoint || gop_writer) &&
+                         (m_should_stop || write_failed || read_failed);
+
+  // --- FINAL FLUSHING ---
+  if (!keep_checkpoint) {
+    TraceSpan span("flush");
+    if (filter_graph) {
+      av_buffersrc_add_frame_flags(filt_src, nullptr, 0);
+      while (av_buffersink_get_frame(filt_sink, filt_frame) >= 0) {
+        encode_frame(filt_frame, filtered_time(filt_frame));
+        av_frame_unref(filt_frame);
+      }
+    }
+    release_held(pts_counter);
+    TraceSpan encoder_span("flush encoder");
+    avcodec_send_frame(enc_ctx, nullptr);
+    drain_encoder();
+  }
+  // Flushing releases the encoder's lookahead and the filter graph's queued
+  // frames in one burst, between the every-16-frames samples.
+  memory.sample();
+
+  if (meter) {
+    TraceSpan span("quality finish");
+    meter->finish();
+    m_frame_quality = meter->frames();
+    m_last_stats.framesMeasured = (int64_t)m_frame_quality.size();
+    QualityMeter::summarize(m_frame_quality, &m_last_stats.meanPsnr,
+                            &m_last_stats.meanSsim, &m_last_stats.minSsim);
+    printf("[FFmpegWrapper] Quality: PSNR-Y %.2f dB, SSIM-Y %.4f (min %.4f) "
+           "over %lld frames\n",
+           m_last_stats.meanPsnr, m_last_stats.meanSsim, m_last_stats.minSsim,
+           (long long)m_last_stats.framesMeasured);
+  }
+
+  m_last_stats.peakBitrate = bitrate.peakBitsPerSecond();
+  if (budgeted) {
+    m_last_stats.vbvUnderflows = bitrate.vbvUnderflows();
+    m_last_stats.decodeLoad =
+        std::max(luma_rate / limits.maxLumaSampleRate,
+                 (double)m_last_stats.peakBitrate / limits.levelMaxBitrate);
+    printf("[FFmpegWrapper] Playback budget: level %d.%d, peak %.1f of %.1f "
+           "Mbit/s, %d VBV underflow(s), decode load %.0f%%\n",
+           limits.level / 10, limits.level % 10,
+           m_last_stats.peakBitrate / 1e6, limits.vbvMaxrate / 1e6,
+           m_last_stats.vbvUnderflows, 100 * m_last_stats.decodeLoad);
+  }
+
+  bool success = true;
+  if (gop_writer) {
+    if (keep_checkpoint) {
+      gop_writer->abandon();
+      success = false;
+    } else {
+      TraceSpan span("trailer");
+      success = !write_failed && gop_writer->finish();
+    }
+  } else if (checkpoint) {
+    if (keep_checkpoint) {
+      checkpoint->abandon();
+      success = false;
+    } else {
+      TraceSpan span("trailer");
+      success = !write_failed &&
+                checkpoint->finish(pts_counter, last_source_time);
+    }
+  } else {
+    TraceSpan span("trailer");
+    av_write_trailer(out_fmt_ctx);
+  }
+  memory.sample();
+  if (read_failed || write_failed ||
+      (settings.reverseFrames && settings.reverseFrames->failed()))
+    success = false;
+
+  if (filter_graph)
+    avfilter_graph_free(&filter_graph);
+  if (sws_ctx)
+    sws_freeContext(sws_ctx);
+
+  av_frame_free(&filt_frame);
+  av_frame_free(&sws_out_frame);
+  av_frame_free(&chroma_frame);
+  av_frame_free(&held_frame);
+  av_frame_free(&dec_frame);
   av_frame_free(&enc_frame);
   av_packet_free(&in_pkt);
   av_packet_free(&out_pkt);
@@ -864,14 +1997,794 @@ bool FFmpegWrapper::transcodeInternal(const char *outputPath,
   }
   avformat_free_context(out_fmt_ctx);
 
+  if (checkpoint && success) {
+    success = checkpoint->concatenate(outputPath, settings.timescale,
+                                      &m_fmt_ctx->interrupt_callback);
+    if (success)
+      checkpoint->remove();
+  }
+
+  if (m_last_stats.framesMerged > 0)
+    printf("[FFmpegWrapper] Merged %lld duplicate frames (%lld encoded)\n",
+           (long long)m_last_stats.framesMerged,
+           (long long)m_last_stats.framesEncoded);
+
+  record_stats();
+  return success;
+}
+
+// Replays the video packets of a finished file through a BitrateMeter, so
+// the peak rate and VBV check cover the whole output, whichever runs (or
+// cached units) its GOPs came from. `budget` also checks the playback
+// level and VBV cap of the file's size and rate.
+static bool measure_bitrate(const char *path, bool budget,
+                            TranscodeStats *stats) {
+  stats->peakBitrate = 0;
+  stats->playbackLevel = 0;
+  stats->vbvMaxrate = 0;
+  stats->vbvUnderflows = 0;
+  stats->decodeLoad = 0;
+  AVFormatContext *fmt_ctx = nullptr;
+  if (avformat_open_input(&fmt_ctx, path, nullptr, nullptr) < 0)
+    return false;
+  int idx = avformat_find_stream_info(fmt_ctx, nullptr) < 0
+                ? -1
+                : av_find_best_stream(fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1,
+                                      nullptr, 0);
+  if (idx < 0) {
+    avformat_close_input(&fmt_ctx);
+    return false;
+  }
+  AVStream *stream = fmt_ctx->streams[idx];
+  double fps = av_q2d(av_guess_frame_rate(fmt_ctx, stream, nullptr));
+  fps = std::max(fps, std::round(fps));
+  PlaybackLimits limits = {};
+  bool budgeted = budget && playback_limits(stream->codecpar->width,
+                                            stream->codecpar->height, fps,
+                                            &limits);
+
+  BitrateMeter bitrate;
+  if (budgeted)
+    bitrate.setVbv(limits.vbvMaxrate, limits.vbvBufsize);
+  AVPacket *pkt = av_packet_alloc();
+  while (av_read_frame(fmt_ctx, pkt) >= 0) {
+    if (pkt->stream_index == idx)
+      bitrate.addFrame((pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts) *
+                           av_q2d(stream->time_base),
+                       pkt->size);
+    av_packet_unref(pkt);
+  }
+  av_packet_free(&pkt);
+
+  stats->peakBitrate = bitrate.peakBitsPerSecond();
+  if (budgeted) {
+    double luma_rate =
+        (double)stream->codecpar->width * stream->codecpar->height * fps;
+    stats->playbackLevel = limits.level;
+    stats->vbvMaxrate = limits.vbvMaxrate;
+    stats->vbvUnderflows = bitrate.vbvUnderflows();
+    stats->decodeLoad =
+        std::max(luma_rate / limits.maxLumaSampleRate,
+                 (double)stats->peakBitrate / limits.levelMaxBitrate);
+    printf("[FFmpegWrapper] Playback budget of %s: level %d.%d, peak %.1f of "
+           "%.1f Mbit/s, %d VBV underflow(s), decode load %.0f%%\n",
+           path, limits.level / 10, limits.level % 10,
+           stats->peakBitrate / 1e6, limits.vbvMaxrate / 1e6,
+           stats->vbvUnderflows, 100 * stats->decodeLoad);
+  }
+  avformat_close_input(&fmt_ctx);
   return true;
 }
 
+// Folds one transcode of an export made of several into its totals: the
+// threading plan from the latest run, counters summed over all of them.
+static void add_run_stats(TranscodeStats *stats,
+                          std::vector<FrameQuality> *quality,
+                          const TranscodeStats &run,
+                          const std::vector<FrameQuality> &run_quality) {
+  TranscodeStats totals = *stats;
+  *stats = run;
+  stats->framesDecoded += totals.framesDecoded;
+  stats->framesEncoded += totals.framesEncoded;
+  stats->framesMerged += totals.framesMerged;
+  stats->framesChromaConverted += totals.framesChromaConverted;
+  stats->seamFramesBlended += totals.seamFramesBlended;
+  stats->peakResidentBytes =
+      std::max(stats->peakResidentBytes, totals.peakResidentBytes);
+  stats->peakMemoryBytes =
+      std::max(stats->peakMemoryBytes, totals.peakMemoryBytes);
+  quality->insert(quality->end(), run_quality.begin(), run_quality.end());
+}
+
+namespace {
+// Maps a run's progress into its share of an export made of several runs
+// (GOP-cached units, loop seam parts, concatenated clips).
+struct RunProgress {
+  FFmpegWrapper::ProgressCallback callback;
+  void *userData;
+  double base;
+  double scale;
+
+  static void forward(double progress, void *opaque) {
+    RunProgress *run = (RunProgress *)opaque;
+    run->callback(run->base + progress * run->scale, run->userData);
+  }
+};
+} // namespace
+
+// Everything that has to match for packets of two files to share one sample
+// description: the stream parameters and the parameter sets in extradata.
+static std::string stream_key(const AVFormatContext *fmt_ctx, int stream_idx) {
+  const AVStream *st = fmt_ctx->streams[stream_idx];
+  const AVCodecParameters *par = st->codecpar;
+  AVRational rate =
+      av_guess_frame_rate((AVFormatContext *)fmt_ctx, (AVStream *)st, nullptr);
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%d|%dx%d|%d|%d|%d|%d,%d,%d,%d|%d:%d|%d/%d|%d|",
+           (int)par->codec_id, par->width, par->height, par->format,
+           par->profile, par->level, par->color_range, par->color_primaries,
+           par->color_trc, par->color_space, par->sample_aspect_ratio.num,
+           par->sample_aspect_ratio.den, rate.num, rate.den,
+           par->extradata_size);
+  return buf + to_hex64(fnv1a_64(par->extradata, par->extradata_size));
+}
+
+// HEVC with all parameter sets in hvcC can be copied into an hvc1 track.
+static bool copyable_stream(const AVCodecParameters *par) {
+  return par->codec_id == AV_CODEC_ID_HEVC && par->extradata_size > 0 &&
+         par->codec_tag != MKTAG('h', 'e', 'v', '1');
+}
+
+bool FFmpegWrapper::concatToMov(const std::vector<std::string> &nextClips,
+                                const char *outputPath, ProgressCallback cb,
+                                void *user_data) {
+  if (!isOpen())
+    return false;
+  TraceSession trace(m_trace_path, &m_trace_depth);
+  OperationScope operation(this);
+  auto started_at = std::chrono::steady_clock::now();
+
+  std::vector<std::unique_ptr<FFmpegWrapper>> opened;
+  std::vector<FFmpegWrapper *> clips = {this};
+  for (const std::string &path : nextClips) {
+    opened.emplace_back(new FFmpegWrapper(path.c_str()));
+    if (!opened.back()->isOpen()) {
+      printf("[FFmpegWrapper] Error: Cannot open clip %s\n", path.c_str());
+      return false;
+    }
+    clips.push_back(opened.back().get());
+  }
+  for (const std::unique_ptr<FFmpegWrapper> &clip : opened)
+    adoptClip(clip.get());
+
+  // The largest group of identical copyable clips keeps its bitstream;
+  // everyone else is re-encoded to its geometry and frame rate.
+  size_t n = clips.size();
+  std::vector<std::string> keys;
+  for (FFmpegWrapper *clip : clips)
+    keys.push_back(stream_key(clip->m_fmt_ctx, clip->m_video_stream_idx));
+  int reference = -1;
+  size_t reference_count = 0;
+  for (size_t i = 0; i < n; i++) {
+    FFmpegWrapper *clip = clips[i];
+    if (!copyable_stream(
+            clip->m_fmt_ctx->streams[clip->m_video_stream_idx]->codecpar))
+      continue;
+    size_t count = (size_t)std::count(keys.begin(), keys.end(), keys[i]);
+    if (count > reference_count) {
+      reference = (int)i;
+      reference_count = count;
+    }
+  }
+
+  FFmpegWrapper *shape = clips[reference >= 0 ? reference : 0];
+  AVStream *shape_stream = shape->m_fmt_ctx->streams[shape->m_video_stream_idx];
+  AVRational shape_rate =
+      av_guess_frame_rate(shape->m_fmt_ctx, shape_stream, nullptr);
+  int fit_width = shape_stream->codecpar->width & ~1;
+  int fit_height = shape_stream->codecpar->height & ~1;
+  int fps = shape_rate.num > 0 ? (int)std::lround(av_q2d(shape_rate)) : 30;
+
+  std::vector<bool> copy(n, false);
+  for (size_t i = 0; reference >= 0 && i < n; i++)
+    copy[i] = keys[i] == keys[reference];
+
+  TranscodeSettings settings = defaultExportSettings();
+  settings.targetFps = fps;
+  settings.exactFps = true;
+  settings.fitWidth = fit_width;
+  settings.fitHeight = fit_height;
+  // The copied clips keep their bars; the re-encoded ones are fitted to them.
+  settings.autoCrop = false;
+
+  std::vector<std::string> encoded(n);
+  double total = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (!copy[i])
+      total += std::max(clips[i]->getDuration(), 1e-3);
+  }
+
+  std::string encoded_key;
+  double done = 0;
+  bool ok = true;
+  TranscodeStats stats = {};
+  std::vector<FrameQuality> quality; // Re-encoded clips only
+  for (size_t i = 0; ok && i < n; i++) {
+    if (copy[i] || !encoded[i].empty())
+      continue;
+    encoded[i] = std::string(outputPath) + ".clip" + std::to_string(i) + ".mov";
+    double share = std::max(clips[i]->getDuration(), 1e-3);
+    RunProgress progress = {cb, user_data, 0.95 * done / total,
+                            0.95 * share / total};
+    ok = clips[i]->transcodeInternal(encoded[i].c_str(), settings,
+                                     cb ? RunProgress::forward : nullptr,
+                                     &progress) &&
+         !m_should_stop;
+    add_run_stats(&stats, &quality, clips[i]->m_last_stats,
+                  clips[i]->m_frame_quality);
+    done += share;
+    if (!ok)
+      break;
+
+    FFmpegWrapper check(encoded[i].c_str());
+    std::string key =
+        check.isOpen() ? stream_key(check.m_fmt_ctx, check.m_video_stream_idx)
+                       : "";
+    if (encoded_key.empty())
+      encoded_key = key;
+    if (key.empty() || key != encoded_key) {
+      printf("[FFmpegWrapper] Error: Re-encoded clips disagree on stream "
+             "parameters\n");
+      ok = false;
+    } else if (reference >= 0 && copy[reference] && key != keys[reference]) {
+      // The copied clips came from a different encoder; nothing can be
+      // joined to them without re-encoding them as well.
+      printf("[FFmpegWrapper] Clip %d's encoder differs from ours; "
+             "re-encoding its group too\n",
+             reference);
+      for (size_t j = 0; j < n; j++) {
+        if (copy[j]) {
+          copy[j] = false;
+          total += std::max(clips[j]->getDuration(), 1e-3);
+        }
+      }
+      i = (size_t)-1; // Restart the scan; finished clips are skipped
+    }
+  }
+
+  int copied = 0;
+  std::vector<std::string> inputs;
+  for (size_t i = 0; i < n; i++) {
+    copied += copy[i];
+    inputs.push_back(copy[i] ? (i == 0 ? m_path : nextClips[i - 1])
+                             : encoded[i]);
+  }
+  if (ok) {
+    printf("[FFmpegWrapper] Concatenating %zu clips (%d stream-copied)\n", n,
+           copied);
+    TraceSpan span("concat");
+    ok = concat_mov_segments(inputs, outputPath, settings.timescale,
+                             &m_fmt_ctx->interrupt_callback);
+  }
+  for (const std::string &path : encoded) {
+    if (!path.empty())
+      std::remove(path.c_str());
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_pause_mutex);
+    m_children.clear();
+  }
+
+  // The copied clips only show up in the joined file.
+  if (ok && !measure_bitrate(outputPath, settings.playbackBudget, &stats))
+    printf("[FFmpegWrapper] Cannot measure the bitrate of %s\n", outputPath);
+  stats.memoryBudgetBytes = m_memory_budget;
+  stats.clipsCopied = copied;
+  stats.clipsReencoded = (int)n - copied;
+  m_frame_quality = std::move(quality);
+  stats.framesMeasured = (int64_t)m_frame_quality.size();
+  QualityMeter::summarize(m_frame_quality, &stats.meanPsnr, &stats.meanSsim,
+                          &stats.minSsim);
+  stats.elapsedSeconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - started_at)
+                             .count();
+  m_last_stats = stats;
+  if (ok && cb)
+    cb(1.0, user_data);
+  return ok;
+}
+
+// Source keyframe times in [startTime, endTime], from packet flags alone.
+bool FFmpegWrapper::scanKeyframes(double startTime, double endTime,
+                                  std::vector<double> *times) {
+  AVStream *st = m_fmt_ctx->streams[m_video_stream_idx];
+  double tb = av_q2d(st->time_base);
+  if (av_seek_frame(m_fmt_ctx, m_video_stream_idx, llround(startTime / tb),
+                    AVSEEK_FLAG_BACKWARD) < 0)
+    return false;
+
+  while (!m_should_stop && av_read_frame(m_fmt_ctx, m_pkt) >= 0) {
+    if (m_pkt->stream_index == m_video_stream_idx) {
+      int64_t ts = m_pkt->pts != AV_NOPTS_VALUE ? m_pkt->pts : m_pkt->dts;
+      if (m_pkt->dts != AV_NOPTS_VALUE && m_pkt->dts * tb > endTime) {
+        av_packet_unref(m_pkt);
+        break;
+      }
+      if ((m_pkt->flags & AV_PKT_FLAG_KEY) && ts != AV_NOPTS_VALUE &&
+          ts * tb <= endTime)
+        times->push_back(ts * tb);
+    }
+    av_packet_unref(m_pkt);
+  }
+
+  av_seek_frame(m_fmt_ctx, -1, 0, AVSEEK_FLAG_BACKWARD);
+  avcodec_flush_buffers(m_dec_ctx);
+  std::sort(times->begin(), times->end());
+  return !m_should_stop;
+}
+
+
+bool FFmpegWrapper::exportWithGopCache(const char *outputPath,
+                                       const TranscodeSettings &settings,
+                                       ProgressCallback progressCallback,
+                                       void *user_data) {
+  OperationScope operation(this);
+  auto started_at = std::chrono::steady_clock::now();
+
+  if (!openDecoder(settings.decodeTier))
+    return false;
+
+  double end = settings.endTime > 0 ? settings.endTime : getDuration();
+  std::vector<double> keyframes;
+  if (!scanKeyframes(settings.startTime, end, &keyframes))
+    return false;
+
+  // Crop once for the whole trim so every unit has the same geometry.
+  TranscodeSettings run = settings;
+  run.autoCrop = false;
+  CropRect crop;
+  if (settings.autoCrop && settings.crop.width == 0 &&
+      detectCrop(settings.startTime, settings.endTime, &crop))
+    run.crop = crop;
+
+  TranscodeSettings keyed = run;
+  keyed.startTime = 0;
+  keyed.endTime = 0;
+  std::string settings_key = settingsKey(keyed);
+  std::string identity = file_identity(m_path.c_str());
+
+  std::vector<double> bounds = {settings.startTime};
+  for (double t : keyframes) {
+    if (t > bounds.back() + 1e-6 && t < end - 1e-6)
+      bounds.push_back(t);
+  }
+  bounds.push_back(end);
+
+  EncodedGopCache cache(m_gop_cache_dir, m_gop_cache_capacity);
+  std::vector<GopUnit> units;
+  std::vector<bool> cached;
+  int reused = 0;
+  for (size_t i = 0; i + 1 < bounds.size(); i++) {
+    units.push_back({bounds[i], bounds[i + 1],
+                     EncodedGopCache::unitKey(identity, settings_key,
+                                              bounds[i], bounds[i + 1])});
+    cached.push_back(cache.lookup(units.back().key));
+    reused += cached.back();
+  }
+  printf("[FFmpegWrapper] GOP cache: %d of %zu unit(s) reusable\n", reused,
+         units.size());
+
+  AVRational frame_rate = av_guess_frame_rate(
+      m_fmt_ctx, m_fmt_ctx->streams[m_video_stream_idx], nullptr);
+  double half_frame = frame_rate.num > 0 ? 0.5 / av_q2d(frame_rate) : 1 / 120.0;
+  double total = std::max(end - settings.startTime, 1e-6);
+
+  // Encode each run of consecutive misses in one encoder session.
+  TranscodeStats stats = {};
+  std::vector<FrameQuality> quality; // Encoded units only
+  bool ok = true;
+  for (size_t first = 0; ok && first < units.size();) {
+    if (cached[first]) {
+      first++;
+      continue;
+    }
+    size_t last = first;
+    while (last < units.size() && !cached[last])
+      last++;
+
+    std::vector<GopUnit> run_units(units.begin() + first,
+                                   units.begin() + last);
+    run.startTime = units[first].startTime;
+    run.endTime = last == units.size() ? settings.endTime
+                                       : units[last].startTime - half_frame;
+    run.gopCache = &cache;
+    run.gopUnits = &run_units;
+
+    RunProgress progress = {progressCallback, user_data,
+                            (units[first].startTime - settings.startTime) /
+                                total,
+                            (units[last - 1].endTime - units[first].startTime) /
+                                total};
+    ok = transcodeInternal(outputPath, run,
+                           progressCallback ? RunProgress::forward : nullptr,
+                           &progress) &&
+         !m_should_stop;
+
+    add_run_stats(&stats, &quality, m_last_stats, m_frame_quality);
+    first = last;
+  }
+
+  if (ok) {
+    // Units with no frame of their own were never written.
+    std::vector<std::string> inputs;
+    for (const GopUnit &unit : units) {
+      if (cache.lookup(unit.key))
+        inputs.push_back(cache.unitPath(unit.key));
+    }
+    TraceSpan span("concat");
+    ok = !inputs.empty() &&
+         concat_mov_segments(inputs, outputPath, settings.timescale,
+                             &m_fmt_ctx->interrupt_callback);
+  }
+  cache.evict();
+
+  // Each run measured only what it encoded, with a fresh VBV model; reused
+  // units and the joins between runs are only visible in the final file.
+  if (ok) {
+    TraceSpan span("playback budget");
+    bool budget = settings.playbackBudget && settings.encoderName &&
+                  strcmp(settings.encoderName, "libx265") == 0;
+    if (!measure_bitrate(outputPath, budget, &stats))
+      printf("[FFmpegWrapper] Cannot measure the bitrate of %s\n",
+             outputPath);
+  }
+
+  stats.memoryBudgetBytes = m_memory_budget;
+  stats.crop = run.crop;
+  stats.gopsReused = reused;
+  stats.gopsEncoded = (int)units.size() - reused;
+  m_frame_quality = std::move(quality);
+  stats.framesMeasured = (int64_t)m_frame_quality.size();
+  QualityMeter::summarize(m_frame_quality, &stats.meanPsnr, &stats.meanSsim,
+                          &stats.minSsim);
+  stats.elapsedSeconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - started_at)
+                             .count();
+  m_last_stats = stats;
+  if (ok && progressCallback)
+    progressCallback(1.0, user_data);
+  return ok;
+}
+
+// Presentation times of every source frame, and the keyframes the stream can
+// be cut in front of: IDR pictures, and CRA pictures whose GOP has no RASL
+// pictures. Only HEVC is classified; other codecs have no cut points.
+bool FFmpegWrapper::scanSeamPoints(std::vector<double> *frameTimes,
+                                   std::vector<double> *cutTimes) {
+  AVStream *st = m_fmt_ctx->streams[m_video_stream_idx];
+  double tb = av_q2d(st->time_base);
+  bool hevc = st->codecpar->codec_id == AV_CODEC_ID_HEVC;
+  int length_size = hevc_nal_length_size(st->codecpar);
+  if (av_seek_frame(m_fmt_ctx, -1, 0, AVSEEK_FLAG_BACKWARD) < 0)
+    return false;
+
+  double cra = -1; // Last CRA, until a RASL picture rules it out
+  while (!m_should_stop && av_read_frame(m_fmt_ctx, m_pkt) >= 0) {
+    if (m_pkt->stream_index == m_video_stream_idx &&
+        m_pkt->pts != AV_NOPTS_VALUE) {
+      double t = m_pkt->pts * tb;
+      frameTimes->push_back(t);
+      SeamPicture kind =
+          hevc ? hevc_seam_picture(m_pkt->data, m_pkt->size, length_size)
+               : SeamPicture::Other;
+      if (kind == SeamPicture::Idr || kind == SeamPicture::Cra) {
+        if (cra >= 0)
+          cutTimes->push_back(cra);
+        cra = kind == SeamPicture::Cra ? t : -1;
+        if (kind == SeamPicture::Idr)
+          cutTimes->push_back(t);
+      } else if (kind == SeamPicture::Rasl) {
+        cra = -1;
+      }
+    }
+    av_packet_unref(m_pkt);
+  }
+  if (cra >= 0)
+    cutTimes->push_back(cra);
+
+  av_seek_frame(m_fmt_ctx, -1, 0, AVSEEK_FLAG_BACKWARD);
+  avcodec_flush_buffers(m_dec_ctx);
+  std::sort(frameTimes->begin(), frameTimes->end());
+  std::sort(cutTimes->begin(), cutTimes->end());
+  return !m_should_stop;
+}
+
+// References to the first `count` decoded frames, in presentation order.
+bool FFmpegWrapper::decodeLeadingFrames(int count,
+                                        std::vector<AVFrame *> *frames) {
+  if (av_seek_frame(m_fmt_ctx, -1, 0, AVSEEK_FLAG_BACKWARD) < 0)
+    return false;
+  avcodec_flush_buffers(m_dec_ctx);
+
+  AVFrame *dec_frame = av_frame_alloc();
+  while (dec_frame && (int)frames->size() < count && !m_should_stop) {
+    bool eof = av_read_frame(m_fmt_ctx, m_pkt) < 0;
+    if (eof)
+      avcodec_send_packet(m_dec_ctx, nullptr);
+    else if (m_pkt->stream_index == m_video_stream_idx)
+      avcodec_send_packet(m_dec_ctx, m_pkt);
+    av_packet_unref(m_pkt);
+    while ((int)frames->size() < count &&
+           avcodec_receive_frame(m_dec_ctx, dec_frame) == 0) {
+      frames->push_back(av_frame_clone(dec_frame));
+      av_frame_unref(dec_frame);
+      if (!frames->back()) {
+        frames->pop_back();
+        eof = true;
+        break;
+      }
+    }
+    if (eof)
+      break;
+  }
+  av_frame_free(&dec_frame);
+
+  av_seek_frame(m_fmt_ctx, -1, 0, AVSEEK_FLAG_BACKWARD);
+  avcodec_flush_buffers(m_dec_ctx);
+  return (int)frames->size() == count;
+}
+
+bool FFmpegWrapper::loopSeamToMov(const char *outputPath, int blendFrames,
+                                  ProgressCallback cb, void *user_data) {
+  if (!isOpen() || blendFrames <= 0)
+    return false;
+  TraceSession trace(m_trace_path, &m_trace_depth);
+  OperationScope operation(this);
+  auto started_at = std::chrono::steady_clock::now();
+
+  if (!openDecoder(DecodeTier::Final))
+    return false;
+  std::vector<double> frame_times;
+  std::vector<double> cuts;
+  if (!scanSeamPoints(&frame_times, &cuts))
+    return false;
+  int n = std::min({blendFrames, kMaxLoopSeamFrames,
+                    (int)frame_times.size() / 3});
+  if (n <= 0) {
+    printf("[FFmpegWrapper] Error: Clip too short for a loop seam\n");
+    return false;
+  }
+
+  std::vector<AVFrame *> head;
+  bool ok = decodeLeadingFrames(n, &head);
+  auto free_head = [&]() {
+    for (AVFrame *frame : head)
+      av_frame_free(&frame);
+  };
+  if (!ok) {
+    free_head();
+    return false;
+  }
+
+  AVStream *st = m_fmt_ctx->streams[m_video_stream_idx];
+  AVRational rate = av_guess_frame_rate(m_fmt_ctx, st, nullptr);
+  double half_frame = rate.num > 0 ? 0.5 / av_q2d(rate) : 1 / 120.0;
+  // The loop now starts after the frames that were faded into the end.
+  double start = frame_times[n];
+  double blend_start = frame_times[frame_times.size() - n];
+  double end = std::max(getDuration(), frame_times.back() + 2 * half_frame);
+
+  // Copy from the first cut at or after the new start up to the last one
+  // at or before the fade.
+  double first_cut = -1;
+  double last_cut = -1;
+  for (double t : cuts) {
+    if (first_cut < 0 && t >= start - half_frame)
+      first_cut = t;
+    if (t <= blend_start + half_frame)
+      last_cut = t;
+  }
+  TranscodeSettings settings = defaultExportSettings();
+  settings.startTime = start;
+  // Every part must keep the source geometry to join the copied middle.
+  settings.autoCrop = false;
+  settings.blendFrames = &head;
+  settings.blendStart = blend_start;
+
+  // Re-encoded parts are 10-bit 4:2:0 (see transcodeInternal); a source in
+  // any other format can never share their parameter sets.
+  bool segmented = copyable_stream(st->codecpar) &&
+                   st->codecpar->format == AV_PIX_FMT_YUV420P10LE &&
+                   first_cut >= 0 && last_cut > first_cut + half_frame;
+
+  struct Part {
+    std::string path;
+    double startTime;
+    double endTime; // 0 = to the end
+    bool copy;
+  };
+  std::vector<Part> parts;
+  std::string base = outputPath;
+  if (segmented) {
+    if (first_cut > start + half_frame)
+      parts.push_back({base + ".seam0.mov", start, first_cut - half_frame,
+                       false});
+    parts.push_back({base + ".seam1.mov", first_cut, last_cut - half_frame,
+                     true});
+    parts.push_back({base + ".seam2.mov", last_cut, 0, false});
+  }
+
+  // Copying costs next to nothing; give it a token share of the progress.
+  auto share = [&](const Part &part) {
+    double length = (part.endTime > 0 ? part.endTime : end) - part.startTime;
+    return std::max(length, 1e-3) * (part.copy ? 0.05 : 1.0);
+  };
+  double total = 0;
+  for (const Part &part : parts)
+    total += share(part);
+
+  // The seam parts go first. Whether the middle can be copied is only known
+  // once their parameter sets are; if it can't, it is encoded as well and
+  // the parts are still joined.
+  std::vector<size_t> order;
+  for (size_t i = 0; i < parts.size(); i++) {
+    if (!parts[i].copy)
+      order.push_back(i);
+  }
+  for (size_t i = 0; i < parts.size(); i++) {
+    if (parts[i].copy)
+      order.push_back(i);
+  }
+
+  std::string source_key = stream_key(m_fmt_ctx, m_video_stream_idx);
+  std::string encoded_key;
+  TranscodeStats stats = {};
+  std::vector<FrameQuality> quality;
+  double done = 0;
+  double copied = 0;
+  for (size_t i : order) {
+    Part &part = parts[i];
+    if (part.copy && encoded_key != source_key) {
+      printf("[FFmpegWrapper] Loop seam: re-encoded GOPs do not match the "
+             "source stream; re-encoding the middle too\n");
+      total -= share(part);
+      part.copy = false;
+      total += share(part);
+    }
+    TranscodeSettings run = settings;
+    run.startTime = part.startTime;
+    run.endTime = part.endTime;
+    run.useStreamCopy = part.copy;
+    if (part.endTime > 0)
+      run.blendFrames = nullptr;
+    RunProgress progress = {cb, user_data, 0.95 * done / total,
+                            0.95 * share(part) / total};
+    ok = transcodeInternal(part.path.c_str(), run,
+                           cb ? RunProgress::forward : nullptr, &progress) &&
+         !m_should_stop;
+    done += share(part);
+    if (!ok)
+      break;
+
+    if (part.copy) {
+      copied += part.endTime + half_frame - part.startTime;
+      continue;
+    }
+    add_run_stats(&stats, &quality, m_last_stats, m_frame_quality);
+
+    FFmpegWrapper check(part.path.c_str());
+    std::string key =
+        check.isOpen() ? stream_key(check.m_fmt_ctx, check.m_video_stream_idx)
+                       : "";
+    if (encoded_key.empty())
+      encoded_key = key;
+    if (key.empty() || key != encoded_key) {
+      printf("[FFmpegWrapper] Loop seam: re-encoded parts disagree on stream "
+             "parameters; re-encoding the whole clip\n");
+      segmented = false;
+      break;
+    }
+  }
+
+  if (ok && segmented) {
+    std::vector<std::string> inputs;
+    for (const Part &part : parts)
+      inputs.push_back(part.path);
+    printf("[FFmpegWrapper] Loop seam: %.2fs stream-copied between %.2fs "
+           "and %.2fs\n",
+           copied, first_cut, last_cut);
+    TraceSpan span("concat");
+    ok = concat_mov_segments(inputs, outputPath, settings.timescale,
+                             &m_fmt_ctx->interrupt_callback);
+  }
+  for (const Part &part : parts)
+    std::remove(part.path.c_str());
+
+  if (ok && !segmented) {
+    RunProgress progress = {cb, user_data, 0, 1};
+    ok = transcodeInternal(outputPath, settings,
+                           cb ? RunProgress::forward : nullptr, &progress) &&
+         !m_should_stop;
+    stats = m_last_stats;
+    quality = m_frame_quality;
+    copied = 0;
+  }
+  free_head();
+
+  if (ok && !measure_bitrate(outputPath, settings.playbackBudget, &stats))
+    printf("[FFmpegWrapper] Cannot measure the bitrate of %s\n", outputPath);
+  stats.memoryBudgetBytes = m_memory_budget;
+  m_frame_quality = std::move(quality);
+  stats.framesMeasured = (int64_t)m_frame_quality.size();
+  QualityMeter::summarize(m_frame_quality, &stats.meanPsnr, &stats.meanSsim,
+                          &stats.minSsim);
+  stats.seamSecondsCopied = copied;
+  stats.elapsedSeconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - started_at)
+                             .count();
+  m_last_stats = stats;
+  if (ok && cb)
+    cb(1.0, user_data);
+  return ok;
+}
+
+bool FFmpegWrapper::reverseToMov(const char *outputPath, double startTime,
+                                 double endTime, bool boomerang,
+                                 ProgressCallback cb, void *user_data) {
+  if (!isOpen())
+    return false;
+  TraceSession trace(m_trace_path, &m_trace_depth);
+  OperationScope operation(this);
+  if (!openDecoder(DecodeTier::Final))
+    return false;
+
+  double end = endTime > 0 ? endTime : getDuration();
+  std::vector<double> keyframes;
+  if (!scanKeyframes(startTime, end, &keyframes))
+    return false;
+
+  int64_t buffer_bytes = m_memory_budget > 0
+                             ? m_memory_budget / 4
+                             : ReverseFrameSource::kDefaultBufferBytes;
+  ReverseFrameSource frames(m_fmt_ctx, m_video_stream_idx, keyframes,
+                            startTime, endTime, buffer_bytes,
+                            std::string(outputPath) + ".spill.h264",
+                            &m_should_stop);
+  if (frames.failed()) {
+    printf("[FFmpegWrapper] Error: Cannot decode the source in reverse\n");
+    return false;
+  }
+
+  TranscodeSettings settings = defaultExportSettings();
+  settings.startTime = startTime;
+  settings.endTime = endTime;
+  settings.reverseFrames = &frames;
+  settings.boomerang = boomerang;
+  bool ok = transcodeInternal(outputPath, settings, cb, user_data) &&
+            !m_should_stop;
+
+  m_last_stats.reverseGopsSpilled = frames.gopsSpilled();
+  m_last_stats.reversePeakBufferedBytes = frames.peakBufferedBytes();
+  printf("[FFmpegWrapper] Reverse: %d GOP(s) spilled, peak %lld MB "
+         "buffered\n",
+         frames.gopsSpilled(), (long long)(frames.peakBufferedBytes() >> 20));
+  return ok;
+}
+
 // C Bridge Implementations
 extern "C" {
 FFmpegWrapperRef FFmpegWrapper_Create(const char *path) {
   return (FFmpegWrapperRef) new FFmpegWrapper(path);
 }
+FFmpegWrapperRef FFmpegWrapper_CreateGrowing(const char *path,
+                                             const char *completionMarker) {
+  return (FFmpegWrapperRef) new FFmpegWrapper(path, completionMarker);
+}
+void FFmpegWrapper_MarkInputComplete(FFmpegWrapperRef ref) {
+  if (ref) {
+    ((FFmpegWrapper *)ref)->markInputComplete();
+  }
+}
 void FFmpegWrapper_Destroy(FFmpegWrapperRef ref) {
   delete (FFmpegWrapper *)ref;
 }
@@ -941,9 +2854,270 @@ bool FFmpegWrapper_RemuxToMov(FFmpegWrapperRef ref, const char *outputPath,
                    (FFmpegWrapper::ProgressCallback)cb, user_data);
 }
 
+bool FFmpegWrapper_ConcatToMov(FFmpegWrapperRef ref,
+                               const char *const *nextPaths, int count,
+                               const char *outputPath,
+                               FFmpegProgressCallback cb, void *user_data) {
+  if (!ref || (count > 0 && !nextPaths))
+    return false;
+  std::vector<std::string> next;
+  for (int i = 0; i < count; i++)
+    next.push_back(nextPaths[i] ? nextPaths[i] : "");
+  return ((FFmpegWrapper *)ref)
+      ->concatToMov(next, outputPath, (FFmpegWrapper::ProgressCallback)cb,
+                    user_data);
+}
+
+bool FFmpegWrapper_LoopSeamToMov(FFmpegWrapperRef ref, const char *outputPath,
+                                 int blendFrames, FFmpegProgressCallback cb,
+                                 void *user_data) {
+  if (!ref)
+    return false;
+  return ((FFmpegWrapper *)ref)
+      ->loopSeamToMov(outputPath, blendFrames,
+                      (FFmpegWrapper::ProgressCallback)cb, user_data);
+}
+
+bool FFmpegWrapper_ReverseToMov(FFmpegWrapperRef ref, const char *outputPath,
+                                double startTime, double endTime,
+                                bool boomerang, FFmpegProgressCallback cb,
+                                void *user_data) {
+  if (!ref)
+    return false;
+  return ((FFmpegWrapper *)ref)
+      ->reverseToMov(outputPath, startTime, endTime, boomerang,
+                     (FFmpegWrapper::ProgressCallback)cb, user_data);
+}
+
+bool FFmpegWrapper_GenerateProxy(FFmpegWrapperRef ref, const char *outputPath,
+                                 int targetHeight, FFmpegProgressCallback cb,
+                                 void *user_data) {
+  if (!ref)
+    return false;
+  return ((FFmpegWrapper *)ref)
+      ->generateProxy(outputPath, targetHeight,
+                      (FFmpegWrapper::ProgressCallback)cb, user_data);
+}
+
+bool FFmpegWrapper_GetFileIdentity(FFmpegWrapperRef ref, char *buffer,
+                                   int bufferSize) {
+  if (!ref || !buffer || bufferSize <= 0)
+    return false;
+  std::string identity = ((FFmpegWrapper *)ref)->getFileIdentity();
+  if (identity.empty() || (int)identity.size() >= bufferSize)
+    return false;
+  memcpy(buffer, identity.c_str(), identity.size() + 1);
+  return true;
+}
+
+static bool copy_frame_info(const VideoFrameInfo &info,
+                            FFmpegVideoFrame *outFrame) {
+  if (!info.planes[0])
+    return false;
+  for (int i = 0; i < 4; i++) {
+    outFrame->planes[i] = info.planes[i];
+    outFrame->strides[i] = info.strides[i];
+  }
+  outFrame->width = info.width;
+  outFrame->height = info.height;
+  outFrame->pixelFormat = info.format;
+  outFrame->timestampNs = info.timestamp_ns;
+  outFrame->isKey = info.is_key;
+  return true;
+}
+
+bool FFmpegWrapper_SeekToFrame(FFmpegWrapperRef ref, int64_t pts,
+                               FFmpegVideoFrame *outFrame) {
+  if (!ref || !outFrame)
+    return false;
+  return copy_frame_info(((FFmpegWrapper *)ref)->seekToFrame(pts), outFrame);
+}
+
+bool FFmpegWrapper_FrameAt(FFmpegWrapperRef ref, double time,
+                           FFmpegVideoFrame *outFrame) {
+  if (!ref || !outFrame)
+    return false;
+  return copy_frame_info(((FFmpegWrapper *)ref)->frameAt(time), outFrame);
+}
+
+void FFmpegWrapper_SetFrameCacheCapacity(FFmpegWrapperRef ref, int64_t bytes) {
+  if (ref) {
+    ((FFmpegWrapper *)ref)->setFrameCacheCapacity(bytes);
+  }
+}
+
+void FFmpegWrapper_SetPreviewRing(FFmpegWrapperRef ref,
+                                  SharedFrameRingRef ring) {
+  if (ref) {
+    ((FFmpegWrapper *)ref)->setPreviewRing((SharedFrameRing *)ring);
+  }
+}
+
+void FFmpegWrapper_SetAutoCrop(FFmpegWrapperRef ref, bool enabled) {
+  if (ref) {
+    ((FFmpegWrapper *)ref)->setAutoCrop(enabled);
+  }
+}
+
+bool FFmpegWrapper_DetectCrop(FFmpegWrapperRef ref, double startTime,
+                              double endTime, FFmpegCropRect *outRect) {
+  if (!ref || !outRect)
+    return false;
+  CropRect rect;
+  if (!((FFmpegWrapper *)ref)->detectCrop(startTime, endTime, &rect))
+    return false;
+  outRect->x = rect.x;
+  outRect->y = rect.y;
+  outRect->width = rect.width;
+  outRect->height = rect.height;
+  return true;
+}
+
+void FFmpegWrapper_SetPlaybackBudget(FFmpegWrapperRef ref, bool enabled) {
+  if (ref) {
+    ((FFmpegWrapper *)ref)->setPlaybackBudget(enabled);
+  }
+}
+
+void FFmpegWrapper_SetMeasureQuality(FFmpegWrapperRef ref, bool enabled) {
+  if (ref) {
+    ((FFmpegWrapper *)ref)->setMeasureQuality(enabled);
+  }
+}
+
+void FFmpegWrapper_SetTraceFile(FFmpegWrapperRef ref, const char *path) {
+  if (ref) {
+    ((FFmpegWrapper *)ref)->setTraceFile(path);
+  }
+}
+
+void FFmpegWrapper_SetDropDuplicates(FFmpegWrapperRef ref, bool enabled) {
+  if (ref) {
+    ((FFmpegWrapper *)ref)->setDropDuplicates(enabled);
+  }
+}
+
 void FFmpegWrapper_Stop(FFmpegWrapperRef ref) {
   if (ref) {
     ((FFmpegWrapper *)ref)->stop();
   }
 }
+
+void FFmpegWrapper_Pause(FFmpegWrapperRef ref) {
+  if (ref) {
+    ((FFmpegWrapper *)ref)->pause();
+  }
+}
+
+void FFmpegWrapper_Resume(FFmpegWrapperRef ref) {
+  if (ref) {
+    ((FFmpegWrapper *)ref)->resume();
+  }
+}
+
+void FFmpegWrapper_SetCheckpointDirectory(FFmpegWrapperRef ref,
+                                          const char *dir) {
+  if (ref) {
+    ((FFmpegWrapper *)ref)->setCheckpointDirectory(dir);
+  }
+}
+
+void FFmpegWrapper_DiscardCheckpoint(FFmpegWrapperRef ref) {
+  if (ref) {
+    ((FFmpegWrapper *)ref)->discardCheckpoint();
+  }
+}
+
+void FFmpegWrapper_SetGopCacheDirectory(FFmpegWrapperRef ref, const char *dir,
+                                        int64_t capacityBytes) {
+  if (ref) {
+    ((FFmpegWrapper *)ref)->setGopCacheDirectory(dir, capacityBytes);
+  }
+}
+
+void FFmpegWrapper_SetDecodeTier(FFmpegWrapperRef ref, FFmpegDecodeTier tier) {
+  if (ref) {
+    ((FFmpegWrapper *)ref)
+        ->setDecodeTier(tier == FFmpegDecodeTierPreview ? DecodeTier::Preview
+                                                        : DecodeTier::Final);
+  }
+}
+
+void FFmpegWrapper_SetPreviewEngine(FFmpegWrapperRef ref,
+                                    FFmpegPreviewEngine engine) {
+  if (ref) {
+    ((FFmpegWrapper *)ref)
+        ->setPreviewEngine(engine == FFmpegPreviewEngineHardware
+                               ? PreviewEngine::Hardware
+                           : engine == FFmpegPreviewEngineSoftware
+                               ? PreviewEngine::Software
+                               : PreviewEngine::Auto);
+  }
+}
+
+void FFmpegWrapper_SetMemoryBudget(FFmpegWrapperRef ref, int64_t bytes) {
+  if (ref) {
+    ((FFmpegWrapper *)ref)->setMemoryBudget(bytes);
+  }
+}
+
+bool FFmpegWrapper_GetLastStats(FFmpegWrapperRef ref,
+                                FFmpegTranscodeStats *outStats) {
+  if (!ref || !outStats)
+    return false;
+  const TranscodeStats &stats = ((FFmpegWrapper *)ref)->getLastStats();
+  outStats->framesDecoded = stats.framesDecoded;
+  outStats->framesEncoded = stats.framesEncoded;
+  outStats->elapsedSeconds = stats.elapsedSeconds;
+  outStats->memoryBudgetBytes = stats.memoryBudgetBytes;
+  outStats->estimatedMemoryBytes = stats.estimatedMemoryBytes;
+  outStats->peakResidentBytes = stats.peakResidentBytes;
+  outStats->peakMemoryBytes = stats.peakMemoryBytes;
+  outStats->decoderThreads = stats.decoderThreads;
+  outStats->encoderFrameThreads = stats.encoderFrameThreads;
+  outStats->encoderRcLookahead = stats.encoderRcLookahead;
+  outStats->encoderLookaheadSlices = stats.encoderLookaheadSlices;
+  outStats->filterThreads = stats.filterThreads;
+  outStats->cropX = stats.crop.x;
+  outStats->cropY = stats.crop.y;
+  outStats->cropWidth = stats.crop.width;
+  outStats->cropHeight = stats.crop.height;
+  outStats->framesMerged = stats.framesMerged;
+  outStats->gopsReused = stats.gopsReused;
+  outStats->gopsEncoded = stats.gopsEncoded;
+  outStats->softwarePreview = stats.softwarePreview;
+  outStats->framesMeasured = stats.framesMeasured;
+  outStats->meanPsnr = stats.meanPsnr;
+  outStats->meanSsim = stats.meanSsim;
+  outStats->minSsim = stats.minSsim;
+  outStats->clipsCopied = stats.clipsCopied;
+  outStats->clipsReencoded = stats.clipsReencoded;
+  outStats->seamFramesBlended = stats.seamFramesBlended;
+  outStats->seamSecondsCopied = stats.seamSecondsCopied;
+  outStats->reverseGopsSpilled = stats.reverseGopsSpilled;
+  outStats->reversePeakBufferedBytes = stats.reversePeakBufferedBytes;
+  outStats->peakBitrate = stats.peakBitrate;
+  outStats->playbackLevel = stats.playbackLevel;
+  outStats->vbvMaxrate = stats.vbvMaxrate;
+  outStats->vbvUnderflows = stats.vbvUnderflows;
+  outStats->decodeLoad = stats.decodeLoad;
+  outStats->framesChromaConverted = stats.framesChromaConverted;
+  return true;
+}
+
+int FFmpegWrapper_GetFrameQuality(FFmpegWrapperRef ref,
+                                  FFmpegFrameQuality *outFrames,
+                                  int capacity) {
+  if (!ref)
+    return 0;
+  const std::vector<FrameQuality> &frames =
+      ((FFmpegWrapper *)ref)->getFrameQuality();
+  int count = std::min<int>((int)frames.size(), outFrames ? capacity : 0);
+  for (int i = 0; i < count; i++) {
+    outFrames[i].time = frames[i].time;
+    outFrames[i].psnr = frames[i].psnr;
+    outFrames[i].ssim = frames[i].ssim;
+  }
+  return (int)frames.size();
+}
 }
@@ -0,0 +1,45 @@
+#include "FileIdentity.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+#include <sys/stat.h>
+
+std::string file_identity(const char *path) {
+  struct stat st;
+  if (!path || stat(path, &st) != 0)
+    return "";
+
+#if defined(__APPLE__)
+  int64_t mtime_ns = (int64_t)st.st_mtimespec.tv_sec * 1000000000LL +
+                     st.st_mtimespec.tv_nsec;
+#else
+  int64_t mtime_ns =
+      (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+
+  char buf[128];
+  snprintf(buf, sizeof(buf), "%" PRIx64 "-%" PRIx64 "-%" PRIx64 "-%" PRIx64,
+           (uint64_t)st.st_dev, (uint64_t)st.st_ino, (uint64_t)st.st_size,
+           (uint64_t)mtime_ns);
+  return buf;
+}
+
+uint64_t fnv1a_64(const void *data, size_t size, uint64_t seed) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  uint64_t hash = seed;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+uint64_t fnv1a_64(const std::string &text) {
+  return fnv1a_64(text.data(), text.size());
+}
+
+std::string to_hex64(uint64_t value) {
+  char buf[17];
+  snprintf(buf, sizeof(buf), "%016" PRIx64, value);
+  return buf;
+}
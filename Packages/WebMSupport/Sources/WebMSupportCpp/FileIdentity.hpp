@@ -0,0 +1,19 @@
+#ifndef FILE_IDENTITY_HPP
+#define FILE_IDENTITY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Identity of a media file on disk (device, inode, size, mtime). Changes
+// whenever the file is replaced or rewritten, so it can key caches and
+// journals that must not outlive the source. Empty if the file is missing.
+std::string file_identity(const char *path);
+
+// 64-bit FNV-1a, used to turn settings strings into short cache keys.
+uint64_t fnv1a_64(const void *data, size_t size,
+                  uint64_t seed = 0xcbf29ce484222325ULL);
+uint64_t fnv1a_64(const std::string &text);
+std::string to_hex64(uint64_t value);
+
+#endif
@@ -0,0 +1,135 @@
+#include "GrowingFileInput.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+extern "C" {
+#include <libavformat/avio.h>
+#include <libavutil/error.h>
+#include <libavutil/mem.h>
+}
+
+static const int kBufferSize = 1 << 16;
+static const int kPollMilliseconds = 50;
+
+GrowingFileInput *GrowingFileInput::open(const char *path,
+                                         const char *completionMarker,
+                                         const std::atomic<bool> *stop) {
+  int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return nullptr;
+
+  GrowingFileInput *input = new GrowingFileInput();
+  input->m_fd = fd;
+  input->m_marker = completionMarker ? completionMarker : "";
+  input->m_stop = stop;
+
+  unsigned char *buffer = (unsigned char *)av_malloc(kBufferSize);
+  if (buffer)
+    input->m_avio = avio_alloc_context(buffer, kBufferSize, 0, input,
+                                       read_packet, nullptr, seek);
+  if (!input->m_avio) {
+    av_free(buffer);
+    delete input;
+    return nullptr;
+  }
+  return input;
+}
+
+GrowingFileInput::~GrowingFileInput() {
+  if (m_avio) {
+    av_freep(&m_avio->buffer);
+    avio_context_free(&m_avio);
+  }
+  if (m_fd >= 0)
+    close(m_fd);
+}
+
+bool GrowingFileInput::isComplete() const {
+  if (!m_complete && !m_marker.empty() && access(m_marker.c_str(), F_OK) == 0)
+    m_complete = true;
+  return m_complete;
+}
+
+int64_t GrowingFileInput::availableBytes() const {
+  struct stat st;
+  return fstat(m_fd, &st) == 0 ? (int64_t)st.st_size : 0;
+}
+
+int GrowingFileInput::waitForData(int64_t position) {
+  auto last_growth = std::chrono::steady_clock::now();
+  int64_t last_size = availableBytes();
+  while (true) {
+    // Checked before the size so bytes written just before completion are
+    // never mistaken for EOF.
+    bool complete = isComplete();
+    int64_t size = availableBytes();
+    if (size > position)
+      return 0;
+    if (complete)
+      return AVERROR_EOF;
+    if (m_stop && m_stop->load())
+      return AVERROR_EXIT;
+
+    auto now = std::chrono::steady_clock::now();
+    if (size != last_size) {
+      last_size = size;
+      last_growth = now;
+    } else if (now - last_growth >
+               std::chrono::seconds(kStallTimeoutSeconds)) {
+      printf("[FFmpegWrapper] Growing input stalled at %lld bytes\n",
+             (long long)size);
+      return AVERROR(ETIMEDOUT);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(kPollMilliseconds));
+  }
+}
+
+int GrowingFileInput::read_packet(void *opaque, uint8_t *buf, int size) {
+  GrowingFileInput *input = (GrowingFileInput *)opaque;
+  while (true) {
+    ssize_t n = pread(input->m_fd, buf, size, input->m_pos);
+    if (n > 0) {
+      input->m_pos += n;
+      return (int)n;
+    }
+    if (n < 0 && errno != EINTR)
+      return AVERROR(errno);
+    if (n == 0) {
+      int ret = input->waitForData(input->m_pos);
+      if (ret < 0)
+        return ret;
+    }
+  }
+}
+
+int64_t GrowingFileInput::seek(void *opaque, int64_t offset, int whence) {
+  GrowingFileInput *input = (GrowingFileInput *)opaque;
+  switch (whence & ~AVSEEK_FORCE) {
+  case AVSEEK_SIZE:
+    // Unknown until the writer is done; demuxers then treat the stream as
+    // open-ended instead of trusting a size that is about to change.
+    return input->isComplete() ? input->availableBytes() : AVERROR(ENOSYS);
+  case SEEK_SET:
+    break;
+  case SEEK_CUR:
+    offset += input->m_pos;
+    break;
+  case SEEK_END:
+    if (!input->isComplete())
+      return AVERROR(ENOSYS);
+    offset += input->availableBytes();
+    break;
+  default:
+    return AVERROR(EINVAL);
+  }
+  if (offset < 0)
+    return AVERROR(EINVAL);
+  input->m_pos = offset;
+  return offset;
+}
@@ -0,0 +1,53 @@
+#ifndef GROWING_FILE_INPUT_HPP
+#define GROWING_FILE_INPUT_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+struct AVIOContext;
+
+// AVIO reader for a file that is still being written (a download in
+// progress), so demuxing can start before the writer finishes. A read at
+// the current end of file waits for more bytes instead of reporting EOF;
+// seeks past it succeed and the next read waits for the data. The input is
+// complete once markComplete() is called or the completion marker path
+// exists (e.g. the final name a .part file is renamed to); only then are
+// EOF and the file size reported. Waiting gives up when `stop` is raised or
+// the file stops growing for kStallTimeoutSeconds.
+class GrowingFileInput {
+public:
+  static const int kStallTimeoutSeconds = 60;
+
+  // Null if the file cannot be opened.
+  static GrowingFileInput *open(const char *path, const char *completionMarker,
+                                const std::atomic<bool> *stop);
+  ~GrowingFileInput();
+
+  GrowingFileInput(const GrowingFileInput &) = delete;
+  GrowingFileInput &operator=(const GrowingFileInput &) = delete;
+
+  // Owned by this object; outlives the AVFormatContext using it.
+  AVIOContext *avio() const { return m_avio; }
+
+  void markComplete() { m_complete = true; }
+  bool isComplete() const;
+  int64_t availableBytes() const;
+
+private:
+  GrowingFileInput() = default;
+
+  static int read_packet(void *opaque, uint8_t *buf, int size);
+  static int64_t seek(void *opaque, int64_t offset, int whence);
+  // Waits until the file extends past `position` or is complete.
+  int waitForData(int64_t position);
+
+  int m_fd = -1;
+  std::string m_marker;
+  mutable std::atomic<bool> m_complete{false};
+  const std::atomic<bool> *m_stop = nullptr;
+  int64_t m_pos = 0;
+  AVIOContext *m_avio = nullptr;
+};
+
+#endif
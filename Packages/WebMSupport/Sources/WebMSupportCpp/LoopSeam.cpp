@@ -0,0 +1,82 @@
+#include "LoopSeam.hpp"
+#include "PixelKernels.hpp"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+bool blend_frame_into(AVFrame *dst, const AVFrame *src, int weight) {
+  const AVPixFmtDescriptor *desc =
+      av_pix_fmt_desc_get((AVPixelFormat)dst->format);
+  if (!desc || dst->format != src->format || dst->width != src->width ||
+      dst->height != src->height ||
+      (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL |
+                      AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_BE)))
+    return false;
+  // Samples must fill whole bytes or low-aligned words; blending the words
+  // is then blending the samples.
+  bool wide = desc->comp[0].depth > 8;
+  for (int c = 0; c < desc->nb_components; c++) {
+    const AVComponentDescriptor &comp = desc->comp[c];
+    if (comp.shift != 0 ||
+        (wide ? comp.depth <= 8 || comp.depth > 16 : comp.depth != 8))
+      return false;
+  }
+
+  int row_bytes[4];
+  if (av_image_fill_linesizes(row_bytes, (AVPixelFormat)dst->format,
+                              dst->width) < 0 ||
+      av_frame_make_writable(dst) < 0)
+    return false;
+
+  for (int p = 0; p < 4 && dst->data[p]; p++) {
+    int rows = (p == 1 || p == 2) ? AV_CEIL_RSHIFT(dst->height,
+                                                    desc->log2_chroma_h)
+                                  : dst->height;
+    for (int y = 0; y < rows; y++) {
+      uint8_t *d = dst->data[p] + (size_t)y * dst->linesize[p];
+      const uint8_t *s = src->data[p] + (size_t)y * src->linesize[p];
+      if (wide)
+        pk_blend_u16((uint16_t *)d, (const uint16_t *)d, (const uint16_t *)s,
+                     row_bytes[p] / 2, weight);
+      else
+        pk_blend_u8(d, d, s, row_bytes[p], weight);
+    }
+  }
+  return true;
+}
+
+int hevc_nal_length_size(const AVCodecParameters *par) {
+  // hvcC: lengthSizeMinusOne in the low bits of byte 21.
+  if (par->extradata_size > 22 && par->extradata[0] == 1)
+    return (par->extradata[21] & 3) + 1;
+  return 4;
+}
+
+SeamPicture hevc_seam_picture(const uint8_t *data, int size,
+                              int nalLengthSize) {
+  int pos = 0;
+  while (pos + nalLengthSize + 2 <= size) {
+    uint32_t length = 0;
+    for (int i = 0; i < nalLengthSize; i++)
+      length = (length << 8) | data[pos + i];
+    pos += nalLengthSize;
+    if (length < 2 || length > (uint32_t)(size - pos))
+      break;
+    int type = (data[pos] >> 1) & 0x3f;
+    pos += (int)length;
+    // The first slice decides; parameter sets and SEI come before it.
+    if (type == 19 || type == 20) // IDR_W_RADL, IDR_N_LP
+      return SeamPicture::Idr;
+    if (type == 21) // CRA_NUT
+      return SeamPicture::Cra;
+    if (type == 8 || type == 9) // RASL_N, RASL_R
+      return SeamPicture::Rasl;
+    if (type < 32) // Any other slice
+      return SeamPicture::Other;
+  }
+  return SeamPicture::Other;
+}
@@ -0,0 +1,28 @@
+#ifndef LOOP_SEAM_HPP
+#define LOOP_SEAM_HPP
+
+#include <cstdint>
+
+struct AVCodecParameters;
+struct AVFrame;
+
+// Helpers for FFmpegWrapper::loopSeamToMov.
+
+// Crossfades `src` into `dst` in place: dst = dst * (256 - weight) / 256 +
+// src * weight / 256, weight in [0, 256], on every plane. False (and `dst`
+// untouched) unless both frames are software pictures of the same format and
+// size with 8-bit or 16-bit little-endian sample words.
+bool blend_frame_into(AVFrame *dst, const AVFrame *src, int weight);
+
+// What an HEVC access unit means for cutting the stream in front of it.
+// Idr and Cra start a new coded video sequence; Rasl pictures reference
+// frames before the preceding CRA, so a CRA followed by any of them is not a
+// clean cut point.
+enum class SeamPicture { Other, Idr, Cra, Rasl };
+
+// Bytes in each NAL unit length prefix of an hvcC stream (4 if unknown).
+int hevc_nal_length_size(const AVCodecParameters *par);
+SeamPicture hevc_seam_picture(const uint8_t *data, int size,
+                              int nalLengthSize);
+
+#endif
@@ -0,0 +1,140 @@
+#include "MemoryBudget.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+
+// x265 defaults this model starts from (preset "medium", bframes=4).
+static const int kX265DefaultRcLookahead = 20;
+static const int kX265DefaultLookaheadSlices = 8;
+static const int kX265BFrames = 4;
+
+static int cpu_count() {
+  unsigned int n = std::thread::hardware_concurrency();
+  return n > 0 ? (int)n : 4;
+}
+
+// Mirrors x265's automatic frame-thread selection by core count.
+static int x265_default_frame_threads(int cpus) {
+  if (cpus >= 32)
+    return 6;
+  if (cpus >= 16)
+    return 5;
+  if (cpus >= 8)
+    return 3;
+  if (cpus >= 4)
+    return 2;
+  return 1;
+}
+
+static int64_t estimate_bytes(const MemoryBudgetInput &in,
+                              const MemoryPlan &plan) {
+  int64_t dec_pixels = (int64_t)in.decodeWidth * in.decodeHeight;
+  int64_t enc_pixels = (int64_t)in.encodeWidth * in.encodeHeight;
+
+  // 4:2:0 pictures; x265 keeps 16-bit planes internally for Main 10.
+  int64_t dec_picture = dec_pixels * 3 / 2 * in.decodeBytesPerSample;
+  int64_t enc_picture = enc_pixels * 3 / 2 * (in.tenBitOutput ? 2 : 1);
+
+  // Decoder: DPB (up to 8 references + output) plus one picture in flight
+  // per frame thread.
+  int dec_threads = plan.decoderThreads;
+  int64_t decoder =
+      (10 + (plan.decoderFrameThreads ? dec_threads : 1)) * dec_picture;
+
+  // x265: every picture between input and output carries full-res planes,
+  // its lowres copy and motion data (~1.5x); each frame thread adds recon
+  // and CTU analysis buffers.
+  int x265_pictures = plan.x265RcLookahead + kX265BFrames +
+                      2 * plan.x265FrameThreads + 4;
+  int64_t encoder = x265_pictures * enc_picture * 3 / 2 +
+                    plan.x265FrameThreads * enc_picture * 2;
+
+  // Filters: zscale's linear-light path works on planar float RGB
+  // (12 bytes/pixel) across a few intermediates; the integer path only
+  // holds a couple of output pictures. Slice threads add line scratch.
+  int64_t filters = in.floatFilters ? 3 * dec_pixels * 12 : 2 * enc_picture;
+  filters += (int64_t)plan.filterThreads * in.decodeWidth * 64 * 16;
+
+  return decoder + encoder + filters;
+}
+
+MemoryPlan plan_memory_budget(const MemoryBudgetInput &input) {
+  MemoryPlan plan = {};
+  plan.decoderFrameThreads = true;
+  plan.withinBudget = true;
+  if (input.budgetBytes <= 0)
+    return plan;
+
+  int cpus = cpu_count();
+  plan.decoderThreads = cpus;
+  plan.x265FrameThreads = x265_default_frame_threads(cpus);
+  plan.x265RcLookahead = kX265DefaultRcLookahead;
+  plan.filterThreads = cpus;
+
+  // Shed the biggest per-picture consumers first: lookahead depth, then
+  // x265 frame parallelism, then decoder frame threads, then filter slices.
+  while (estimate_bytes(input, plan) > input.budgetBytes) {
+    if (plan.x265RcLookahead > 10) {
+      plan.x265RcLookahead -= 5;
+    } else if (plan.x265FrameThreads > 1) {
+      plan.x265FrameThreads--;
+    } else if (plan.decoderFrameThreads && plan.decoderThreads > 2) {
+      plan.decoderThreads /= 2;
+    } else if (plan.decoderFrameThreads) {
+      plan.decoderFrameThreads = false;
+    } else if (plan.filterThreads > 1) {
+      plan.filterThreads /= 2;
+    } else if (plan.x265RcLookahead > kX265BFrames + 1) {
+      plan.x265RcLookahead--;
+    } else {
+      break;
+    }
+  }
+
+  // Worker pool and lookahead slicing follow the frame parallelism that
+  // survived; idle workers still pin per-thread motion search buffers.
+  plan.x265Pools = std::min(cpus, std::max(2, plan.x265FrameThreads * 4));
+  plan.x265LookaheadSlices =
+      std::min(kX265DefaultLookaheadSlices, std::max(1, plan.x265Pools / 2));
+
+  plan.estimatedBytes = estimate_bytes(input, plan);
+  plan.withinBudget = plan.estimatedBytes <= input.budgetBytes;
+  return plan;
+}
+
+int64_t current_resident_bytes() {
+#if defined(__APPLE__)
+  task_vm_info_data_t info;
+  mach_msg_type_number_t count = TASK_VM_INFO_COUNT;
+  if (task_info(mach_task_self(), TASK_VM_INFO, (task_info_t)&info, &count) !=
+      KERN_SUCCESS)
+    return 0;
+  return (int64_t)info.phys_footprint;
+#else
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (!f)
+    return 0;
+  long long pages = 0, resident = 0;
+  int n = fscanf(f, "%lld %lld", &pages, &resident);
+  fclose(f);
+  if (n != 2)
+    return 0;
+  return (int64_t)resident * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+void ResidentMemorySampler::start() {
+  m_baseline = current_resident_bytes();
+  m_peak = m_baseline;
+}
+
+void ResidentMemorySampler::sample() {
+  m_peak = std::max(m_peak, current_resident_bytes());
+}
@@ -0,0 +1,59 @@
+#ifndef MEMORY_BUDGET_HPP
+#define MEMORY_BUDGET_HPP
+
+#include <cstdint>
+
+// Geometry of a transcode, as far as memory use is concerned.
+struct MemoryBudgetInput {
+  int64_t budgetBytes;  // <= 0 keeps libavcodec/x265 defaults
+  int decodeWidth;
+  int decodeHeight;
+  int decodeBytesPerSample; // 1 for 8-bit sources, 2 above
+  int encodeWidth;
+  int encodeHeight;
+  bool tenBitOutput;
+  bool floatFilters; // zscale/tonemap path with linear-light float planes
+};
+
+// Threading and lookahead derived from a budget. Zero fields mean "leave the
+// library default alone".
+struct MemoryPlan {
+  int decoderThreads;
+  bool decoderFrameThreads; // false selects slice threading
+  int x265FrameThreads;
+  int x265LookaheadSlices;
+  int x265RcLookahead;
+  int x265Pools;
+  int filterThreads;
+  int64_t estimatedBytes;
+  bool withinBudget;
+};
+
+// Picks the most parallel configuration whose estimated footprint fits the
+// budget. The estimate is a coarse model of the per-picture buffers each
+// stage keeps alive (decoder DPB + frame threads, x265 lookahead/frame
+// threads, float filter intermediates); it errs on the high side.
+MemoryPlan plan_memory_budget(const MemoryBudgetInput &input);
+
+// Current memory footprint of this process (phys_footprint on macOS,
+// resident set on Linux). 0 if unavailable.
+int64_t current_resident_bytes();
+
+// Tracks the footprint high-water mark over one job. The process is shared
+// with other work, so the peak is reported both absolute and as growth over
+// the footprint when the job started.
+class ResidentMemorySampler {
+public:
+  void start();
+  void sample();
+  int64_t peakBytes() const { return m_peak; }
+  int64_t peakGrowthBytes() const {
+    return m_peak > m_baseline ? m_peak - m_baseline : 0;
+  }
+
+private:
+  int64_t m_baseline = 0;
+  int64_t m_peak = 0;
+};
+
+#endif
@@ -0,0 +1,718 @@
+#include "PixelKernels.hpp"
+
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PK_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define PK_SSE2 1
+#endif
+
+// 16-bit sums go through 32-bit lanes; flushing every block keeps each lane
+// below 2^32 for any sample value.
+static const int kU16Block = 16384;
+
+static inline uint32_t absdiff(uint32_t a, uint32_t b) {
+  return a > b ? a - b : b - a;
+}
+
+uint64_t pk_sad_const_u8(const uint8_t *row, int n, uint8_t value) {
+  uint64_t sum = 0;
+  int i = 0;
+#if PK_NEON
+  uint8x16_t ref = vdupq_n_u8(value);
+  uint32x4_t acc = vdupq_n_u32(0);
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t d = vabdq_u8(vld1q_u8(row + i), ref);
+    acc = vpadalq_u16(acc, vpaddlq_u8(d));
+  }
+  sum = vaddlvq_u32(acc);
+#elif PK_SSE2
+  __m128i ref = _mm_set1_epi8((char)value);
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(row + i));
+    __m128i d = _mm_or_si128(_mm_subs_epu8(x, ref), _mm_subs_epu8(ref, x));
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(d, _mm_setzero_si128()));
+  }
+  sum = (uint64_t)_mm_cvtsi128_si64(acc) +
+        (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(acc, acc));
+#endif
+  for (; i < n; i++)
+    sum += absdiff(row[i], value);
+  return sum;
+}
+
+uint64_t pk_sad_const_u16(const uint16_t *row, int n, uint16_t value) {
+  uint64_t sum = 0;
+  int i = 0;
+#if PK_NEON
+  uint16x8_t ref = vdupq_n_u16(value);
+  while (i + 8 <= n) {
+    int end = std::min(n, i + kU16Block);
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; i + 8 <= end; i += 8)
+      acc = vpadalq_u16(acc, vabdq_u16(vld1q_u16(row + i), ref));
+    sum += vaddlvq_u32(acc);
+  }
+#elif PK_SSE2
+  __m128i ref = _mm_set1_epi16((short)value);
+  __m128i zero = _mm_setzero_si128();
+  while (i + 8 <= n) {
+    int end = std::min(n, i + kU16Block);
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 8 <= end; i += 8) {
+      __m128i x = _mm_loadu_si128((const __m128i *)(row + i));
+      __m128i d = _mm_or_si128(_mm_subs_epu16(x, ref), _mm_subs_epu16(ref, x));
+      acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(d, zero));
+      acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(d, zero));
+    }
+    uint32_t lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  }
+#endif
+  for (; i < n; i++)
+    sum += absdiff(row[i], value);
+  return sum;
+}
+
+uint64_t pk_sad_u8(const uint8_t *a, const uint8_t *b, int n) {
+  uint64_t sum = 0;
+  int i = 0;
+#if PK_NEON
+  uint32x4_t acc = vdupq_n_u32(0);
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t d = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+    acc = vpadalq_u16(acc, vpaddlq_u8(d));
+  }
+  sum = vaddlvq_u32(acc);
+#elif PK_SSE2
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+    __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(x, y));
+  }
+  sum = (uint64_t)_mm_cvtsi128_si64(acc) +
+        (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(acc, acc));
+#endif
+  for (; i < n; i++)
+    sum += absdiff(a[i], b[i]);
+  return sum;
+}
+
+uint64_t pk_sad_u16(const uint16_t *a, const uint16_t *b, int n) {
+  uint64_t sum = 0;
+  int i = 0;
+#if PK_NEON
+  while (i + 8 <= n) {
+    int end = std::min(n, i + kU16Block);
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; i + 8 <= end; i += 8)
+      acc = vpadalq_u16(acc, vabdq_u16(vld1q_u16(a + i), vld1q_u16(b + i)));
+    sum += vaddlvq_u32(acc);
+  }
+#elif PK_SSE2
+  __m128i zero = _mm_setzero_si128();
+  while (i + 8 <= n) {
+    int end = std::min(n, i + kU16Block);
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 8 <= end; i += 8) {
+      __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+      __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+      __m128i d = _mm_or_si128(_mm_subs_epu16(x, y), _mm_subs_epu16(y, x));
+      acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(d, zero));
+      acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(d, zero));
+    }
+    uint32_t lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  }
+#endif
+  for (; i < n; i++)
+    sum += absdiff(a[i], b[i]);
+  return sum;
+}
+
+#if PK_SSE2
+// acc (two 64-bit lanes) += x[i] * y[i] over eight unsigned 16-bit lanes.
+static inline __m128i mul_acc_epu16(__m128i acc, __m128i x, __m128i y) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i xl = _mm_unpacklo_epi16(x, zero), yl = _mm_unpacklo_epi16(y, zero);
+  __m128i xh = _mm_unpackhi_epi16(x, zero), yh = _mm_unpackhi_epi16(y, zero);
+  acc = _mm_add_epi64(acc, _mm_mul_epu32(xl, yl));
+  acc = _mm_add_epi64(acc, _mm_mul_epu32(_mm_srli_epi64(xl, 32),
+                                         _mm_srli_epi64(yl, 32)));
+  acc = _mm_add_epi64(acc, _mm_mul_epu32(xh, yh));
+  acc = _mm_add_epi64(acc, _mm_mul_epu32(_mm_srli_epi64(xh, 32),
+                                         _mm_srli_epi64(yh, 32)));
+  return acc;
+}
+
+static inline uint64_t sum_epi64(__m128i v) {
+  return (uint64_t)_mm_cvtsi128_si64(v) +
+         (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(v, v));
+}
+
+static inline uint64_t sum_epi32(__m128i v) {
+  uint32_t lanes[4];
+  _mm_storeu_si128((__m128i *)lanes, v);
+  return (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+#endif
+
+uint64_t pk_sse_u8(const uint8_t *a, const uint8_t *b, int n) {
+  uint64_t sum = 0;
+  int i = 0;
+#if PK_NEON
+  uint64x2_t acc = vdupq_n_u64(0);
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t d = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+    uint16x8_t lo = vmull_u8(vget_low_u8(d), vget_low_u8(d));
+    uint16x8_t hi = vmull_u8(vget_high_u8(d), vget_high_u8(d));
+    acc = vpadalq_u32(acc, vaddl_u16(vget_low_u16(lo), vget_high_u16(lo)));
+    acc = vpadalq_u32(acc, vaddl_u16(vget_low_u16(hi), vget_high_u16(hi)));
+  }
+  sum = vaddvq_u64(acc);
+#elif PK_SSE2
+  // Squares of 8-bit differences fit madd's signed 16-bit inputs; a 32-bit
+  // lane takes two per step, so flushing each block keeps it in range.
+  __m128i zero = _mm_setzero_si128();
+  while (i + 16 <= n) {
+    int end = std::min(n, i + kU16Block);
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 16 <= end; i += 16) {
+      __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+      __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+      __m128i d = _mm_or_si128(_mm_subs_epu8(x, y), _mm_subs_epu8(y, x));
+      __m128i lo = _mm_unpacklo_epi8(d, zero);
+      __m128i hi = _mm_unpackhi_epi8(d, zero);
+      acc = _mm_add_epi32(acc, _mm_madd_epi16(lo, lo));
+      acc = _mm_add_epi32(acc, _mm_madd_epi16(hi, hi));
+    }
+    sum += sum_epi32(acc);
+  }
+#endif
+  for (; i < n; i++) {
+    uint64_t d = absdiff(a[i], b[i]);
+    sum += d * d;
+  }
+  return sum;
+}
+
+uint64_t pk_sse_u16(const uint16_t *a, const uint16_t *b, int n) {
+  uint64_t sum = 0;
+  int i = 0;
+#if PK_NEON
+  uint64x2_t acc = vdupq_n_u64(0);
+  for (; i + 8 <= n; i += 8) {
+    uint16x8_t d = vabdq_u16(vld1q_u16(a + i), vld1q_u16(b + i));
+    acc = vpadalq_u32(acc, vmull_u16(vget_low_u16(d), vget_low_u16(d)));
+    acc = vpadalq_u32(acc, vmull_u16(vget_high_u16(d), vget_high_u16(d)));
+  }
+  sum = vaddvq_u64(acc);
+#elif PK_SSE2
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 8 <= n; i += 8) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+    __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+    __m128i d = _mm_or_si128(_mm_subs_epu16(x, y), _mm_subs_epu16(y, x));
+    acc = mul_acc_epu16(acc, d, d);
+  }
+  sum = sum_epi64(acc);
+#endif
+  for (; i < n; i++) {
+    uint64_t d = absdiff(a[i], b[i]);
+    sum += d * d;
+  }
+  return sum;
+}
+
+void pk_ssim_sums_u8(const uint8_t *a, const uint8_t *b, int n,
+                     uint64_t sums[5]) {
+  uint64_t sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0;
+  int i = 0;
+#if PK_NEON
+  uint32x4_t va = vdupq_n_u32(0), vb = vdupq_n_u32(0);
+  uint32x4_t vaa = vdupq_n_u32(0), vbb = vdupq_n_u32(0), vab = vdupq_n_u32(0);
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t x = vld1q_u8(a + i);
+    uint8x16_t y = vld1q_u8(b + i);
+    va = vpadalq_u16(va, vpaddlq_u8(x));
+    vb = vpadalq_u16(vb, vpaddlq_u8(y));
+    vaa = vpadalq_u16(vaa, vmull_u8(vget_low_u8(x), vget_low_u8(x)));
+    vaa = vpadalq_u16(vaa, vmull_u8(vget_high_u8(x), vget_high_u8(x)));
+    vbb = vpadalq_u16(vbb, vmull_u8(vget_low_u8(y), vget_low_u8(y)));
+    vbb = vpadalq_u16(vbb, vmull_u8(vget_high_u8(y), vget_high_u8(y)));
+    vab = vpadalq_u16(vab, vmull_u8(vget_low_u8(x), vget_low_u8(y)));
+    vab = vpadalq_u16(vab, vmull_u8(vget_high_u8(x), vget_high_u8(y)));
+  }
+  sa = vaddlvq_u32(va);
+  sb = vaddlvq_u32(vb);
+  saa = vaddlvq_u32(vaa);
+  sbb = vaddlvq_u32(vbb);
+  sab = vaddlvq_u32(vab);
+#elif PK_SSE2
+  __m128i zero = _mm_setzero_si128();
+  __m128i va = zero, vb = zero, vaa = zero, vbb = zero, vab = zero;
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+    __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+    va = _mm_add_epi64(va, _mm_sad_epu8(x, zero));
+    vb = _mm_add_epi64(vb, _mm_sad_epu8(y, zero));
+    __m128i xl = _mm_unpacklo_epi8(x, zero), xh = _mm_unpackhi_epi8(x, zero);
+    __m128i yl = _mm_unpacklo_epi8(y, zero), yh = _mm_unpackhi_epi8(y, zero);
+    vaa = _mm_add_epi32(vaa, _mm_add_epi32(_mm_madd_epi16(xl, xl),
+                                           _mm_madd_epi16(xh, xh)));
+    vbb = _mm_add_epi32(vbb, _mm_add_epi32(_mm_madd_epi16(yl, yl),
+                                           _mm_madd_epi16(yh, yh)));
+    vab = _mm_add_epi32(vab, _mm_add_epi32(_mm_madd_epi16(xl, yl),
+                                           _mm_madd_epi16(xh, yh)));
+  }
+  sa = sum_epi64(va);
+  sb = sum_epi64(vb);
+  saa = sum_epi32(vaa);
+  sbb = sum_epi32(vbb);
+  sab = sum_epi32(vab);
+#endif
+  for (; i < n; i++) {
+    uint32_t x = a[i], y = b[i];
+    sa += x;
+    sb += y;
+    saa += x * x;
+    sbb += y * y;
+    sab += x * y;
+  }
+  sums[0] = sa;
+  sums[1] = sb;
+  sums[2] = saa;
+  sums[3] = sbb;
+  sums[4] = sab;
+}
+
+void pk_ssim_sums_u16(const uint16_t *a, const uint16_t *b, int n,
+                      uint64_t sums[5]) {
+  uint64_t sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0;
+  int i = 0;
+#if PK_NEON
+  uint32x4_t va = vdupq_n_u32(0), vb = vdupq_n_u32(0);
+  uint64x2_t vaa = vdupq_n_u64(0), vbb = vdupq_n_u64(0), vab = vdupq_n_u64(0);
+  for (; i + 8 <= n; i += 8) {
+    uint16x8_t x = vld1q_u16(a + i);
+    uint16x8_t y = vld1q_u16(b + i);
+    va = vpadalq_u16(va, x);
+    vb = vpadalq_u16(vb, y);
+    vaa = vpadalq_u32(vaa, vmull_u16(vget_low_u16(x), vget_low_u16(x)));
+    vaa = vpadalq_u32(vaa, vmull_u16(vget_high_u16(x), vget_high_u16(x)));
+    vbb = vpadalq_u32(vbb, vmull_u16(vget_low_u16(y), vget_low_u16(y)));
+    vbb = vpadalq_u32(vbb, vmull_u16(vget_high_u16(y), vget_high_u16(y)));
+    vab = vpadalq_u32(vab, vmull_u16(vget_low_u16(x), vget_low_u16(y)));
+    vab = vpadalq_u32(vab, vmull_u16(vget_high_u16(x), vget_high_u16(y)));
+  }
+  sa = vaddlvq_u32(va);
+  sb = vaddlvq_u32(vb);
+  saa = vaddvq_u64(vaa);
+  sbb = vaddvq_u64(vbb);
+  sab = vaddvq_u64(vab);
+#elif PK_SSE2
+  __m128i zero = _mm_setzero_si128();
+  __m128i va = zero, vb = zero, vaa = zero, vbb = zero, vab = zero;
+  for (; i + 8 <= n; i += 8) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+    __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+    va = _mm_add_epi32(va, _mm_add_epi32(_mm_unpacklo_epi16(x, zero),
+                                         _mm_unpackhi_epi16(x, zero)));
+    vb = _mm_add_epi32(vb, _mm_add_epi32(_mm_unpacklo_epi16(y, zero),
+                                         _mm_unpackhi_epi16(y, zero)));
+    vaa = mul_acc_epu16(vaa, x, x);
+    vbb = mul_acc_epu16(vbb, y, y);
+    vab = mul_acc_epu16(vab, x, y);
+  }
+  sa = sum_epi32(va);
+  sb = sum_epi32(vb);
+  saa = sum_epi64(vaa);
+  sbb = sum_epi64(vbb);
+  sab = sum_epi64(vab);
+#endif
+  for (; i < n; i++) {
+    uint64_t x = a[i], y = b[i];
+    sa += x;
+    sb += y;
+    saa += x * x;
+    sbb += y * y;
+    sab += x * y;
+  }
+  sums[0] = sa;
+  sums[1] = sb;
+  sums[2] = saa;
+  sums[3] = sbb;
+  sums[4] = sab;
+}
+
+void pk_blend_u8(uint8_t *dst, const uint8_t *a, const uint8_t *b, int n,
+                 int weight) {
+  weight = std::min(256, std::max(0, weight));
+  int i = 0;
+#if PK_NEON
+  // Both products and their sum stay within 255 * 256.
+  uint16_t wa = (uint16_t)(256 - weight), wb = (uint16_t)weight;
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t x = vld1q_u8(a + i);
+    uint8x16_t y = vld1q_u8(b + i);
+    uint16x8_t lo = vmulq_n_u16(vmovl_u8(vget_low_u8(x)), wa);
+    uint16x8_t hi = vmulq_n_u16(vmovl_u8(vget_high_u8(x)), wa);
+    lo = vmlaq_n_u16(lo, vmovl_u8(vget_low_u8(y)), wb);
+    hi = vmlaq_n_u16(hi, vmovl_u8(vget_high_u8(y)), wb);
+    vst1q_u8(dst + i, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+  }
+#elif PK_SSE2
+  __m128i zero = _mm_setzero_si128();
+  __m128i wa = _mm_set1_epi16((short)(256 - weight));
+  __m128i wb = _mm_set1_epi16((short)weight);
+  __m128i round = _mm_set1_epi16(128);
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+    __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+    __m128i lo = _mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpacklo_epi8(x, zero), wa),
+        _mm_mullo_epi16(_mm_unpacklo_epi8(y, zero), wb));
+    __m128i hi = _mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpackhi_epi8(x, zero), wa),
+        _mm_mullo_epi16(_mm_unpackhi_epi8(y, zero), wb));
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+  }
+#endif
+  for (; i < n; i++)
+    dst[i] = (uint8_t)((a[i] * (256 - weight) + b[i] * weight + 128) >> 8);
+}
+
+void pk_blend_u16(uint16_t *dst, const uint16_t *a, const uint16_t *b, int n,
+                  int weight) {
+  weight = std::min(256, std::max(0, weight));
+  int i = 0;
+#if PK_NEON
+  uint16_t wa = (uint16_t)(256 - weight), wb = (uint16_t)weight;
+  for (; i + 8 <= n; i += 8) {
+    uint16x8_t x = vld1q_u16(a + i);
+    uint16x8_t y = vld1q_u16(b + i);
+    uint32x4_t lo = vmull_n_u16(vget_low_u16(x), wa);
+    uint32x4_t hi = vmull_n_u16(vget_high_u16(x), wa);
+    lo = vmlal_n_u16(lo, vget_low_u16(y), wb);
+    hi = vmlal_n_u16(hi, vget_high_u16(y), wb);
+    vst1q_u16(dst + i, vcombine_u16(vrshrn_n_u32(lo, 8), vrshrn_n_u32(hi, 8)));
+  }
+#elif PK_SSE2
+  // 32-bit products from the low/high 16-bit halves; the results fit 16 bits
+  // again but SSE2 only packs signed, hence the bias around the pack.
+  __m128i wa = _mm_set1_epi16((short)(256 - weight));
+  __m128i wb = _mm_set1_epi16((short)weight);
+  __m128i round = _mm_set1_epi32(128);
+  __m128i bias32 = _mm_set1_epi32(32768);
+  __m128i bias16 = _mm_set1_epi16((short)0x8000);
+  for (; i + 8 <= n; i += 8) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+    __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+    __m128i xl = _mm_mullo_epi16(x, wa), xh = _mm_mulhi_epu16(x, wa);
+    __m128i yl = _mm_mullo_epi16(y, wb), yh = _mm_mulhi_epu16(y, wb);
+    __m128i lo = _mm_add_epi32(_mm_unpacklo_epi16(xl, xh),
+                               _mm_unpacklo_epi16(yl, yh));
+    __m128i hi = _mm_add_epi32(_mm_unpackhi_epi16(xl, xh),
+                               _mm_unpackhi_epi16(yl, yh));
+    lo = _mm_sub_epi32(_mm_srli_epi32(_mm_add_epi32(lo, round), 8), bias32);
+    hi = _mm_sub_epi32(_mm_srli_epi32(_mm_add_epi32(hi, round), 8), bias32);
+    _mm_storeu_si128((__m128i *)(dst + i),
+                     _mm_xor_si128(_mm_packs_epi32(lo, hi), bias16));
+  }
+#endif
+  for (; i < n; i++)
+    dst[i] = (uint16_t)(((uint32_t)a[i] * (256 - weight) +
+                         (uint32_t)b[i] * weight + 128) >>
+                        8);
+}
+
+void pk_accumulate_absdiff_u8(uint32_t *acc, const uint8_t *row, int n,
+                              uint8_t value) {
+  int i = 0;
+#if PK_NEON
+  uint8x16_t ref = vdupq_n_u8(value);
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t d = vabdq_u8(vld1q_u8(row + i), ref);
+    uint16x8_t lo = vmovl_u8(vget_low_u8(d));
+    uint16x8_t hi = vmovl_u8(vget_high_u8(d));
+    vst1q_u32(acc + i, vaddw_u16(vld1q_u32(acc + i), vget_low_u16(lo)));
+    vst1q_u32(acc + i + 4, vaddw_u16(vld1q_u32(acc + i + 4), vget_high_u16(lo)));
+    vst1q_u32(acc + i + 8, vaddw_u16(vld1q_u32(acc + i + 8), vget_low_u16(hi)));
+    vst1q_u32(acc + i + 12,
+              vaddw_u16(vld1q_u32(acc + i + 12), vget_high_u16(hi)));
+  }
+#elif PK_SSE2
+  __m128i ref = _mm_set1_epi8((char)value);
+  __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(row + i));
+    __m128i d = _mm_or_si128(_mm_subs_epu8(x, ref), _mm_subs_epu8(ref, x));
+    __m128i lo = _mm_unpacklo_epi8(d, zero);
+    __m128i hi = _mm_unpackhi_epi8(d, zero);
+    __m128i *a = (__m128i *)(acc + i);
+    _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a),
+                                      _mm_unpacklo_epi16(lo, zero)));
+    _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1),
+                                          _mm_unpackhi_epi16(lo, zero)));
+    _mm_storeu_si128(a + 2, _mm_add_epi32(_mm_loadu_si128(a + 2),
+                                          _mm_unpacklo_epi16(hi, zero)));
+    _mm_storeu_si128(a + 3, _mm_add_epi32(_mm_loadu_si128(a + 3),
+                                          _mm_unpackhi_epi16(hi, zero)));
+  }
+#endif
+  for (; i < n; i++)
+    acc[i] += absdiff(row[i], value);
+}
+
+void pk_accumulate_absdiff_u16(uint32_t *acc, const uint16_t *row, int n,
+                               uint16_t value) {
+  int i = 0;
+#if PK_NEON
+  uint16x8_t ref = vdupq_n_u16(value);
+  for (; i + 8 <= n; i += 8) {
+    uint16x8_t d = vabdq_u16(vld1q_u16(row + i), ref);
+    vst1q_u32(acc + i, vaddw_u16(vld1q_u32(acc + i), vget_low_u16(d)));
+    vst1q_u32(acc + i + 4, vaddw_u16(vld1q_u32(acc + i + 4), vget_high_u16(d)));
+  }
+#elif PK_SSE2
+  __m128i ref = _mm_set1_epi16((short)value);
+  __m128i zero = _mm_setzero_si128();
+  for (; i + 8 <= n; i += 8) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(row + i));
+    __m128i d = _mm_or_si128(_mm_subs_epu16(x, ref), _mm_subs_epu16(ref, x));
+    __m128i *a = (__m128i *)(acc + i);
+    _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a),
+                                      _mm_unpacklo_epi16(d, zero)));
+    _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1),
+                                          _mm_unpackhi_epi16(d, zero)));
+  }
+#endif
+  for (; i < n; i++)
+    acc[i] += absdiff(row[i], value);
+}
+
+void pk_widen_u8(uint16_t *dst, const uint8_t *src, int n, int shift) {
+  int i = 0;
+#if PK_NEON
+  int16x8_t up = vdupq_n_s16((int16_t)shift);
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t x = vld1q_u8(src + i);
+    vst1q_u16(dst + i, vshlq_u16(vmovl_u8(vget_low_u8(x)), up));
+    vst1q_u16(dst + i + 8, vshlq_u16(vmovl_u8(vget_high_u8(x)), up));
+  }
+#elif PK_SSE2
+  __m128i up = _mm_cvtsi32_si128(shift);
+  __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+    _mm_storeu_si128((__m128i *)(dst + i),
+                     _mm_sll_epi16(_mm_unpacklo_epi8(x, zero), up));
+    _mm_storeu_si128((__m128i *)(dst + i + 8),
+                     _mm_sll_epi16(_mm_unpackhi_epi8(x, zero), up));
+  }
+#endif
+  for (; i < n; i++)
+    dst[i] = (uint16_t)(src[i] << shift);
+}
+
+void pk_narrow_u16(uint16_t *dst, const uint16_t *src, int n, int shift,
+                   const uint16_t dither[8], uint16_t max) {
+  int i = 0;
+#if PK_NEON
+  uint16x8_t d = vld1q_u16(dither);
+  uint16x8_t top = vdupq_n_u16(max);
+  int16x8_t down = vdupq_n_s16((int16_t)-shift);
+  for (; i + 8 <= n; i += 8) {
+    uint16x8_t x = vaddq_u16(vld1q_u16(src + i), d);
+    vst1q_u16(dst + i, vminq_u16(vshlq_u16(x, down), top));
+  }
+#elif PK_SSE2
+  // Sums stay below 2^15 after the shift, so the signed min is safe.
+  __m128i d = _mm_loadu_si128((const __m128i *)dither);
+  __m128i top = _mm_set1_epi16((short)max);
+  __m128i down = _mm_cvtsi32_si128(shift);
+  for (; i + 8 <= n; i += 8) {
+    __m128i x = _mm_add_epi16(_mm_loadu_si128((const __m128i *)(src + i)), d);
+    _mm_storeu_si128((__m128i *)(dst + i),
+                     _mm_min_epi16(_mm_srl_epi16(x, down), top));
+  }
+#endif
+  for (; i < n; i++)
+    dst[i] = (uint16_t)std::min<uint32_t>(
+        max, ((uint32_t)src[i] + dither[i & 7]) >> shift);
+}
+
+#if PK_SSE2
+// Even and odd 16-bit lanes of a:b (samples below 2^15).
+static inline __m128i even_u16(__m128i a, __m128i b) {
+  return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+                         _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+}
+static inline __m128i odd_u16(__m128i a, __m128i b) {
+  return _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+}
+#endif
+
+void pk_chroma_444_to_420_u8(uint16_t *dst, const uint8_t *r0,
+                             const uint8_t *r1, int n, int shift,
+                             const uint16_t dither[8], uint16_t max) {
+  int i = 0;
+#if PK_NEON
+  uint16x8_t d = vld1q_u16(dither);
+  uint16x8_t top = vdupq_n_u16(max);
+  int16x8_t down = vdupq_n_s16((int16_t)-shift);
+  for (; i + 8 <= n; i += 8) {
+    uint8x8x2_t a = vld2_u8(r0 + 2 * i);
+    uint8x8x2_t b = vld2_u8(r1 + 2 * i);
+    uint8x8_t pa = vld2_u8(r0 + 2 * i - 1).val[0];
+    uint8x8_t pb = vld2_u8(r1 + 2 * i - 1).val[0];
+    uint16x8_t sum = vaddq_u16(vaddl_u8(pa, a.val[1]), vshll_n_u8(a.val[0], 1));
+    sum = vaddq_u16(sum, vaddl_u8(pb, b.val[1]));
+    sum = vaddq_u16(sum, vshll_n_u8(b.val[0], 1));
+    sum = vaddq_u16(sum, d);
+    vst1q_u16(dst + i, vminq_u16(vshlq_u16(sum, down), top));
+  }
+#elif PK_SSE2
+  __m128i d = _mm_loadu_si128((const __m128i *)dither);
+  __m128i top = _mm_set1_epi16((short)max);
+  __m128i down = _mm_cvtsi32_si128(shift);
+  __m128i low = _mm_set1_epi16(0x00FF);
+  for (; i + 8 <= n; i += 8) {
+    // As 16-bit lanes, x holds columns 2i (low byte) and 2i + 1 (high);
+    // the load one byte earlier puts column 2i - 1 in the low byte.
+    __m128i a = _mm_loadu_si128((const __m128i *)(r0 + 2 * i));
+    __m128i b = _mm_loadu_si128((const __m128i *)(r1 + 2 * i));
+    __m128i pa = _mm_loadu_si128((const __m128i *)(r0 + 2 * i - 1));
+    __m128i pb = _mm_loadu_si128((const __m128i *)(r1 + 2 * i - 1));
+    __m128i sum = _mm_add_epi16(_mm_and_si128(pa, low), _mm_srli_epi16(a, 8));
+    sum = _mm_add_epi16(sum, _mm_slli_epi16(_mm_and_si128(a, low), 1));
+    sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_and_si128(pb, low),
+                                           _mm_srli_epi16(b, 8)));
+    sum = _mm_add_epi16(sum, _mm_slli_epi16(_mm_and_si128(b, low), 1));
+    sum = _mm_add_epi16(sum, d);
+    _mm_storeu_si128((__m128i *)(dst + i),
+                     _mm_min_epi16(_mm_srl_epi16(sum, down), top));
+  }
+#endif
+  for (; i < n; i++) {
+    uint32_t sum = r0[2 * i - 1] + 2 * r0[2 * i] + r0[2 * i + 1] +
+                   r1[2 * i - 1] + 2 * r1[2 * i] + r1[2 * i + 1];
+    dst[i] = (uint16_t)std::min<uint32_t>(max, (sum + dither[i & 7]) >> shift);
+  }
+}
+
+void pk_chroma_444_to_420_u16(uint16_t *dst, const uint16_t *r0,
+                              const uint16_t *r1, int n, int shift,
+                              const uint16_t dither[8], uint16_t max) {
+  int i = 0;
+#if PK_NEON
+  uint16x8_t d = vld1q_u16(dither);
+  uint16x8_t top = vdupq_n_u16(max);
+  int16x8_t down = vdupq_n_s16((int16_t)-shift);
+  for (; i + 8 <= n; i += 8) {
+    uint16x8x2_t a = vld2q_u16(r0 + 2 * i);
+    uint16x8x2_t b = vld2q_u16(r1 + 2 * i);
+    uint16x8_t pa = vld2q_u16(r0 + 2 * i - 1).val[0];
+    uint16x8_t pb = vld2q_u16(r1 + 2 * i - 1).val[0];
+    uint16x8_t sum =
+        vaddq_u16(vaddq_u16(pa, a.val[1]), vshlq_n_u16(a.val[0], 1));
+    sum = vaddq_u16(sum, vaddq_u16(pb, b.val[1]));
+    sum = vaddq_u16(sum, vshlq_n_u16(b.val[0], 1));
+    sum = vaddq_u16(sum, d);
+    vst1q_u16(dst + i, vminq_u16(vshlq_u16(sum, down), top));
+  }
+#elif PK_SSE2
+  // 12-bit samples keep the six-tap sum below 2^15; adding the dither may
+  // cross it, which the logical shift does not mind.
+  __m128i d = _mm_loadu_si128((const __m128i *)dither);
+  __m128i top = _mm_set1_epi16((short)max);
+  __m128i down = _mm_cvtsi32_si128(shift);
+  for (; i + 8 <= n; i += 8) {
+    const uint16_t *rows[2] = {r0 + 2 * i, r1 + 2 * i};
+    __m128i sum = d;
+    for (const uint16_t *r : rows) {
+      __m128i x = _mm_loadu_si128((const __m128i *)r);
+      __m128i y = _mm_loadu_si128((const __m128i *)(r + 8));
+      __m128i px = _mm_loadu_si128((const __m128i *)(r - 1));
+      __m128i py = _mm_loadu_si128((const __m128i *)(r + 7));
+      sum = _mm_add_epi16(sum, _mm_slli_epi16(even_u16(x, y), 1));
+      sum = _mm_add_epi16(sum, _mm_add_epi16(odd_u16(x, y), even_u16(px, py)));
+    }
+    _mm_storeu_si128((__m128i *)(dst + i),
+                     _mm_min_epi16(_mm_srl_epi16(sum, down), top));
+  }
+#endif
+  for (; i < n; i++) {
+    uint32_t sum = r0[2 * i - 1] + 2 * r0[2 * i] + r0[2 * i + 1] +
+                   r1[2 * i - 1] + 2 * r1[2 * i] + r1[2 * i + 1];
+    dst[i] = (uint16_t)std::min<uint32_t>(max, (sum + dither[i & 7]) >> shift);
+  }
+}
+
+void pk_chroma_422_to_420_u8(uint16_t *dst, const uint8_t *r0,
+                             const uint8_t *r1, int n) {
+  int i = 0;
+#if PK_NEON
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t a = vld1q_u8(r0 + i);
+    uint8x16_t b = vld1q_u8(r1 + i);
+    vst1q_u16(dst + i,
+              vshlq_n_u16(vaddl_u8(vget_low_u8(a), vget_low_u8(b)), 1));
+    vst1q_u16(dst + i + 8,
+              vshlq_n_u16(vaddl_u8(vget_high_u8(a), vget_high_u8(b)), 1));
+  }
+#elif PK_SSE2
+  __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= n; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(r0 + i));
+    __m128i b = _mm_loadu_si128((const __m128i *)(r1 + i));
+    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                               _mm_unpacklo_epi8(b, zero));
+    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                               _mm_unpackhi_epi8(b, zero));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_slli_epi16(lo, 1));
+    _mm_storeu_si128((__m128i *)(dst + i + 8), _mm_slli_epi16(hi, 1));
+  }
+#endif
+  for (; i < n; i++)
+    dst[i] = (uint16_t)((r0[i] + r1[i]) << 1);
+}
+
+void pk_chroma_422_to_420_u16(uint16_t *dst, const uint16_t *r0,
+                              const uint16_t *r1, int n, int shift,
+                              const uint16_t dither[8], uint16_t max) {
+  int i = 0;
+#if PK_NEON
+  uint16x8_t d = vld1q_u16(dither);
+  uint16x8_t top = vdupq_n_u16(max);
+  int16x8_t down = vdupq_n_s16((int16_t)-shift);
+  for (; i + 8 <= n; i += 8) {
+    uint16x8_t sum = vaddq_u16(vld1q_u16(r0 + i), vld1q_u16(r1 + i));
+    sum = vaddq_u16(sum, d);
+    vst1q_u16(dst + i, vminq_u16(vshlq_u16(sum, down), top));
+  }
+#elif PK_SSE2
+  __m128i d = _mm_loadu_si128((const __m128i *)dither);
+  __m128i top = _mm_set1_epi16((short)max);
+  __m128i down = _mm_cvtsi32_si128(shift);
+  for (; i + 8 <= n; i += 8) {
+    __m128i sum = _mm_add_epi16(_mm_loadu_si128((const __m128i *)(r0 + i)),
+                                _mm_loadu_si128((const __m128i *)(r1 + i)));
+    sum = _mm_add_epi16(sum, d);
+    _mm_storeu_si128((__m128i *)(dst + i),
+                     _mm_min_epi16(_mm_srl_epi16(sum, down), top));
+  }
+#endif
+  for (; i < n; i++)
+    dst[i] = (uint16_t)std::min<uint32_t>(
+        max, ((uint32_t)r0[i] + r1[i] + dither[i & 7]) >> shift);
+}
@@ -0,0 +1,74 @@
+#ifndef PIXEL_KERNELS_HPP
+#define PIXEL_KERNELS_HPP
+
+#include <cstdint>
+
+// Vectorized plane kernels (NEON on arm64, SSE2 on x86_64, scalar elsewhere).
+// The _u8 variants take 8-bit samples, the _u16 variants 9- to 16-bit
+// samples stored in 16-bit words (e.g. yuv420p10le). Lengths are in samples.
+
+// Sum of |row[i] - value|. With value = 0 this is the plain sum.
+uint64_t pk_sad_const_u8(const uint8_t *row, int n, uint8_t value);
+uint64_t pk_sad_const_u16(const uint16_t *row, int n, uint16_t value);
+
+// Sum of |a[i] - b[i]|.
+uint64_t pk_sad_u8(const uint8_t *a, const uint8_t *b, int n);
+uint64_t pk_sad_u16(const uint16_t *a, const uint16_t *b, int n);
+
+// Sum of (a[i] - b[i])^2. Exact for any sample values.
+uint64_t pk_sse_u8(const uint8_t *a, const uint8_t *b, int n);
+uint64_t pk_sse_u16(const uint16_t *a, const uint16_t *b, int n);
+
+// SSIM window statistics over n <= 65536 samples: sums[0..4] receive sum a,
+// sum b, sum a^2, sum b^2 and sum a*b.
+void pk_ssim_sums_u8(const uint8_t *a, const uint8_t *b, int n,
+                     uint64_t sums[5]);
+void pk_ssim_sums_u16(const uint16_t *a, const uint16_t *b, int n,
+                      uint64_t sums[5]);
+
+// dst[i] = (a[i] * (256 - weight) + b[i] * weight + 128) >> 8, with weight
+// in [0, 256]. dst may alias a or b.
+void pk_blend_u8(uint8_t *dst, const uint8_t *a, const uint8_t *b, int n,
+                 int weight);
+void pk_blend_u16(uint16_t *dst, const uint16_t *a, const uint16_t *b, int n,
+                  int weight);
+
+// acc[i] += |row[i] - value|, for column statistics over many rows. The
+// caller keeps the row count low enough for 32-bit sums (< 65536 rows).
+void pk_accumulate_absdiff_u8(uint32_t *acc, const uint8_t *row, int n,
+                              uint8_t value);
+void pk_accumulate_absdiff_u16(uint32_t *acc, const uint16_t *row, int n,
+                               uint16_t value);
+
+// Conversion to 10-bit 4:2:0. Kernels that drop precision add dither[i & 7]
+// (each entry below 1 << shift) before shifting and clamp to `max`.
+
+// dst[i] = src[i] << shift.
+void pk_widen_u8(uint16_t *dst, const uint8_t *src, int n, int shift);
+// dst[i] = min(max, (src[i] + dither) >> shift), for samples up to 12 bits.
+void pk_narrow_u16(uint16_t *dst, const uint16_t *src, int n, int shift,
+                   const uint16_t dither[8], uint16_t max);
+
+// 4:4:4 chroma rows r0/r1 to one 4:2:0 row, sited like MPEG-2 (co-sited
+// horizontally, between the rows vertically): a [1 2 1] filter around
+// column 2i of both rows, dst[i] = min(max, (sum + dither) >> shift). Reads
+// r[2i - 1] to r[2i + 1]; the caller keeps those in bounds. The _u16
+// variant takes samples up to 12 bits.
+void pk_chroma_444_to_420_u8(uint16_t *dst, const uint8_t *r0,
+                             const uint8_t *r1, int n, int shift,
+                             const uint16_t dither[8], uint16_t max);
+void pk_chroma_444_to_420_u16(uint16_t *dst, const uint16_t *r0,
+                              const uint16_t *r1, int n, int shift,
+                              const uint16_t dither[8], uint16_t max);
+
+// 4:2:2 chroma rows to one 4:2:0 row by averaging them vertically. 8-bit
+// samples become 10-bit exactly: dst[i] = (r0[i] + r1[i]) << 1. The _u16
+// variant, for samples up to 12 bits, computes
+// dst[i] = min(max, (r0[i] + r1[i] + dither) >> shift).
+void pk_chroma_422_to_420_u8(uint16_t *dst, const uint8_t *r0,
+                             const uint8_t *r1, int n);
+void pk_chroma_422_to_420_u16(uint16_t *dst, const uint16_t *r0,
+                              const uint16_t *r1, int n, int shift,
+                              const uint16_t dither[8], uint16_t max);
+
+#endif
@@ -0,0 +1,83 @@
+#include "PlaybackBudget.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// HEVC Table A.8 (Main tier): MaxLumaPs, MaxLumaSr, MaxBR (kbit/s).
+struct LevelLimits {
+  int level;
+  int64_t maxLumaPs;
+  int64_t maxLumaSr;
+  int64_t maxKbps;
+};
+
+const LevelLimits kLevels[] = {
+    {10, 36864, 552960, 128},
+    {20, 122880, 3686400, 1500},
+    {21, 245760, 7372800, 3000},
+    {30, 552960, 16588800, 6000},
+    {31, 983040, 33177600, 10000},
+    {40, 2228224, 66846720, 12000},
+    {41, 2228224, 133693440, 20000},
+    {50, 8912896, 267386880, 25000},
+    {51, 8912896, 534773760, 40000},
+    {52, 8912896, 1069547520, 60000},
+    {60, 35651584, 1069547520, 60000},
+    {61, 35651584, 2139095040, 120000},
+    {62, 35651584, 4278190080, 240000},
+};
+} // namespace
+
+bool playback_limits(int width, int height, double fps, PlaybackLimits *out) {
+  int64_t picture = (int64_t)width * height;
+  int64_t rate = (int64_t)std::ceil(picture * std::max(fps, 1.0));
+  for (const LevelLimits &level : kLevels) {
+    // Neither dimension may exceed sqrt(8 * MaxLumaPs).
+    int64_t max_dim = (int64_t)std::sqrt(8.0 * level.maxLumaPs);
+    if (picture > level.maxLumaPs || rate > level.maxLumaSr ||
+        width > max_dim || height > max_dim)
+      continue;
+    out->level = level.level;
+    out->maxLumaSampleRate = level.maxLumaSr;
+    out->levelMaxBitrate = level.maxKbps * 1000;
+    out->vbvMaxrate = std::min(out->levelMaxBitrate,
+                               (int64_t)(rate * kBitsPerLumaSample));
+    out->vbvBufsize = out->vbvMaxrate;
+    return true;
+  }
+  return false;
+}
+
+void BitrateMeter::setVbv(int64_t maxrate, int64_t bufsize) {
+  m_maxrate = maxrate;
+  m_bufsize = bufsize;
+}
+
+void BitrateMeter::addFrame(double time, int64_t bytes) {
+  int64_t bits = bytes * 8;
+  m_window.push_back({time, bits});
+  m_window_bits += bits;
+  while (m_window.front().first <= time - 1.0) {
+    m_window_bits -= m_window.front().second;
+    m_window.pop_front();
+  }
+  m_peak = std::max(m_peak, m_window_bits);
+
+  if (m_maxrate <= 0 || m_bufsize <= 0)
+    return;
+  // x265 starts with the buffer 90% full (vbv-init).
+  if (!m_started) {
+    m_fullness = 0.9 * m_bufsize;
+    m_started = true;
+  } else {
+    m_fullness = std::min<double>(
+        m_bufsize, m_fullness + m_maxrate * std::max(0.0, time - m_last_time));
+  }
+  m_last_time = time;
+  m_fullness -= bits;
+  if (m_fullness < 0) {
+    m_underflows++;
+    m_fullness = 0;
+  }
+}
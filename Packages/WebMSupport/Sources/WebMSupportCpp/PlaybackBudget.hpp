@@ -0,0 +1,51 @@
+#ifndef PLAYBACK_BUDGET_HPP
+#define PLAYBACK_BUDGET_HPP
+
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+// Decode limits an export is held to so the wallpaper player can decode it
+// cheaply in hardware: the lowest Main-tier HEVC level that holds the
+// output, and a VBV cap of kBitsPerLumaSample per luma sample per second,
+// never above the level's own bitrate.
+struct PlaybackLimits {
+  int level;                 // general_level_idc / 3: 51 = level 5.1
+  int64_t maxLumaSampleRate; // Level limits
+  int64_t levelMaxBitrate;   // bits/s, Main tier
+  int64_t vbvMaxrate;        // bits/s
+  int64_t vbvBufsize;        // bits (one second at vbvMaxrate)
+};
+
+static const double kBitsPerLumaSample = 0.12;
+
+// False if the output is beyond level 6.2.
+bool playback_limits(int width, int height, double fps, PlaybackLimits *out);
+
+// Watches an encoder's output in decode order: the most bits in any one
+// second, and how often a decoder buffer of the given VBV size, filled at
+// maxrate, would have run dry.
+class BitrateMeter {
+public:
+  // VBV simulation is off until this is called.
+  void setVbv(int64_t maxrate, int64_t bufsize);
+  // `time`: decode time in seconds.
+  void addFrame(double time, int64_t bytes);
+
+  int64_t peakBitsPerSecond() const { return m_peak; }
+  int vbvUnderflows() const { return m_underflows; }
+
+private:
+  std::deque<std::pair<double, int64_t>> m_window; // Last second: time, bits
+  int64_t m_window_bits = 0;
+  int64_t m_peak = 0;
+
+  int64_t m_maxrate = 0;
+  int64_t m_bufsize = 0;
+  double m_fullness = 0;
+  double m_last_time = 0;
+  bool m_started = false;
+  int m_underflows = 0;
+};
+
+#endif
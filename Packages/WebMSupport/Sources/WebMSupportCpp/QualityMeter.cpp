@@ -0,0 +1,184 @@
+#include "QualityMeter.hpp"
+#include "PixelKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+#include <libavutil/pixdesc.h>
+}
+
+// Samples waiting for their packet. Encoders hold a few dozen frames at
+// most; anything older than this never came back (dropped by the encoder).
+static const size_t kMaxPending = 256;
+
+static bool sample_format(int pix_fmt, int *depth) {
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((AVPixelFormat)pix_fmt);
+  if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_RGB |
+                               AV_PIX_FMT_FLAG_BE)) ||
+      desc->comp[0].shift != 0)
+    return false;
+  *depth = desc->comp[0].depth;
+  return true;
+}
+
+QualityMeter *QualityMeter::create(const AVCodecContext *enc_ctx) {
+  int depth = 0;
+  if (!sample_format(enc_ctx->pix_fmt, &depth) ||
+      enc_ctx->width < kBlock || enc_ctx->height < kBlock)
+    return nullptr;
+  const AVCodec *dec = avcodec_find_decoder(enc_ctx->codec_id);
+  if (!dec)
+    return nullptr;
+
+  QualityMeter *meter = new QualityMeter();
+  meter->m_width = enc_ctx->width;
+  meter->m_height = enc_ctx->height;
+  meter->m_bit_depth = depth;
+  meter->m_wide = depth > 8;
+  meter->m_blocks_x = (enc_ctx->width - kBlock) / kGridStep + 1;
+  meter->m_blocks_y = (enc_ctx->height - kBlock) / kGridStep + 1;
+
+  // Parameter sets live in extradata when the muxer wants global headers.
+  AVCodecParameters *par = avcodec_parameters_alloc();
+  meter->m_dec_ctx = avcodec_alloc_context3(dec);
+  meter->m_decoded = av_frame_alloc();
+  bool ok = par && meter->m_dec_ctx && meter->m_decoded &&
+            avcodec_parameters_from_context(par, enc_ctx) >= 0 &&
+            avcodec_parameters_to_context(meter->m_dec_ctx, par) >= 0;
+  avcodec_parameters_free(&par);
+  if (ok) {
+    meter->m_dec_ctx->pkt_timebase = enc_ctx->time_base;
+    ok = avcodec_open2(meter->m_dec_ctx, dec, nullptr) >= 0;
+  }
+  if (!ok) {
+    printf("[FFmpegWrapper] Quality meter: cannot decode %s output\n",
+           dec->name);
+    delete meter;
+    return nullptr;
+  }
+  return meter;
+}
+
+QualityMeter::~QualityMeter() {
+  if (m_dec_ctx)
+    avcodec_free_context(&m_dec_ctx);
+  if (m_decoded)
+    av_frame_free(&m_decoded);
+}
+
+void QualityMeter::sample(const AVFrame *frame, uint8_t *out) const {
+  size_t bytes = m_wide ? 2 : 1;
+  size_t window_row = kBlock * bytes;
+  for (int by = 0; by < m_blocks_y; by++) {
+    for (int bx = 0; bx < m_blocks_x; bx++) {
+      const uint8_t *src = frame->data[0] +
+                           (size_t)by * kGridStep * frame->linesize[0] +
+                           (size_t)bx * kGridStep * bytes;
+      for (int row = 0; row < kBlock; row++) {
+        memcpy(out, src, window_row);
+        out += window_row;
+        src += frame->linesize[0];
+      }
+    }
+  }
+}
+
+void QualityMeter::addSource(const AVFrame *frame, double sourceTime) {
+  if (frame->width != m_width || frame->height != m_height)
+    return;
+  if (m_pending.size() >= kMaxPending)
+    m_pending.erase(m_pending.begin());
+
+  Source &source = m_pending[frame->pts];
+  source.time = sourceTime;
+  source.samples.resize((size_t)m_blocks_x * m_blocks_y * kBlock * kBlock *
+                        (m_wide ? 2 : 1));
+  sample(frame, source.samples.data());
+}
+
+void QualityMeter::addPacket(const AVPacket *pkt) {
+  if (avcodec_send_packet(m_dec_ctx, pkt) == 0)
+    receiveFrames();
+}
+
+void QualityMeter::finish() {
+  avcodec_send_packet(m_dec_ctx, nullptr);
+  receiveFrames();
+  m_pending.clear();
+}
+
+void QualityMeter::receiveFrames() {
+  while (avcodec_receive_frame(m_dec_ctx, m_decoded) == 0) {
+    measure(m_decoded);
+    av_frame_unref(m_decoded);
+  }
+}
+
+void QualityMeter::measure(const AVFrame *decoded) {
+  int depth = 0;
+  auto it = m_pending.find(decoded->pts);
+  if (it == m_pending.end() || decoded->width != m_width ||
+      decoded->height != m_height ||
+      !sample_format(decoded->format, &depth) || depth != m_bit_depth)
+    return;
+
+  int window = kBlock * kBlock;
+  int windows = m_blocks_x * m_blocks_y;
+  std::vector<uint8_t> recon(it->second.samples.size());
+  sample(decoded, recon.data());
+
+  double peak = (double)((1 << m_bit_depth) - 1);
+  double c1 = (0.01 * peak) * (0.01 * peak);
+  double c2 = (0.03 * peak) * (0.03 * peak);
+  uint64_t sse = 0;
+  double ssim_sum = 0;
+  for (int w = 0; w < windows; w++) {
+    uint64_t sums[5];
+    if (m_wide) {
+      const uint16_t *a =
+          (const uint16_t *)it->second.samples.data() + (size_t)w * window;
+      const uint16_t *b = (const uint16_t *)recon.data() + (size_t)w * window;
+      sse += pk_sse_u16(a, b, window);
+      pk_ssim_sums_u16(a, b, window, sums);
+    } else {
+      const uint8_t *a = it->second.samples.data() + (size_t)w * window;
+      const uint8_t *b = recon.data() + (size_t)w * window;
+      sse += pk_sse_u8(a, b, window);
+      pk_ssim_sums_u8(a, b, window, sums);
+    }
+    double mu_a = (double)sums[0] / window;
+    double mu_b = (double)sums[1] / window;
+    double var_a = (double)sums[2] / window - mu_a * mu_a;
+    double var_b = (double)sums[3] / window - mu_b * mu_b;
+    double cov = (double)sums[4] / window - mu_a * mu_b;
+    ssim_sum += ((2 * mu_a * mu_b + c1) * (2 * cov + c2)) /
+                ((mu_a * mu_a + mu_b * mu_b + c1) * (var_a + var_b + c2));
+  }
+
+  double mse = (double)sse / ((double)windows * window);
+  double psnr =
+      mse > 0 ? std::min(kMaxPsnr, 10.0 * std::log10(peak * peak / mse))
+              : kMaxPsnr;
+  m_frames.push_back({it->second.time, psnr, ssim_sum / windows});
+  m_pending.erase(m_pending.begin(), std::next(it));
+}
+
+void QualityMeter::summarize(const std::vector<FrameQuality> &frames,
+                             double *meanPsnr, double *meanSsim,
+                             double *minSsim) {
+  double psnr = 0, ssim = 0, worst = frames.empty() ? 0 : 1;
+  for (const FrameQuality &q : frames) {
+    psnr += q.psnr;
+    ssim += q.ssim;
+    worst = std::min(worst, q.ssim);
+  }
+  size_t n = std::max<size_t>(frames.size(), 1);
+  *meanPsnr = psnr / n;
+  *meanSsim = ssim / n;
+  *minSsim = worst;
+}
@@ -0,0 +1,72 @@
+#ifndef QUALITY_METER_HPP
+#define QUALITY_METER_HPP
+
+#include "WebMSupportCpp/FFmpegWrapper.hpp"
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+struct AVCodecContext;
+struct AVFrame;
+struct AVPacket;
+
+// Measures what an export loses while it runs. Every picture sent to the
+// encoder leaves a luma sample behind: kBlock x kBlock windows on a grid
+// kGridStep pixels apart (1/16 of the plane). Encoded packets are decoded
+// again by a private decoder and the same windows of the reconstruction
+// are compared with the stored sample, matched by pts, giving PSNR over all
+// sampled pixels and SSIM averaged over the windows.
+class QualityMeter {
+public:
+  static const int kBlock = 8;
+  static const int kGridStep = 32;
+  static constexpr double kMaxPsnr = 100.0;
+
+  // Null if the encoder's output cannot be decoded or its pixel format is
+  // not planar YUV.
+  static QualityMeter *create(const AVCodecContext *enc_ctx);
+  ~QualityMeter();
+
+  QualityMeter(const QualityMeter &) = delete;
+  QualityMeter &operator=(const QualityMeter &) = delete;
+
+  // `frame` is in the encoder's format; its pts must be set.
+  void addSource(const AVFrame *frame, double sourceTime);
+  // Packets in encoder time base, before they are rescaled for muxing.
+  void addPacket(const AVPacket *pkt);
+  // Drains the decoder after the encoder has been flushed.
+  void finish();
+
+  const std::vector<FrameQuality> &frames() const { return m_frames; }
+
+  // Mean PSNR and SSIM over `frames` and the worst frame's SSIM. All zero
+  // when there are no frames.
+  static void summarize(const std::vector<FrameQuality> &frames,
+                        double *meanPsnr, double *meanSsim, double *minSsim);
+
+private:
+  struct Source {
+    double time;
+    std::vector<uint8_t> samples;
+  };
+
+  QualityMeter() = default;
+
+  void sample(const AVFrame *frame, uint8_t *out) const;
+  void receiveFrames();
+  void measure(const AVFrame *decoded);
+
+  AVCodecContext *m_dec_ctx = nullptr;
+  AVFrame *m_decoded = nullptr;
+  int m_width = 0;
+  int m_height = 0;
+  int m_bit_depth = 8;
+  bool m_wide = false; // 16-bit sample words
+  int m_blocks_x = 0;
+  int m_blocks_y = 0;
+  std::map<int64_t, Source> m_pending; // Encoder pts -> sample
+  std::vector<FrameQuality> m_frames;
+};
+
+#endif
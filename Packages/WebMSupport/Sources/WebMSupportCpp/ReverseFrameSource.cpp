@@ -0,0 +1,320 @@
+#include "ReverseFrameSource.hpp"
+#include "DecodedFrameCache.hpp"
+#include "TraceRecorder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sys/types.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/frame.h>
+#include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
+}
+
+ReverseFrameSource::ReverseFrameSource(AVFormatContext *fmt_ctx, int streamIdx,
+                                       const std::vector<double> &keyframes,
+                                       double startTime, double endTime,
+                                       int64_t bufferBytes,
+                                       const std::string &spillPath,
+                                       const std::atomic<bool> *stop)
+    : m_fmt_ctx(fmt_ctx), m_stream_idx(streamIdx),
+      m_buffer_bytes(std::max<int64_t>(bufferBytes, 1)), m_stop(stop),
+      m_spill_path(spillPath) {
+  m_bounds.push_back(startTime);
+  for (double t : keyframes) {
+    if (t > m_bounds.back() && (endTime <= 0 || t <= endTime))
+      m_bounds.push_back(t);
+  }
+  // endTime is inclusive, like the trims of forward exports.
+  m_bounds.push_back(endTime > 0 ? std::nextafter(endTime, INFINITY)
+                                 : INFINITY);
+  m_gops_left = m_bounds.size() - 1;
+
+  m_pkt = av_packet_alloc();
+  m_decoded = av_frame_alloc();
+  m_spill_props = av_frame_alloc();
+  m_failed = !m_pkt || !m_decoded || !m_spill_props || !openDecoder();
+}
+
+ReverseFrameSource::~ReverseFrameSource() {
+  clearBuffer();
+  if (m_dec_ctx)
+    avcodec_free_context(&m_dec_ctx);
+  if (m_spill_enc)
+    avcodec_free_context(&m_spill_enc);
+  if (m_spill_dec)
+    avcodec_free_context(&m_spill_dec);
+  av_packet_free(&m_pkt);
+  av_frame_free(&m_decoded);
+  av_frame_free(&m_spill_props);
+  if (m_spill_file) {
+    fclose(m_spill_file);
+    std::remove(m_spill_path.c_str());
+  }
+}
+
+bool ReverseFrameSource::openDecoder() {
+  AVCodecParameters *par = m_fmt_ctx->streams[m_stream_idx]->codecpar;
+  const AVCodec *codec = avcodec_find_decoder(par->codec_id);
+  if (!codec)
+    return false;
+  m_dec_ctx = avcodec_alloc_context3(codec);
+  if (!m_dec_ctx || avcodec_parameters_to_context(m_dec_ctx, par) < 0)
+    return false;
+  m_dec_ctx->pkt_timebase = m_fmt_ctx->streams[m_stream_idx]->time_base;
+  return avcodec_open2(m_dec_ctx, codec, nullptr) >= 0;
+}
+
+void ReverseFrameSource::clearBuffer() {
+  for (AVFrame *frame : m_frames)
+    av_frame_free(&frame);
+  m_frames.clear();
+  m_buffered_bytes = 0;
+}
+
+bool ReverseFrameSource::next(AVFrame *frame) {
+  while (m_frames.empty()) {
+    if (m_failed || stopped())
+      return false;
+    if (m_spill_left > 0) {
+      m_failed = !loadSpillChunk();
+    } else if (m_gops_left > 0) {
+      m_gops_left--;
+      m_failed = !loadGop(m_gops_left);
+    } else {
+      return false;
+    }
+  }
+
+  AVFrame *last = m_frames.back();
+  m_frames.pop_back();
+  m_buffered_bytes -= DecodedFrameCache::frameBytes(last);
+  av_frame_unref(frame);
+  av_frame_move_ref(frame, last);
+  av_frame_free(&last);
+  return true;
+}
+
+bool ReverseFrameSource::exhausted() const {
+  return m_frames.empty() && m_spill_left == 0 && m_gops_left == 0;
+}
+
+// Decodes [m_bounds[gop], m_bounds[gop + 1]) from the GOP's keyframe.
+// Pictures come out in presentation order, so the first one at or past the
+// end closes the GOP, after any leading pictures of the next keyframe.
+bool ReverseFrameSource::loadGop(size_t gop) {
+  TraceSpan span("reverse gop", "gop", (int64_t)gop);
+  double from = m_bounds[gop];
+  double to = m_bounds[gop + 1];
+  AVStream *st = m_fmt_ctx->streams[m_stream_idx];
+  double tb = av_q2d(st->time_base);
+  if (av_seek_frame(m_fmt_ctx, m_stream_idx, llround(from / tb),
+                    AVSEEK_FLAG_BACKWARD) < 0)
+    return false;
+  avcodec_flush_buffers(m_dec_ctx);
+  m_spilling = false;
+
+  bool done = false;
+  bool ok = true;
+  while (ok && !done && !stopped()) {
+    bool eof = av_read_frame(m_fmt_ctx, m_pkt) < 0;
+    if (eof)
+      avcodec_send_packet(m_dec_ctx, nullptr);
+    else if (m_pkt->stream_index == m_stream_idx)
+      avcodec_send_packet(m_dec_ctx, m_pkt);
+    av_packet_unref(m_pkt);
+
+    while (ok && !done && avcodec_receive_frame(m_dec_ctx, m_decoded) == 0) {
+      if (m_decoded->pts != AV_NOPTS_VALUE) {
+        double t = m_decoded->pts * tb;
+        if (t >= to)
+          done = true;
+        else if (t >= from)
+          ok = keep(m_decoded);
+      }
+      av_frame_unref(m_decoded);
+    }
+    if (eof)
+      break;
+  }
+
+  if (ok && m_spilling) {
+    if (m_spill_index.size() != m_spill_pts.size()) {
+      printf("[FFmpegWrapper] Error: Reverse spill encoder held back "
+             "frames\n");
+      return false;
+    }
+    m_spill_left = m_spill_index.size();
+    m_gops_spilled++;
+    printf("[FFmpegWrapper] Reverse: spilled a %zu-frame GOP (%lld KB)\n",
+           m_spill_left, (long long)(m_spill_end >> 10));
+  }
+  return ok;
+}
+
+bool ReverseFrameSource::keep(AVFrame *frame) {
+  int64_t bytes = DecodedFrameCache::frameBytes(frame);
+  if (!m_spilling && m_buffered_bytes + bytes > m_buffer_bytes) {
+    if (!startSpill(frame))
+      return false;
+    std::vector<AVFrame *> held;
+    held.swap(m_frames);
+    m_buffered_bytes = 0;
+    bool ok = true;
+    for (AVFrame *earlier : held) {
+      ok = ok && spillFrame(earlier);
+      av_frame_free(&earlier);
+    }
+    if (!ok)
+      return false;
+  }
+  if (m_spilling)
+    return spillFrame(frame);
+
+  AVFrame *copy = av_frame_clone(frame);
+  if (!copy)
+    return false;
+  m_frames.push_back(copy);
+  m_buffered_bytes += bytes;
+  m_peak_bytes = std::max(m_peak_bytes, m_buffered_bytes);
+  return true;
+}
+
+bool ReverseFrameSource::startSpill(const AVFrame *like) {
+  if (like->hw_frames_ctx) {
+    printf("[FFmpegWrapper] Error: Cannot spill hardware frames\n");
+    return false;
+  }
+  if (!m_spill_file && !(m_spill_file = fopen(m_spill_path.c_str(), "w+b"))) {
+    printf("[FFmpegWrapper] Error: Cannot create %s\n", m_spill_path.c_str());
+    return false;
+  }
+
+  if (!m_spill_enc) {
+    // Lossless, every frame an IDR carrying its parameter sets, no delay:
+    // any run of packets decodes on its own.
+    const AVCodec *enc = avcodec_find_encoder_by_name("libx264");
+    const AVCodec *dec = avcodec_find_decoder(AV_CODEC_ID_H264);
+    if (!enc || !dec)
+      return false;
+    m_spill_enc = avcodec_alloc_context3(enc);
+    m_spill_dec = avcodec_alloc_context3(dec);
+    if (!m_spill_enc || !m_spill_dec)
+      return false;
+    m_spill_enc->width = like->width;
+    m_spill_enc->height = like->height;
+    m_spill_enc->pix_fmt = (AVPixelFormat)like->format;
+    m_spill_enc->time_base = {1, 1};
+    m_spill_enc->gop_size = 1;
+    m_spill_enc->max_b_frames = 0;
+    m_spill_enc->color_range = like->color_range;
+    av_opt_set(m_spill_enc->priv_data, "preset", "ultrafast", 0);
+    av_opt_set(m_spill_enc->priv_data, "tune", "zerolatency", 0);
+    av_opt_set_int(m_spill_enc->priv_data, "qp", 0, 0);
+    if (avcodec_open2(m_spill_enc, enc, nullptr) < 0) {
+      printf("[FFmpegWrapper] Error: Cannot open the lossless spill encoder "
+             "for %s\n",
+             av_get_pix_fmt_name((AVPixelFormat)like->format));
+      return false;
+    }
+    m_spill_dec->pkt_timebase = m_spill_enc->time_base;
+    if (avcodec_open2(m_spill_dec, dec, nullptr) < 0)
+      return false;
+  }
+
+  av_frame_unref(m_spill_props);
+  av_frame_copy_props(m_spill_props, like);
+  m_spill_frame_bytes = DecodedFrameCache::frameBytes(like);
+  m_spill_index.clear();
+  m_spill_pts.clear();
+  m_spill_end = 0;
+  m_spilling = true;
+  return true;
+}
+
+bool ReverseFrameSource::spillFrame(AVFrame *frame) {
+  if (frame->width != m_spill_enc->width ||
+      frame->height != m_spill_enc->height ||
+      frame->format != m_spill_enc->pix_fmt || frame->hw_frames_ctx) {
+    printf("[FFmpegWrapper] Error: Frame geometry changed while spilling\n");
+    return false;
+  }
+  m_spill_pts.push_back(frame->pts);
+  frame->pts = (int64_t)m_spill_pts.size() - 1;
+  frame->pict_type = AV_PICTURE_TYPE_I;
+  if (avcodec_send_frame(m_spill_enc, frame) < 0)
+    return false;
+
+  while (avcodec_receive_packet(m_spill_enc, m_pkt) == 0) {
+    bool written =
+        fseeko(m_spill_file, (off_t)m_spill_end, SEEK_SET) == 0 &&
+        fwrite(m_pkt->data, 1, m_pkt->size, m_spill_file) ==
+            (size_t)m_pkt->size;
+    m_spill_index.push_back({m_spill_end, m_pkt->size});
+    m_spill_end += m_pkt->size;
+    av_packet_unref(m_pkt);
+    if (!written) {
+      printf("[FFmpegWrapper] Error: Cannot write %s\n", m_spill_path.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+// Decodes the last bufferBytes worth of spilled frames not returned yet.
+bool ReverseFrameSource::loadSpillChunk() {
+  TraceSpan span("reverse spill read");
+  size_t count = (size_t)std::max<int64_t>(
+      1, m_buffer_bytes / std::max<int64_t>(m_spill_frame_bytes, 1));
+  size_t first = m_spill_left > count ? m_spill_left - count : 0;
+  avcodec_flush_buffers(m_spill_dec);
+
+  auto take = [&]() {
+    while (avcodec_receive_frame(m_spill_dec, m_decoded) == 0) {
+      int64_t index = m_decoded->pts;
+      AVFrame *copy = av_frame_alloc();
+      if (!copy || index < (int64_t)first || index >= (int64_t)m_spill_left) {
+        av_frame_free(&copy);
+        av_frame_unref(m_decoded);
+        continue;
+      }
+      av_frame_move_ref(copy, m_decoded);
+      av_frame_copy_props(copy, m_spill_props);
+      copy->pts = m_spill_pts[index];
+      m_buffered_bytes += DecodedFrameCache::frameBytes(copy);
+      m_frames.push_back(copy);
+    }
+  };
+
+  for (size_t i = first; i < m_spill_left; i++) {
+    const std::pair<int64_t, int> &entry = m_spill_index[i];
+    if (av_new_packet(m_pkt, entry.second) < 0 ||
+        fseeko(m_spill_file, (off_t)entry.first, SEEK_SET) != 0 ||
+        fread(m_pkt->data, 1, entry.second, m_spill_file) !=
+            (size_t)entry.second) {
+      av_packet_unref(m_pkt);
+      return false;
+    }
+    m_pkt->pts = m_pkt->dts = (int64_t)i;
+    m_pkt->flags |= AV_PKT_FLAG_KEY;
+    int ret = avcodec_send_packet(m_spill_dec, m_pkt);
+    av_packet_unref(m_pkt);
+    if (ret < 0)
+      return false;
+    take();
+  }
+  avcodec_send_packet(m_spill_dec, nullptr);
+  take();
+  m_peak_bytes = std::max(m_peak_bytes, m_buffered_bytes);
+
+  if (m_frames.size() != m_spill_left - first) {
+    printf("[FFmpegWrapper] Error: Reverse spill lost frames\n");
+    clearBuffer();
+    return false;
+  }
+  m_spill_left = first;
+  return true;
+}
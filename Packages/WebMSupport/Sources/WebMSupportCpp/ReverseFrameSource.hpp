@@ -0,0 +1,88 @@
+#ifndef REVERSE_FRAME_SOURCE_HPP
+#define REVERSE_FRAME_SOURCE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct AVCodecContext;
+struct AVFormatContext;
+struct AVFrame;
+struct AVPacket;
+
+// Hands out the frames of a trim last to first, for reverse and boomerang
+// exports. GOPs are decoded one at a time starting from the last, each from
+// its own keyframe. A GOP whose pictures fit in bufferBytes is held decoded;
+// a larger one is spilled to a lossless all-intra H.264 file and read back
+// in chunks of bufferBytes, so memory stays at about one buffer however
+// long the clip or its GOPs are. The demuxer is shared with the caller and
+// left at an arbitrary position; the decoder is private.
+class ReverseFrameSource {
+public:
+  static const int64_t kDefaultBufferBytes = 512LL << 20;
+
+  // `keyframes`: the stream's keyframe times in [startTime, endTime]
+  // (seconds, sorted). endTime 0 runs to the end of the stream.
+  ReverseFrameSource(AVFormatContext *fmt_ctx, int streamIdx,
+                     const std::vector<double> &keyframes, double startTime,
+                     double endTime, int64_t bufferBytes,
+                     const std::string &spillPath,
+                     const std::atomic<bool> *stop);
+  ~ReverseFrameSource();
+
+  ReverseFrameSource(const ReverseFrameSource &) = delete;
+  ReverseFrameSource &operator=(const ReverseFrameSource &) = delete;
+
+  // Moves the next frame, latest first, into `frame` with its source pts.
+  // False once every frame was returned, on cancellation, or on error.
+  bool next(AVFrame *frame);
+  // The frame next() just returned was the earliest one.
+  bool exhausted() const;
+  bool failed() const { return m_failed; }
+
+  int gopsSpilled() const { return m_gops_spilled; }
+  int64_t peakBufferedBytes() const { return m_peak_bytes; }
+
+private:
+  bool openDecoder();
+  bool loadGop(size_t gop);
+  bool keep(AVFrame *frame);
+  bool startSpill(const AVFrame *like);
+  bool spillFrame(AVFrame *frame);
+  bool loadSpillChunk();
+  void clearBuffer();
+  bool stopped() const { return m_stop && m_stop->load(); }
+
+  AVFormatContext *m_fmt_ctx;
+  int m_stream_idx;
+  AVCodecContext *m_dec_ctx = nullptr;
+  AVPacket *m_pkt = nullptr;
+  AVFrame *m_decoded = nullptr;
+  std::vector<double> m_bounds; // GOP start times, then the end (exclusive)
+  size_t m_gops_left;           // GOPs not loaded yet, counted from the first
+  int64_t m_buffer_bytes;
+  const std::atomic<bool> *m_stop;
+  bool m_failed = false;
+
+  std::vector<AVFrame *> m_frames; // Presentation order; served from the back
+  int64_t m_buffered_bytes = 0;
+  int64_t m_peak_bytes = 0;
+
+  // Spill of the current GOP: one intra packet per frame.
+  std::string m_spill_path;
+  FILE *m_spill_file = nullptr;
+  AVCodecContext *m_spill_enc = nullptr;
+  AVCodecContext *m_spill_dec = nullptr;
+  AVFrame *m_spill_props = nullptr; // Colour tags and side data to restore
+  bool m_spilling = false;
+  int64_t m_spill_end = 0;
+  int64_t m_spill_frame_bytes = 0;
+  std::vector<std::pair<int64_t, int>> m_spill_index; // Offset, size
+  std::vector<int64_t> m_spill_pts;                   // Source pts
+  size_t m_spill_left = 0; // Spilled frames not returned yet
+  int m_gops_spilled = 0;
+};
+
+#endif
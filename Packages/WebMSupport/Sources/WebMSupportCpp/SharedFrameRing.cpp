@@ -0,0 +1,411 @@
+#include "SharedFrameRing.hpp"
+#include "WebMSupportCpp/SharedFrameRingC.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "ring counters must be lock-free to be shared across processes");
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "ring flags must be lock-free to be shared across processes");
+
+static const size_t kHeaderBytes = 4096;
+static const size_t kHandleBytes = 256;
+static const size_t kRowAlign = 64;
+
+struct SharedFrameRing::RingHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slotCount;
+  uint32_t reserved;
+  uint64_t slotStride; // FrameHandle + plane data, page aligned
+  uint64_t regionSize;
+
+  // Producer-owned line
+  alignas(64) std::atomic<uint64_t> writeSeq; // Frames published
+  std::atomic<uint64_t> droppedFrames;
+  std::atomic<uint32_t> closed;
+
+  // Consumer-owned line
+  alignas(64) std::atomic<uint64_t> fence; // Frame held, or kNoFence
+};
+
+struct SharedFrameRing::FrameHandle {
+  std::atomic<uint64_t> seq; // Seqlock word, see the header comment
+  int32_t width;
+  int32_t height;
+  int32_t format;
+  int32_t planeCount;
+  int32_t strides[kMaxPlanes];
+  int32_t rows[kMaxPlanes];
+  uint64_t offsets[kMaxPlanes]; // From the start of the slot
+  int64_t timestampNs;
+  uint64_t frameNumber;
+};
+
+static size_t round_up(size_t value, size_t align) {
+  return (value + align - 1) / align * align;
+}
+
+static std::string shm_name(const char *name) {
+  std::string s = name;
+  return s.empty() || s[0] == '/' ? s : "/" + s;
+}
+
+SharedFrameRing::~SharedFrameRing() {
+  if (m_base)
+    munmap(m_base, m_size);
+  if (m_fd >= 0)
+    ::close(m_fd);
+  if (m_owner && !m_name.empty())
+    shm_unlink(m_name.c_str());
+}
+
+SharedFrameRing::RingHeader *SharedFrameRing::header() const {
+  return (RingHeader *)m_base;
+}
+
+SharedFrameRing::FrameHandle *SharedFrameRing::slot(uint64_t index) const {
+  RingHeader *h = header();
+  return (FrameHandle *)((uint8_t *)m_base + kHeaderBytes +
+                         (index % h->slotCount) * h->slotStride);
+}
+
+uint32_t SharedFrameRing::slotCount() const { return header()->slotCount; }
+
+size_t SharedFrameRing::slotBytes() const {
+  return header()->slotStride - kHandleBytes;
+}
+
+bool SharedFrameRing::map(int fd, size_t size, bool owner) {
+  void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED)
+    return false;
+  m_fd = fd;
+  m_base = base;
+  m_size = size;
+  m_owner = owner;
+  return true;
+}
+
+SharedFrameRing *SharedFrameRing::create(const char *name, uint32_t slotCount,
+                                         size_t slotBytes) {
+  static_assert(sizeof(RingHeader) <= kHeaderBytes, "header overflows page");
+  static_assert(sizeof(FrameHandle) <= kHandleBytes, "handle overflows slot");
+  if (slotCount < 2 || slotBytes == 0)
+    return nullptr;
+
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t stride = round_up(kHandleBytes + slotBytes, page);
+  size_t size = kHeaderBytes + (size_t)slotCount * stride;
+
+  std::string path = name ? shm_name(name) : "";
+  int fd = -1;
+  if (!path.empty()) {
+    fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 && errno == EEXIST) {
+      // Left behind by a producer that crashed.
+      shm_unlink(path.c_str());
+      fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    }
+  } else {
+#if defined(__linux__)
+    fd = memfd_create("livid-frames", MFD_CLOEXEC);
+#else
+    char tmp[64];
+    snprintf(tmp, sizeof(tmp), "/livid.%d.%p", (int)getpid(), (void *)&tmp);
+    fd = shm_open(tmp, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd >= 0)
+      shm_unlink(tmp);
+#endif
+  }
+  if (fd < 0) {
+    printf("[SharedFrameRing] Error: Could not create shared memory (%s)\n",
+           strerror(errno));
+    return nullptr;
+  }
+  if (ftruncate(fd, (off_t)size) != 0) {
+    ::close(fd);
+    if (!path.empty())
+      shm_unlink(path.c_str());
+    return nullptr;
+  }
+
+  SharedFrameRing *ring = new SharedFrameRing();
+  ring->m_name = path;
+  if (!ring->map(fd, size, true)) {
+    ::close(fd);
+    if (!path.empty())
+      shm_unlink(path.c_str());
+    delete ring;
+    return nullptr;
+  }
+
+  // Fresh shm/memfd pages are zero, which is a valid empty ring apart from
+  // the fence and the geometry.
+  RingHeader *h = ring->header();
+  h->version = kVersion;
+  h->slotCount = slotCount;
+  h->slotStride = stride;
+  h->regionSize = size;
+  h->fence.store(kNoFence, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  h->magic = kMagic;
+  return ring;
+}
+
+SharedFrameRing *SharedFrameRing::open(const char *name) {
+  if (!name)
+    return nullptr;
+  int fd = shm_open(shm_name(name).c_str(), O_RDWR, 0);
+  if (fd < 0)
+    return nullptr;
+  SharedFrameRing *ring = attach(fd);
+  ::close(fd);
+  return ring;
+}
+
+SharedFrameRing *SharedFrameRing::attach(int fd) {
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < kHeaderBytes)
+    return nullptr;
+  int own_fd = dup(fd);
+  if (own_fd < 0)
+    return nullptr;
+
+  SharedFrameRing *ring = new SharedFrameRing();
+  if (!ring->map(own_fd, (size_t)st.st_size, false)) {
+    ::close(own_fd);
+    delete ring;
+    return nullptr;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  RingHeader *h = ring->header();
+  if (h->magic != kMagic || h->version != kVersion || h->slotCount < 2 ||
+      h->regionSize != (uint64_t)st.st_size ||
+      kHeaderBytes + h->slotCount * h->slotStride > h->regionSize) {
+    printf("[SharedFrameRing] Error: Not a frame ring (or incompatible version)\n");
+    delete ring;
+    return nullptr;
+  }
+  return ring;
+}
+
+bool SharedFrameRing::publish(const Frame &frame) {
+  RingHeader *h = header();
+  if (frame.planeCount < 1 || frame.planeCount > kMaxPlanes)
+    return false;
+
+  // Lay the planes out before touching the slot.
+  uint64_t offsets[kMaxPlanes] = {0};
+  int32_t strides[kMaxPlanes] = {0};
+  size_t offset = kHandleBytes;
+  for (int p = 0; p < frame.planeCount; p++) {
+    if (!frame.planes[p] || frame.strides[p] <= 0 || frame.rows[p] <= 0)
+      return false;
+    strides[p] = (int32_t)round_up((size_t)frame.strides[p], kRowAlign);
+    offsets[p] = offset;
+    offset += (size_t)strides[p] * frame.rows[p];
+  }
+  if (offset > h->slotStride) {
+    h->droppedFrames.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  // Single producer: nobody else advances writeSeq.
+  uint64_t n = h->writeSeq.load(std::memory_order_relaxed);
+  FrameHandle *s = slot(n);
+  uint64_t previous = s->seq.load(std::memory_order_relaxed);
+
+  s->seq.store(2 * n + 1, std::memory_order_seq_cst);
+  uint64_t fenced = h->fence.load(std::memory_order_seq_cst);
+  if (previous != 0 && fenced == previous / 2 - 1) {
+    // The consumer holds the frame this slot carries.
+    s->seq.store(previous, std::memory_order_release);
+    h->droppedFrames.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  uint8_t *base = (uint8_t *)s;
+  for (int p = 0; p < frame.planeCount; p++) {
+    uint8_t *dst = base + offsets[p];
+    const uint8_t *src = frame.planes[p];
+    if (strides[p] == frame.strides[p]) {
+      memcpy(dst, src, (size_t)strides[p] * frame.rows[p]);
+      continue;
+    }
+    for (int y = 0; y < frame.rows[p]; y++)
+      memcpy(dst + (size_t)y * strides[p], src + (size_t)y * frame.strides[p],
+             (size_t)frame.strides[p]);
+  }
+
+  s->width = frame.width;
+  s->height = frame.height;
+  s->format = frame.format;
+  s->planeCount = frame.planeCount;
+  for (int p = 0; p < kMaxPlanes; p++) {
+    s->strides[p] = strides[p];
+    s->rows[p] = p < frame.planeCount ? frame.rows[p] : 0;
+    s->offsets[p] = offsets[p];
+  }
+  s->timestampNs = frame.timestampNs;
+  s->frameNumber = n;
+
+  s->seq.store(2 * n + 2, std::memory_order_release);
+  h->writeSeq.store(n + 1, std::memory_order_release);
+  return true;
+}
+
+void SharedFrameRing::close() {
+  header()->closed.store(1, std::memory_order_release);
+}
+
+bool SharedFrameRing::acquireLatest(Frame *frame) {
+  RingHeader *h = header();
+  uint64_t last_read = m_last_read;
+  for (int attempt = 0; attempt < 4; attempt++) {
+    uint64_t published = h->writeSeq.load(std::memory_order_acquire);
+    if (published == 0 || published - 1 == last_read)
+      return false;
+    uint64_t n = published - 1;
+
+    h->fence.store(n, std::memory_order_seq_cst);
+    FrameHandle *s = slot(n);
+    if (s->seq.load(std::memory_order_seq_cst) != 2 * n + 2) {
+      // Being rewritten with a newer frame; try that one.
+      h->fence.store(kNoFence, std::memory_order_release);
+      continue;
+    }
+
+    uint8_t *base = (uint8_t *)s;
+    frame->width = s->width;
+    frame->height = s->height;
+    frame->format = s->format;
+    frame->planeCount = s->planeCount;
+    for (int p = 0; p < kMaxPlanes; p++) {
+      bool used = p < s->planeCount;
+      frame->planes[p] = used ? base + s->offsets[p] : nullptr;
+      frame->strides[p] = used ? s->strides[p] : 0;
+      frame->rows[p] = used ? s->rows[p] : 0;
+    }
+    frame->timestampNs = s->timestampNs;
+    frame->frameNumber = n;
+    m_last_read = n;
+    return true;
+  }
+  return false;
+}
+
+bool SharedFrameRing::release(const Frame &frame) {
+  RingHeader *h = header();
+  uint64_t n = frame.frameNumber;
+  bool intact = slot(n)->seq.load(std::memory_order_acquire) == 2 * n + 2;
+  h->fence.store(kNoFence, std::memory_order_release);
+  return intact;
+}
+
+bool SharedFrameRing::isClosed() const {
+  return header()->closed.load(std::memory_order_acquire) != 0;
+}
+
+uint64_t SharedFrameRing::publishedFrames() const {
+  return header()->writeSeq.load(std::memory_order_acquire);
+}
+
+uint64_t SharedFrameRing::droppedFrames() const {
+  return header()->droppedFrames.load(std::memory_order_relaxed);
+}
+
+// --- C API ---
+
+static void to_c_frame(const SharedFrameRing::Frame &in, SharedFrame *out) {
+  for (int p = 0; p < 4; p++) {
+    out->planes[p] = in.planes[p];
+    out->strides[p] = in.strides[p];
+    out->rows[p] = in.rows[p];
+  }
+  out->planeCount = in.planeCount;
+  out->width = in.width;
+  out->height = in.height;
+  out->pixelFormat = in.format;
+  out->timestampNs = in.timestampNs;
+  out->frameNumber = in.frameNumber;
+}
+
+static SharedFrameRing::Frame from_c_frame(const SharedFrame *in) {
+  SharedFrameRing::Frame out = {};
+  for (int p = 0; p < 4; p++) {
+    out.planes[p] = in->planes[p];
+    out.strides[p] = in->strides[p];
+    out.rows[p] = in->rows[p];
+  }
+  out.planeCount = in->planeCount;
+  out.width = in->width;
+  out.height = in->height;
+  out.format = in->pixelFormat;
+  out.timestampNs = in->timestampNs;
+  out.frameNumber = in->frameNumber;
+  return out;
+}
+
+extern "C" {
+
+SharedFrameRingRef SharedFrameRing_Create(const char *name, uint32_t slotCount,
+                                          uint64_t slotBytes) {
+  return SharedFrameRing::create(name, slotCount, (size_t)slotBytes);
+}
+SharedFrameRingRef SharedFrameRing_Open(const char *name) {
+  return SharedFrameRing::open(name);
+}
+SharedFrameRingRef SharedFrameRing_Attach(int fd) {
+  return SharedFrameRing::attach(fd);
+}
+void SharedFrameRing_Destroy(SharedFrameRingRef ref) {
+  delete (SharedFrameRing *)ref;
+}
+int SharedFrameRing_GetFileDescriptor(SharedFrameRingRef ref) {
+  if (!ref)
+    return -1;
+  return ((SharedFrameRing *)ref)->fd();
+}
+bool SharedFrameRing_Publish(SharedFrameRingRef ref, const SharedFrame *frame) {
+  if (!ref || !frame)
+    return false;
+  return ((SharedFrameRing *)ref)->publish(from_c_frame(frame));
+}
+void SharedFrameRing_Close(SharedFrameRingRef ref) {
+  if (ref) {
+    ((SharedFrameRing *)ref)->close();
+  }
+}
+bool SharedFrameRing_AcquireLatest(SharedFrameRingRef ref,
+                                   SharedFrame *outFrame) {
+  if (!ref || !outFrame)
+    return false;
+  SharedFrameRing::Frame frame = {};
+  if (!((SharedFrameRing *)ref)->acquireLatest(&frame))
+    return false;
+  to_c_frame(frame, outFrame);
+  return true;
+}
+bool SharedFrameRing_Release(SharedFrameRingRef ref, const SharedFrame *frame) {
+  if (!ref || !frame)
+    return false;
+  return ((SharedFrameRing *)ref)->release(from_c_frame(frame));
+}
+bool SharedFrameRing_IsClosed(SharedFrameRingRef ref) {
+  if (!ref)
+    return true;
+  return ((SharedFrameRing *)ref)->isClosed();
+}
+uint64_t SharedFrameRing_GetDroppedFrames(SharedFrameRingRef ref) {
+  if (!ref)
+    return 0;
+  return ((SharedFrameRing *)ref)->droppedFrames();
+}
+}
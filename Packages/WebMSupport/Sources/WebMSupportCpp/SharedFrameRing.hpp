@@ -0,0 +1,107 @@
+#ifndef SHARED_FRAME_RING_HPP
+#define SHARED_FRAME_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Single-producer / single-consumer ring of video frames in shared memory, so
+// one process (the XPC helper) can hand decoded or filtered pictures to
+// another (the app) without serialization. The consumer reads pixels in
+// place; the producer makes the only copy, out of its decoder's buffers.
+//
+// Layout of the mapping (all offsets from the start of the region):
+//
+//   [0, 4096)                 RingHeader
+//   [4096 + i * slotStride)   slot i: FrameHandle, then plane data at
+//                             handle.offsets[p] (64-byte aligned rows)
+//
+// Sequence protocol. Frames are numbered 0, 1, 2, ...; frame n goes to slot
+// n % slotCount. Each slot carries a seqlock word:
+//   odd          the producer is writing the slot
+//   2 * n + 2    the slot holds frame n, stable
+// The producer marks the slot odd, checks the consumer's fence, writes the
+// handle and planes, stores 2n+2 (release) and finally advances writeSeq to
+// n + 1 (release). The consumer loads writeSeq (acquire), stores the frame
+// number it is about to read into the fence, then re-checks the slot's seq.
+// Fence store and seq store are both sequentially consistent, so either the
+// producer sees the fence and skips the frame (counted in droppedFrames) or
+// the consumer sees the odd seq and retries; a fenced slot is never
+// overwritten while the consumer holds it. The producer never blocks.
+class SharedFrameRing {
+public:
+  static const int kMaxPlanes = 4;
+  static const uint32_t kMagic = 0x4C564652; // "LVFR"
+  static const uint32_t kVersion = 1;
+  static const uint64_t kNoFence = ~0ULL;
+
+  // Describes one picture, in the producer's memory (publish) or inside the
+  // mapping (acquire).
+  struct Frame {
+    int width;
+    int height;
+    int format; // AVPixelFormat
+    int planeCount;
+    const uint8_t *planes[kMaxPlanes];
+    int strides[kMaxPlanes];
+    int rows[kMaxPlanes]; // Lines per plane (chroma may be subsampled)
+    int64_t timestampNs;
+    uint64_t frameNumber; // Set by acquire
+  };
+
+  ~SharedFrameRing();
+
+  SharedFrameRing(const SharedFrameRing &) = delete;
+  SharedFrameRing &operator=(const SharedFrameRing &) = delete;
+
+  // Producer side. With a name the region is a POSIX shm object others can
+  // open (sandboxed apps must prefix it with their app group identifier);
+  // without one it is anonymous (memfd on Linux, an immediately unlinked shm
+  // object on macOS) and reachable only through fd(), e.g. as a FileHandle
+  // passed over XPC.
+  static SharedFrameRing *create(const char *name, uint32_t slotCount,
+                                 size_t slotBytes);
+  // Consumer side.
+  static SharedFrameRing *open(const char *name);
+  static SharedFrameRing *attach(int fd);
+
+  int fd() const { return m_fd; }
+  uint32_t slotCount() const;
+  size_t slotBytes() const;
+
+  // Copies `frame` into the next slot. Returns false if it does not fit or
+  // the slot is fenced by the consumer (the frame is dropped).
+  bool publish(const Frame &frame);
+  // Marks the stream finished; consumers see isClosed().
+  void close();
+
+  // Newest frame not yet consumed, fenced against overwrite until release().
+  // Returns false if there is nothing new. Only one frame is held at a time.
+  bool acquireLatest(Frame *frame);
+  // Ends the hold. Returns false if the pixels were overwritten while held,
+  // which the protocol only allows after a producer restart.
+  bool release(const Frame &frame);
+
+  bool isClosed() const;
+  uint64_t publishedFrames() const;
+  uint64_t droppedFrames() const;
+
+private:
+  struct RingHeader;
+  struct FrameHandle;
+
+  SharedFrameRing() = default;
+  bool map(int fd, size_t size, bool owner);
+  RingHeader *header() const;
+  FrameHandle *slot(uint64_t index) const;
+
+  int m_fd = -1;
+  void *m_base = nullptr;
+  size_t m_size = 0;
+  bool m_owner = false;
+  std::string m_name;
+  uint64_t m_last_read = kNoFence; // Consumer side
+};
+
+#endif
@@ -0,0 +1,173 @@
+#include "TraceRecorder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+std::atomic<int> TraceRecorder::s_sessions{0};
+
+namespace {
+
+struct TraceEvent {
+  const char *name;
+  const char *argName;
+  int64_t arg;
+  int64_t start;
+  int64_t end;
+  uint32_t tid;
+};
+
+// Single writer (the owning thread). The head is published with release
+// order, so a reader that acquires it sees every event below it complete.
+struct TraceRing {
+  TraceEvent events[TraceRecorder::kRingEvents];
+  std::atomic<uint64_t> head{0};
+  std::atomic<bool> owned{true};
+};
+
+std::mutex g_rings_mutex;
+std::vector<TraceRing *> g_rings; // Never freed; reused once their thread exits
+std::atomic<uint32_t> g_next_tid{1};
+
+struct ThreadRing {
+  TraceRing *ring = nullptr;
+  uint32_t tid = 0;
+  ~ThreadRing() {
+    if (ring)
+      ring->owned.store(false, std::memory_order_release);
+  }
+};
+
+thread_local ThreadRing t_ring;
+
+TraceRing *claim_ring() {
+  std::lock_guard<std::mutex> lock(g_rings_mutex);
+  for (TraceRing *ring : g_rings) {
+    bool expected = false;
+    if (ring->owned.compare_exchange_strong(expected, true,
+                                            std::memory_order_acq_rel))
+      return ring;
+  }
+  g_rings.push_back(new TraceRing());
+  return g_rings.back();
+}
+
+} // namespace
+
+int64_t TraceRecorder::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void TraceRecorder::record(const char *name, int64_t start, int64_t end,
+                           const char *argName, int64_t arg) {
+  ThreadRing &local = t_ring;
+  if (!local.ring) {
+    local.ring = claim_ring();
+    local.tid = g_next_tid.fetch_add(1, std::memory_order_relaxed);
+  }
+  TraceRing *ring = local.ring;
+  uint64_t head = ring->head.load(std::memory_order_relaxed);
+  ring->events[head % kRingEvents] = {name, argName, arg, start, end,
+                                      local.tid};
+  ring->head.store(head + 1, std::memory_order_release);
+}
+
+bool TraceRecorder::write(const std::string &path, int64_t from, int64_t to) {
+  std::vector<TraceEvent> events;
+  int wrapped = 0;
+  {
+    std::lock_guard<std::mutex> lock(g_rings_mutex);
+    for (TraceRing *ring : g_rings) {
+      // The owner may still be recording. Once the ring has wrapped, the
+      // slot at `head` is the next one it overwrites, so it is skipped.
+      uint64_t head = ring->head.load(std::memory_order_acquire);
+      uint64_t first =
+          head >= (uint64_t)kRingEvents ? head - kRingEvents + 1 : 0;
+      size_t copied = events.size();
+      for (uint64_t i = first; i < head; i++)
+        events.push_back(ring->events[i % kRingEvents]);
+      // Spans the owner got to while they were being copied may be torn;
+      // drop them.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      uint64_t now_head = ring->head.load(std::memory_order_relaxed);
+      uint64_t valid =
+          now_head >= (uint64_t)kRingEvents ? now_head - kRingEvents + 1 : 0;
+      if (valid > first)
+        events.erase(events.begin() + copied,
+                     events.begin() + copied +
+                         (size_t)std::min(valid - first, head - first));
+      // The oldest span still held belongs to this session: earlier ones
+      // of it were overwritten.
+      if (first > 0 && events.size() > copied &&
+          events[copied].start >= from)
+        wrapped++;
+      events.erase(std::remove_if(events.begin() + copied, events.end(),
+                                  [&](const TraceEvent &event) {
+                                    return event.start < from ||
+                                           event.start >= to;
+                                  }),
+                   events.end());
+    }
+  }
+  std::sort(events.begin(), events.end(),
+            [](const TraceEvent &a, const TraceEvent &b) {
+              return a.start < b.start;
+            });
+
+  FILE *file = fopen(path.c_str(), "w");
+  if (!file) {
+    printf("[FFmpegWrapper] Trace: cannot write %s\n", path.c_str());
+    return false;
+  }
+  // Chrome trace-event format: complete ("X") events, times in microseconds
+  // from the start of the session.
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+                "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"args\":{\"name\":\"FFmpegWrapper\"}}");
+  for (const TraceEvent &event : events) {
+    fprintf(file,
+            ",\n{\"name\":\"%s\",\"cat\":\"transcode\",\"ph\":\"X\",\"pid\":1,"
+            "\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+            event.name, event.tid, (event.start - from) / 1e3,
+            (event.end - event.start) / 1e3);
+    if (event.argName)
+      fprintf(file, ",\"args\":{\"%s\":%lld}", event.argName,
+              (long long)event.arg);
+    fputc('}', file);
+  }
+  fprintf(file, "\n]}\n");
+  bool ok = fclose(file) == 0;
+  printf("[FFmpegWrapper] Trace: %zu spans written to %s", events.size(),
+         path.c_str());
+  if (wrapped > 0)
+    printf(" (oldest spans of %d thread(s) overwritten)", wrapped);
+  printf("\n");
+  return ok;
+}
+
+TraceSession::TraceSession(const std::string &path, int *depth) {
+  if (path.empty() || !depth)
+    return;
+  m_path = path;
+  m_depth = depth;
+  m_outermost = (*depth)++ == 0;
+  if (m_outermost) {
+    m_start = TraceRecorder::now();
+    TraceRecorder::s_sessions.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+TraceSession::~TraceSession() {
+  if (!m_depth)
+    return;
+  (*m_depth)--;
+  if (m_outermost) {
+    int64_t end = TraceRecorder::now();
+    TraceRecorder::s_sessions.fetch_sub(1, std::memory_order_relaxed);
+    TraceRecorder::write(m_path, m_start, end);
+  }
+}
@@ -0,0 +1,83 @@
+#ifndef TRACE_RECORDER_HPP
+#define TRACE_RECORDER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Opt-in timeline of where an operation spends its time. While a session is
+// open, TraceSpans land in a ring per recording thread that only that thread
+// writes, so recording takes no locks; a thread's ring is claimed once and
+// handed to a later thread after it exits. When the outermost session ends,
+// the spans recorded since it began are written as Chrome trace-event JSON
+// (chrome://tracing, Perfetto). With no session open a span costs one
+// relaxed load. Sessions running at the same time share the rings, so each
+// file also shows the other operation's spans.
+class TraceRecorder {
+public:
+  // Spans kept per thread; older ones are overwritten. A ring takes about
+  // 1.3 MB and is never freed: it is kept for the next thread that records
+  // once its own exits, so memory grows with the most threads that ever
+  // recorded at the same time, not with threads created.
+  static const int kRingEvents = 1 << 15;
+
+  static bool enabled() {
+    return s_sessions.load(std::memory_order_relaxed) > 0;
+  }
+  // Monotonic nanoseconds.
+  static int64_t now();
+  // `name` and `argName` must outlive the session (string literals).
+  // `argName` may be null.
+  static void record(const char *name, int64_t start, int64_t end,
+                     const char *argName, int64_t arg);
+
+private:
+  friend class TraceSession;
+
+  // Writes every span that started in [from, to).
+  static bool write(const std::string &path, int64_t from, int64_t to);
+
+  static std::atomic<int> s_sessions;
+};
+
+// Records its own lifetime as a span.
+class TraceSpan {
+public:
+  explicit TraceSpan(const char *name, const char *argName = nullptr,
+                     int64_t arg = 0)
+      : m_name(name), m_arg_name(argName), m_arg(arg),
+        m_start(TraceRecorder::enabled() ? TraceRecorder::now() : -1) {}
+  ~TraceSpan() {
+    if (m_start >= 0)
+      TraceRecorder::record(m_name, m_start, TraceRecorder::now(), m_arg_name,
+                            m_arg);
+  }
+
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+  const char *m_name;
+  const char *m_arg_name;
+  int64_t m_arg;
+  int64_t m_start;
+};
+
+// Enables recording for its lifetime when `path` is non-empty. Sessions
+// sharing a `depth` counter nest: only the outermost one writes `path`.
+class TraceSession {
+public:
+  TraceSession(const std::string &path, int *depth);
+  ~TraceSession();
+
+  TraceSession(const TraceSession &) = delete;
+  TraceSession &operator=(const TraceSession &) = delete;
+
+private:
+  std::string m_path;
+  int *m_depth = nullptr;
+  bool m_outermost = false;
+  int64_t m_start = 0;
+};
+
+#endif
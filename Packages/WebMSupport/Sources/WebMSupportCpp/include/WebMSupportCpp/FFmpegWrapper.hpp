@@ -1,7 +1,12 @@
 #ifndef FFMPEG_WRAPPER_HPP
 #define FFMPEG_WRAPPER_HPP
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
 typedef std::vector<uint8_t> Uint8Vector;
@@ -11,25 +16,126 @@ struct AVFormatContext;
 struct AVCodecContext;
 struct AVFrame;
 struct AVPacket;
+class DecodedFrameCache;
+class EncodedGopCache;
+class GrowingFileInput;
+struct GopUnit;
+class ReverseFrameSource;
+class SharedFrameRing;
 
 struct VideoFrameInfo {
   const uint8_t *planes[4];
   int strides[4];
   int width;
   int height;
+  int format; // AVPixelFormat
   long long timestamp_ns;
   bool is_key;
 };
 
+// Region of the decoded picture that holds content, in luma pixels.
+struct CropRect {
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+// Scores of one encoded frame against the picture handed to the encoder
+// (see setMeasureQuality).
+struct FrameQuality {
+  double time; // Source time in seconds
+  double psnr; // Luma, dB; 100 for identical samples
+  double ssim; // Luma, 0..1
+};
+
+// Decoder fidelity. Final is bit-exact; Preview skips non-reference frames,
+// the in-loop deblocking filter and film grain synthesis, and decodes at
+// reduced resolution where the codec supports it.
+enum class DecodeTier { Final, Preview };
+
+// Encoder used by prepareToMov. Hardware is hevc_videotoolbox at source size.
+// Software is x264 (x265 if x264 is missing) at ultrafast/zerolatency,
+// downscaled to kSoftwarePreviewHeight and capped at kSoftwarePreviewFps.
+// Auto uses Software when VideoToolbox is missing or rejects the stream.
+enum class PreviewEngine { Auto, Hardware, Software };
+
+// Filled in by each transcode; read with getLastStats() after it returns.
+struct TranscodeStats {
+  int64_t framesDecoded;
+  int64_t framesEncoded;
+  double elapsedSeconds;
+
+  // Memory budgeting (see setMemoryBudget)
+  int64_t memoryBudgetBytes;    // 0 when unbudgeted
+  int64_t estimatedMemoryBytes; // Planner's estimate for the chosen settings
+  int64_t peakResidentBytes;    // Process footprint high-water mark
+  int64_t peakMemoryBytes;      // Growth over the footprint at job start
+  int decoderThreads;           // 0 = library default
+  int encoderFrameThreads;
+  int encoderRcLookahead;
+  int encoderLookaheadSlices;
+  int filterThreads;
+
+  // Auto-crop (see setAutoCrop); zero size when nothing was cropped
+  CropRect crop;
+
+  // Duplicate merging (see setDropDuplicates)
+  int64_t framesMerged; // Repeats folded into the previous frame's duration
+
+  // Encoded GOP cache (see setGopCacheDirectory)
+  int gopsReused;
+  int gopsEncoded;
+
+  // prepareToMov ran on the software preview engine (see PreviewEngine)
+  bool softwarePreview;
+
+  // Quality meter (see setMeasureQuality); zero when nothing was measured
+  int64_t framesMeasured;
+  double meanPsnr;
+  double meanSsim;
+  double minSsim;
+
+  // Clip concatenation (see concatToMov)
+  int clipsCopied;
+  int clipsReencoded;
+
+  // Loop seam (see loopSeamToMov)
+  int seamFramesBlended;
+  double seamSecondsCopied; // Output time stream-copied around the seam
+
+  // Reverse/boomerang export (see reverseToMov)
+  int reverseGopsSpilled;           // GOPs too large to hold decoded
+  int64_t reversePeakBufferedBytes; // Decoded pictures held at once
+
+  // Playback budget (see setPlaybackBudget). The peak is measured on every
+  // encode, the rest only when the budget applied.
+  int64_t peakBitrate; // Most bits in any one second of output
+  int playbackLevel;   // HEVC level x 10 (51 = 5.1)
+  int64_t vbvMaxrate;  // bits/s
+  int vbvUnderflows;   // Frames that would have drained the VBV buffer
+  double decodeLoad;   // Share of the level's luma rate or bitrate used
+
+  // Frames converted by the chroma fast path (4:4:4, 4:2:2 or RGB sources
+  // exported as yuv420p10le) instead of the filter graph
+  int64_t framesChromaConverted;
+};
+
 class FFmpegWrapper {
 public:
   FFmpegWrapper(const char *path);
+  // Opens a file that is still being written (see GrowingFileInput): reads
+  // at its end wait for more data until completionMarker exists or
+  // markInputComplete() is called. Opening itself waits for enough data to
+  // probe the streams.
+  FFmpegWrapper(const char *path, const char *completionMarker);
   ~FFmpegWrapper();
 
   static FFmpegWrapper *create(const char *path);
   static void destroy(FFmpegWrapper *wrapper);
 
   bool isOpen() const;
+  void markInputComplete();
   double getDuration() const;
   int getWidth() const;
   int getHeight() const;
@@ -47,13 +153,134 @@ public:
                       void *user_data);
   bool remuxToMov(const char *outputPath, double startTime, double endTime,
                   ProgressCallback cb, void *user_data);
+  // Joins this file and `nextClips`, in order, into one HEVC MOV with
+  // continuous timestamps. Clips whose video parameters (codec, geometry,
+  // format, colour tags, frame rate and hvcC) match are stream-copied; the
+  // others are first re-encoded with the export settings, fitted and padded
+  // to the copied clips' frame size and rate.
+  bool concatToMov(const std::vector<std::string> &nextClips,
+                   const char *outputPath, ProgressCallback cb,
+                   void *user_data);
+  // Makes the clip loop seamlessly: its last `blendFrames` frames crossfade
+  // into its first ones, which are then cut from the start, so the wrap
+  // from the end back to the start continues the motion instead of jumping.
+  // Only the GOPs before the first clean HEVC cut point after the new start
+  // and from the last one before the fade are re-encoded (export settings);
+  // the middle is stream-copied when the re-encoded parameters match it,
+  // e.g. when this file is a previous export (exports use closed GOPs, so
+  // every keyframe is a cut point). Otherwise the middle is re-encoded too;
+  // a source without clean cut points is re-encoded in one pass.
+  // blendFrames is capped at kMaxLoopSeamFrames and a third of the clip.
+  static const int kMaxLoopSeamFrames = 60;
+  bool loopSeamToMov(const char *outputPath, int blendFrames,
+                     ProgressCallback cb, void *user_data);
+  // Exports [startTime, endTime] (0 = to the end) played backwards, or with
+  // `boomerang` forwards and then backwards, with the export settings. The
+  // source is decoded GOP by GOP from the end; GOPs larger than the reverse
+  // buffer (a quarter of the memory budget, else
+  // ReverseFrameSource::kDefaultBufferBytes) go through a lossless spill
+  // file next to the output.
+  bool reverseToMov(const char *outputPath, double startTime, double endTime,
+                    bool boomerang, ProgressCallback cb, void *user_data);
+  // Writes an all-intra H.264 companion at reduced height for scrubbing:
+  // every frame is a keyframe on the source's timeline, so any seek decodes
+  // exactly one frame. The output is tagged with the source's file identity.
+  bool generateProxy(const char *outputPath, int targetHeight,
+                     ProgressCallback cb, void *user_data);
+  // Identity of the opened file (see file_identity); changes whenever the
+  // file is replaced or modified.
+  std::string getFileIdentity() const;
+
+  // Cancels the running operation. Also aborts blocking demuxer I/O through
+  // the input's AVIOInterruptCB.
+  void stop();
+  // Suspends the running transcode between frames without tearing down the
+  // decoder or encoder.
+  void pause();
+  void resume();
+  bool isStopRequested() const { return m_should_stop.load(); }
+
+  // When set, exports write closed-GOP segments plus a journal into this
+  // directory so a cancelled or crashed export resumes from the last
+  // completed GOP. Pass nullptr or "" to disable.
+  void setCheckpointDirectory(const char *dir);
+  // Deletes any segments and journal left in the checkpoint directory.
+  void discardCheckpoint();
+
+  // When set, software exports store each encoded source GOP here and later
+  // exports of the same source and settings reuse the GOPs their trim fully
+  // covers, encoding only the rest. Units committed before a cancellation
+  // are kept, so this also stands in for checkpointing. Least recently used
+  // units beyond capacityBytes are evicted (0 = unbounded).
+  void setGopCacheDirectory(const char *dir, int64_t capacityBytes);
+
+  // Caps the memory a transcode may use. Decoder threading, x265
+  // frame-threads/lookahead/pools and filter threading are derived from the
+  // budget and the stream geometry. 0 restores library defaults.
+  void setMemoryBudget(int64_t bytes) { m_memory_budget = bytes; }
+  const TranscodeStats &getLastStats() const { return m_last_stats; }
+
+  // Tier used by prepareToMov and decodeNextFrame; Final unless a caller opts
+  // into Preview. Seeking, exports and remuxing always decode at Final.
+  void setDecodeTier(DecodeTier tier) { m_decode_tier = tier; }
+  DecodeTier getDecodeTier() const { return m_decode_tier; }
+
+  static const int kSoftwarePreviewHeight = 720;
+  static const int kSoftwarePreviewFps = 30;
+  void setPreviewEngine(PreviewEngine engine) { m_preview_engine = engine; }
+
+  // Exports detect baked-in letterbox/pillarbox bars over the trim range and
+  // encode only the picture inside them.
+  void setAutoCrop(bool enabled) { m_auto_crop = enabled; }
+  // Samples frames across [startTime, endTime] (0 = to the end) and returns
+  // the stable content rectangle. False if there are no bars worth cropping.
+  bool detectCrop(double startTime, double endTime, CropRect *rect);
 
-  void stop() { m_should_stop = true; }
+  // Exports skip frames that repeat the previous encoded one and lengthen
+  // that frame's sample duration instead, up to one second per sample.
+  void setDropDuplicates(bool enabled) { m_drop_duplicates = enabled; }
+
+  // x265 exports are held to the lowest Main-tier HEVC level that fits the
+  // output size and frame rate, with a VBV cap scaled to the luma sample
+  // rate (see PlaybackLimits), so the wallpaper player decodes them cheaply.
+  // The encoded stream is checked against the cap afterwards.
+  void setPlaybackBudget(bool enabled) { m_playback_budget = enabled; }
+
+  // Exports decode each encoded packet again and score it against the
+  // picture that went into the encoder (PSNR/SSIM on a luma grid, see
+  // QualityMeter). Costs one extra decode of the output. Per-frame scores
+  // of the last export are in getFrameQuality(), the summary in the stats.
+  void setMeasureQuality(bool enabled) { m_measure_quality = enabled; }
+  const std::vector<FrameQuality> &getFrameQuality() const {
+    return m_frame_quality;
+  }
+
+  // Publishes every picture handed to the encoder (after scaling/tone
+  // mapping) to `ring` for a live preview in another process. The ring is not
+  // owned and must outlive the transcode. nullptr stops publishing.
+  void setPreviewRing(SharedFrameRing *ring) { m_preview_ring = ring; }
+
+  // Records a timeline of every operation (read, decode, filter, encode,
+  // write, flush... per frame and per thread, see TraceRecorder) and writes
+  // it to `path` as Chrome trace-event JSON when the operation ends,
+  // replacing the previous trace. nullptr or "" turns tracing off.
+  void setTraceFile(const char *path) { m_trace_path = path ? path : ""; }
 
   // Manual decoding (if needed)
   bool initDecoder();
   VideoFrameInfo decodeNextFrame();
 
+  // Random access. Returns the picture on screen at `pts` (stream time base)
+  // or `time` (seconds): the last frame at or before it. Misses decode from
+  // the preceding keyframe and cache every GOP passed on the way, so nearby
+  // and backward steps are served without decoding. The returned planes stay
+  // valid until the next decode call. Afterwards decodeNextFrame() continues
+  // from wherever the last cache fill left the demuxer.
+  VideoFrameInfo seekToFrame(int64_t pts);
+  VideoFrameInfo frameAt(double time);
+  // Bytes of decoded pictures kept for random access (default 256 MB).
+  void setFrameCacheCapacity(int64_t bytes);
+
 private:
   AVFormatContext *m_fmt_ctx;
   AVCodecContext *m_dec_ctx;
@@ -61,7 +288,36 @@ private:
   AVPacket *m_pkt;
   int m_video_stream_idx;
   bool m_decoder_initialized;
-  bool m_should_stop = false;
+  std::atomic<bool> m_should_stop{false};
+  std::atomic<bool> m_paused{false};
+  std::mutex m_pause_mutex;
+  std::condition_variable m_pause_cv;
+  // Concat clips being encoded; stop/pause/resume reach them too. Guarded by
+  // m_pause_mutex.
+  std::vector<FFmpegWrapper *> m_children;
+  bool m_owns_stop = true; // False for a clip: only its parent resets it
+  int m_operation_depth = 0;
+  std::string m_path;
+  std::string m_checkpoint_dir;
+  std::string m_gop_cache_dir;
+  int64_t m_gop_cache_capacity = 0;
+  int64_t m_memory_budget = 0;
+  int m_decoder_threads = 0; // 0 = auto
+  bool m_decoder_frame_threads = true;
+  DecodeTier m_decode_tier = DecodeTier::Final;
+  DecodeTier m_decoder_tier = DecodeTier::Final; // Tier of the open decoder
+  PreviewEngine m_preview_engine = PreviewEngine::Auto;
+  TranscodeStats m_last_stats = {};
+  std::unique_ptr<DecodedFrameCache> m_frame_cache;
+  SharedFrameRing *m_preview_ring = nullptr;
+  bool m_auto_crop = false;
+  bool m_drop_duplicates = false;
+  bool m_measure_quality = false;
+  bool m_playback_budget = false;
+  std::vector<FrameQuality> m_frame_quality;
+  std::unique_ptr<GrowingFileInput> m_growing_input;
+  std::string m_trace_path;
+  int m_trace_depth = 0; // Nested TraceSessions of the running operation
 
   struct TranscodeSettings {
     const char *encoderName;
@@ -81,11 +337,73 @@ private:
     double endTime;
     bool useFilterGraph;
     bool useStreamCopy;
+    DecodeTier decodeTier = DecodeTier::Final;
+    bool intraOnly = false; // Every frame a keyframe, on source timestamps
+    bool autoCrop = false;
+    bool dropDuplicates = false;
+    bool measureQuality = false;
+    bool playbackBudget = false;
+    const char *tune = nullptr;
+    // Scale into this frame keeping the aspect ratio and pad the rest
+    // (filter graph only). 0 keeps the source geometry.
+    int fitWidth = 0;
+    int fitHeight = 0;
+    bool exactFps = false; // targetFps also raises lower source rates
+    CropRect crop = {}; // Fixed crop; zero size detects it if autoCrop
+    // Loop seam: decoded frames from blendStart on are crossfaded into these
+    // in order, each weighted more towards its blend frame than the last.
+    const std::vector<AVFrame *> *blendFrames = nullptr;
+    double blendStart = 0;
+    // Encoded after the forward frames (boomerang) or instead of them, on a
+    // timeline mirrored around the last frame.
+    ReverseFrameSource *reverseFrames = nullptr;
+    bool boomerang = false;
+    // Set for the encoder sessions of a GOP-cached export: the run of units
+    // to encode, each starting on a forced keyframe.
+    EncodedGopCache *gopCache = nullptr;
+    const std::vector<GopUnit> *gopUnits = nullptr;
+  };
+
+  FFmpegWrapper(const char *path, const char *completionMarker, bool growing);
+
+  // Held by every public operation. The outermost one starts from a clear
+  // stop/pause state, so a stop() only cancels the operation it was meant
+  // for; nested ones (the crop scan or runs of an export) keep the state,
+  // and a concat clip's is left to its parent.
+  struct OperationScope {
+    explicit OperationScope(FFmpegWrapper *wrapper) : m_wrapper(wrapper) {
+      if (m_wrapper->m_operation_depth++ == 0 && m_wrapper->m_owns_stop) {
+        m_wrapper->m_should_stop = false;
+        m_wrapper->m_paused = false;
+      }
+    }
+    ~OperationScope() { m_wrapper->m_operation_depth--; }
+
+  private:
+    FFmpegWrapper *m_wrapper;
   };
 
   bool transcodeInternal(const char *outputPath,
                          const TranscodeSettings &settings,
                          ProgressCallback progressCallback, void *user_data);
+  TranscodeSettings defaultExportSettings() const;
+  // Hands our stop/pause state, memory budget and tracing to a concat clip.
+  void adoptClip(FFmpegWrapper *clip);
+  static std::string settingsKey(const TranscodeSettings &settings);
+  bool exportWithGopCache(const char *outputPath,
+                          const TranscodeSettings &settings,
+                          ProgressCallback progressCallback, void *user_data);
+  bool scanKeyframes(double startTime, double endTime,
+                     std::vector<double> *times);
+  bool scanSeamPoints(std::vector<double> *frameTimes,
+                      std::vector<double> *cutTimes);
+  bool decodeLeadingFrames(int count, std::vector<AVFrame *> *frames);
+  bool openDecoder(DecodeTier tier);
+  void closeDecoder();
+  bool decodeGopsAround(int64_t pts);
+  bool decodeFrameNear(double time);
+  VideoFrameInfo currentFrameInfo() const;
+  void waitWhilePaused();
   void cleanup();
 };
 
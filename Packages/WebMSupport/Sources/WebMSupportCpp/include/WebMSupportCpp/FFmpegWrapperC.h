@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "SharedFrameRingC.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -11,6 +13,11 @@ extern "C" {
 typedef void *FFmpegWrapperRef;
 
 FFmpegWrapperRef FFmpegWrapper_Create(const char *path);
+// Input still being downloaded; complete once `completionMarker` exists (may
+// be null) or FFmpegWrapper_MarkInputComplete is called.
+FFmpegWrapperRef FFmpegWrapper_CreateGrowing(const char *path,
+                                             const char *completionMarker);
+void FFmpegWrapper_MarkInputComplete(FFmpegWrapperRef ref);
 void FFmpegWrapper_Destroy(FFmpegWrapperRef ref);
 bool FFmpegWrapper_IsOpen(FFmpegWrapperRef ref);
 double FFmpegWrapper_GetDuration(FFmpegWrapperRef ref);
@@ -34,8 +41,170 @@ bool FFmpegWrapper_ExportToMovExt(FFmpegWrapperRef ref, const char *outputPath,
 bool FFmpegWrapper_RemuxToMov(FFmpegWrapperRef ref, const char *outputPath,
                                 double startTime, double endTime,
                                 FFmpegProgressCallback cb, void *user_data);
+// Joins the opened file and nextPaths[0..count) into one HEVC MOV. Clips
+// matching the largest group of identical HEVC clips are stream-copied, the
+// rest re-encoded to that group's frame size and rate first.
+bool FFmpegWrapper_ConcatToMov(FFmpegWrapperRef ref,
+                               const char *const *nextPaths, int count,
+                               const char *outputPath,
+                               FFmpegProgressCallback cb, void *user_data);
+// Writes a copy that loops seamlessly: the last blendFrames frames fade into
+// the first ones, which are dropped from the start. Only the GOPs at either
+// end are re-encoded when the rest can be stream-copied.
+bool FFmpegWrapper_LoopSeamToMov(FFmpegWrapperRef ref, const char *outputPath,
+                                 int blendFrames, FFmpegProgressCallback cb,
+                                 void *user_data);
+// Exports [startTime, endTime] backwards, or forwards then backwards when
+// boomerang is set, decoding the source one GOP at a time from the end.
+bool FFmpegWrapper_ReverseToMov(FFmpegWrapperRef ref, const char *outputPath,
+                                double startTime, double endTime,
+                                bool boomerang, FFmpegProgressCallback cb,
+                                void *user_data);
+
+// All-intra scrubbing proxy. targetHeight <= 0 picks 540p.
+bool FFmpegWrapper_GenerateProxy(FFmpegWrapperRef ref, const char *outputPath,
+                                 int targetHeight, FFmpegProgressCallback cb,
+                                 void *user_data);
+// Copies the source's file identity (NUL-terminated) into buffer. Returns
+// false if there is no identity or it does not fit.
+bool FFmpegWrapper_GetFileIdentity(FFmpegWrapperRef ref, char *buffer,
+                                   int bufferSize);
+
+// A decoded picture. Planes belong to the wrapper and stay valid until its
+// next decode call.
+typedef struct {
+  const uint8_t *planes[4];
+  int strides[4];
+  int width;
+  int height;
+  int pixelFormat; // AVPixelFormat
+  long long timestampNs;
+  bool isKey;
+} FFmpegVideoFrame;
+
+// Random access through a GOP-granular cache of decoded pictures.
+bool FFmpegWrapper_SeekToFrame(FFmpegWrapperRef ref, int64_t pts,
+                               FFmpegVideoFrame *outFrame);
+bool FFmpegWrapper_FrameAt(FFmpegWrapperRef ref, double time,
+                           FFmpegVideoFrame *outFrame);
+void FFmpegWrapper_SetFrameCacheCapacity(FFmpegWrapperRef ref, int64_t bytes);
+
+// Live preview of transcodes: every encoder input picture is published to the
+// ring (not owned; NULL stops publishing).
+void FFmpegWrapper_SetPreviewRing(FFmpegWrapperRef ref, SharedFrameRingRef ring);
 
 void FFmpegWrapper_Stop(FFmpegWrapperRef ref);
+void FFmpegWrapper_Pause(FFmpegWrapperRef ref);
+void FFmpegWrapper_Resume(FFmpegWrapperRef ref);
+
+// Checkpointed exports: segments + journal live in `dir` until the export
+// completes, so a later export with the same source and settings resumes.
+void FFmpegWrapper_SetCheckpointDirectory(FFmpegWrapperRef ref,
+                                          const char *dir);
+void FFmpegWrapper_DiscardCheckpoint(FFmpegWrapperRef ref);
+// Encoded GOP cache shared by exports of any source; 0 capacity = unbounded.
+void FFmpegWrapper_SetGopCacheDirectory(FFmpegWrapperRef ref, const char *dir,
+                                        int64_t capacityBytes);
+
+typedef enum FFmpegDecodeTier {
+  FFmpegDecodeTierFinal = 0,  // Bit-exact
+  FFmpegDecodeTierPreview = 1 // Skips non-ref frames, loop filter, grain
+} FFmpegDecodeTier;
+
+// Tier for PrepareToMov and manual decoding; exports are always Final.
+void FFmpegWrapper_SetDecodeTier(FFmpegWrapperRef ref, FFmpegDecodeTier tier);
+
+typedef enum FFmpegPreviewEngine {
+  FFmpegPreviewEngineAuto = 0,     // VideoToolbox, software if unavailable
+  FFmpegPreviewEngineHardware = 1, // hevc_videotoolbox
+  FFmpegPreviewEngineSoftware = 2  // x264 ultrafast, 720p, 30 fps cap
+} FFmpegPreviewEngine;
+
+// Encoder for PrepareToMov.
+void FFmpegWrapper_SetPreviewEngine(FFmpegWrapperRef ref,
+                                    FFmpegPreviewEngine engine);
+
+typedef struct FFmpegTranscodeStats {
+  int64_t framesDecoded;
+  int64_t framesEncoded;
+  double elapsedSeconds;
+  int64_t memoryBudgetBytes;
+  int64_t estimatedMemoryBytes;
+  int64_t peakResidentBytes;
+  int64_t peakMemoryBytes;
+  int decoderThreads;
+  int encoderFrameThreads;
+  int encoderRcLookahead;
+  int encoderLookaheadSlices;
+  int filterThreads;
+  int cropX; // Auto-crop rectangle; zero size when not cropped
+  int cropY;
+  int cropWidth;
+  int cropHeight;
+  int64_t framesMerged; // Duplicates folded into longer sample durations
+  int gopsReused;       // Encoded GOP cache hits
+  int gopsEncoded;
+  bool softwarePreview; // PrepareToMov used the software engine
+  int64_t framesMeasured; // Quality meter; zero when off
+  double meanPsnr;        // Luma, dB
+  double meanSsim;        // Luma
+  double minSsim;
+  int clipsCopied;    // ConcatToMov
+  int clipsReencoded;
+  int seamFramesBlended;    // LoopSeamToMov
+  double seamSecondsCopied;
+  int reverseGopsSpilled;   // ReverseToMov
+  int64_t reversePeakBufferedBytes;
+  int64_t peakBitrate; // bits/s over the busiest second
+  int playbackLevel;   // Playback budget: HEVC level x 10, 0 when off
+  int64_t vbvMaxrate;  // bits/s
+  int vbvUnderflows;
+  double decodeLoad; // Share of the level's decode capacity used
+  int64_t framesChromaConverted; // Chroma fast path (high-chroma/RGB input)
+} FFmpegTranscodeStats;
+
+typedef struct {
+  double time; // Source seconds
+  double psnr;
+  double ssim;
+} FFmpegFrameQuality;
+
+// Holds subsequent x265 exports to the lowest HEVC level and a VBV cap that
+// fit their size and frame rate, for cheap hardware playback.
+void FFmpegWrapper_SetPlaybackBudget(FFmpegWrapperRef ref, bool enabled);
+
+// Scores each encoded frame of subsequent exports against the encoder input.
+void FFmpegWrapper_SetMeasureQuality(FFmpegWrapperRef ref, bool enabled);
+// Copies up to `capacity` per-frame scores of the last export and returns
+// how many there are.
+int FFmpegWrapper_GetFrameQuality(FFmpegWrapperRef ref,
+                                  FFmpegFrameQuality *outFrames, int capacity);
+
+// Writes a Chrome trace-event JSON timeline of each subsequent operation to
+// `path`; NULL turns tracing off.
+void FFmpegWrapper_SetTraceFile(FFmpegWrapperRef ref, const char *path);
+
+typedef struct {
+  int x;
+  int y;
+  int width;
+  int height;
+} FFmpegCropRect;
+
+// Letterbox/pillarbox removal for exports.
+void FFmpegWrapper_SetAutoCrop(FFmpegWrapperRef ref, bool enabled);
+// Content rectangle over [startTime, endTime]; false when there are no bars.
+bool FFmpegWrapper_DetectCrop(FFmpegWrapperRef ref, double startTime,
+                              double endTime, FFmpegCropRect *outRect);
+
+// Merges repeated frames into longer sample durations on export.
+void FFmpegWrapper_SetDropDuplicates(FFmpegWrapperRef ref, bool enabled);
+
+// Memory budget in bytes for subsequent transcodes (0 = unbudgeted).
+void FFmpegWrapper_SetMemoryBudget(FFmpegWrapperRef ref, int64_t bytes);
+// Stats of the most recent transcode. Returns false for a null ref.
+bool FFmpegWrapper_GetLastStats(FFmpegWrapperRef ref,
+                                FFmpegTranscodeStats *outStats);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,53 @@
+#ifndef SHARED_FRAME_RING_C_H
+#define SHARED_FRAME_RING_C_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Shared-memory frame ring between processes; see SharedFrameRing.hpp for the
+// layout and the sequence/fence protocol. One producer, one consumer.
+typedef void *SharedFrameRingRef;
+
+// A picture in the ring. On the consumer side the planes point into the
+// shared mapping and are valid until SharedFrameRing_Release.
+typedef struct {
+  const uint8_t *planes[4];
+  int strides[4];
+  int rows[4];
+  int planeCount;
+  int width;
+  int height;
+  int pixelFormat; // AVPixelFormat
+  long long timestampNs;
+  uint64_t frameNumber;
+} SharedFrame;
+
+// Producer. A NULL name creates an anonymous region reachable only through
+// its file descriptor (e.g. sent over XPC as a FileHandle).
+SharedFrameRingRef SharedFrameRing_Create(const char *name, uint32_t slotCount,
+                                          uint64_t slotBytes);
+// Consumer, by shm name or by a descriptor received from the producer (which
+// is duplicated; the caller keeps its own).
+SharedFrameRingRef SharedFrameRing_Open(const char *name);
+SharedFrameRingRef SharedFrameRing_Attach(int fd);
+void SharedFrameRing_Destroy(SharedFrameRingRef ref);
+int SharedFrameRing_GetFileDescriptor(SharedFrameRingRef ref);
+
+bool SharedFrameRing_Publish(SharedFrameRingRef ref, const SharedFrame *frame);
+void SharedFrameRing_Close(SharedFrameRingRef ref);
+
+bool SharedFrameRing_AcquireLatest(SharedFrameRingRef ref,
+                                   SharedFrame *outFrame);
+bool SharedFrameRing_Release(SharedFrameRingRef ref, const SharedFrame *frame);
+bool SharedFrameRing_IsClosed(SharedFrameRingRef ref);
+uint64_t SharedFrameRing_GetDroppedFrames(SharedFrameRingRef ref);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
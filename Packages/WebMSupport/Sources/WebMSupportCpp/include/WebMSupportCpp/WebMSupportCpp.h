@@ -6,5 +6,6 @@
 
 #include "FFmpegWrapper.hpp"
 #include "FFmpegWrapperC.h"
+#include "SharedFrameRingC.h"
 
 #endif
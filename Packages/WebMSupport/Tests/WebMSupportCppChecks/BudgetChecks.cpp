@@ -0,0 +1,122 @@
+#include "Check.hpp"
+#include "MemoryBudget.hpp"
+#include "PlaybackBudget.hpp"
+#include "WebMSupportCppChecks.h"
+
+const char *CppCheck_PlaybackLimits(void) {
+  PlaybackLimits limits;
+
+  // 1080p30 fits level 4; the cap is 0.12 bit per luma sample.
+  CHECK(playback_limits(1920, 1080, 30, &limits));
+  CHECK(limits.level == 40);
+  CHECK(limits.levelMaxBitrate == 12000000);
+  CHECK(limits.vbvMaxrate == 7464960);
+  CHECK(limits.vbvBufsize == limits.vbvMaxrate);
+
+  // Doubling the rate moves up a sub-level, not a level.
+  CHECK(playback_limits(1920, 1080, 60, &limits));
+  CHECK(limits.level == 41);
+  CHECK(limits.vbvMaxrate == 14929920);
+
+  // 2160p60: the per-sample cap is above level 5.1's bitrate, which wins.
+  CHECK(playback_limits(3840, 2160, 60, &limits));
+  CHECK(limits.level == 51);
+  CHECK(limits.vbvMaxrate == 40000000);
+  CHECK(limits.vbvMaxrate <= limits.levelMaxBitrate);
+
+  // A wide panorama fits level 4's picture size but not its 4222-sample
+  // side limit.
+  CHECK(playback_limits(4480, 480, 30, &limits));
+  CHECK(limits.level == 50);
+
+  // Frame rates below 1 count as 1.
+  CHECK(playback_limits(1280, 720, 0, &limits));
+  CHECK(limits.level == 31);
+
+  CHECK(playback_limits(7680, 4320, 120, &limits));
+  CHECK(limits.level == 62);
+  CHECK(!playback_limits(7680, 4320, 240, &limits));
+  CHECK(!playback_limits(16384, 8640, 30, &limits));
+  return nullptr;
+}
+
+const char *CppCheck_BitrateMeter(void) {
+  // 32 fps keeps frame times exact, so each one-second window holds exactly
+  // 32 frames.
+  BitrateMeter meter;
+  meter.setVbv(2560000, 2560000);
+  for (int i = 0; i < 96; i++)
+    meter.addFrame(i / 32.0, 10000);
+  CHECK(meter.peakBitsPerSecond() == 32 * 80000);
+  CHECK(meter.vbvUnderflows() == 0);
+
+  // One frame bigger than what the buffer holds at that point runs it dry.
+  meter.addFrame(96 / 32.0, 300000);
+  CHECK(meter.vbvUnderflows() == 1);
+  CHECK(meter.peakBitsPerSecond() == 31 * 80000 + 2400000);
+  // Refilling at maxrate recovers.
+  for (int i = 97; i < 160; i++)
+    meter.addFrame(i / 32.0, 10000);
+  CHECK(meter.vbvUnderflows() == 1);
+
+  // Without setVbv only the peak is tracked.
+  BitrateMeter peak_only;
+  peak_only.addFrame(0, 1000000);
+  CHECK(peak_only.vbvUnderflows() == 0);
+  CHECK(peak_only.peakBitsPerSecond() == 8000000);
+  return nullptr;
+}
+
+const char *CppCheck_MemoryBudget(void) {
+  MemoryBudgetInput input = {};
+  input.decodeWidth = 3840;
+  input.decodeHeight = 2160;
+  input.decodeBytesPerSample = 2;
+  input.encodeWidth = 3840;
+  input.encodeHeight = 2160;
+  input.tenBitOutput = true;
+  input.floatFilters = true;
+
+  // No budget: every library default is left alone.
+  MemoryPlan plan = plan_memory_budget(input);
+  CHECK(plan.withinBudget);
+  CHECK(plan.decoderFrameThreads);
+  CHECK(plan.decoderThreads == 0 && plan.x265FrameThreads == 0);
+  CHECK(plan.x265RcLookahead == 0 && plan.filterThreads == 0);
+
+  // A budget nothing comes close to keeps the x265 defaults.
+  input.budgetBytes = 1LL << 40;
+  plan = plan_memory_budget(input);
+  CHECK(plan.withinBudget);
+  CHECK(plan.decoderFrameThreads);
+  CHECK(plan.x265RcLookahead == 20);
+  CHECK(plan.x265FrameThreads >= 1 && plan.decoderThreads >= 1);
+  CHECK(plan.estimatedBytes <= input.budgetBytes);
+
+  // Shrinking the budget only ever sheds parallelism, and a plan reported
+  // within budget is.
+  MemoryPlan previous = plan;
+  for (int64_t mb = 8192; mb >= 64; mb -= 64) {
+    input.budgetBytes = mb << 20;
+    plan = plan_memory_budget(input);
+    CHECK_AT(!plan.withinBudget || plan.estimatedBytes <= input.budgetBytes,
+             mb);
+    CHECK_AT(plan.estimatedBytes <= previous.estimatedBytes, mb);
+    CHECK_AT(plan.x265RcLookahead <= previous.x265RcLookahead, mb);
+    CHECK_AT(plan.x265FrameThreads <= previous.x265FrameThreads, mb);
+    CHECK_AT(plan.decoderThreads <= previous.decoderThreads, mb);
+    CHECK_AT(plan.filterThreads <= previous.filterThreads, mb);
+    CHECK_AT(previous.decoderFrameThreads || !plan.decoderFrameThreads, mb);
+    CHECK_AT(plan.x265LookaheadSlices >= 1 && plan.x265Pools >= 1, mb);
+    previous = plan;
+  }
+
+  // An impossible budget ends at the leanest plan and says so.
+  input.budgetBytes = 1;
+  plan = plan_memory_budget(input);
+  CHECK(!plan.withinBudget);
+  CHECK(!plan.decoderFrameThreads);
+  CHECK(plan.x265FrameThreads == 1 && plan.filterThreads == 1);
+  CHECK(plan.x265RcLookahead == 5); // B-frames + 1
+  return nullptr;
+}
@@ -0,0 +1,17 @@
+#include "Check.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+const char *check_failed(const char *file, int line, const char *expr,
+                         long long at) {
+  static thread_local char message[512];
+  const char *name = strrchr(file, '/');
+  name = name ? name + 1 : file;
+  if (at >= 0)
+    snprintf(message, sizeof(message), "%s:%d: %s (at %lld)", name, line, expr,
+             at);
+  else
+    snprintf(message, sizeof(message), "%s:%d: %s", name, line, expr);
+  return message;
+}
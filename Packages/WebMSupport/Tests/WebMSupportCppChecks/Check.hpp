@@ -0,0 +1,17 @@
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+// Records a failed check for the caller; returns the description.
+const char *check_failed(const char *file, int line, const char *expr,
+                         long long at);
+
+// Returns from the enclosing check function on failure. CHECK_AT adds a
+// value to the description, e.g. the width a kernel failed at.
+#define CHECK_AT(cond, at)                                                     \
+  do {                                                                         \
+    if (!(cond))                                                               \
+      return check_failed(__FILE__, __LINE__, #cond, (long long)(at));         \
+  } while (0)
+#define CHECK(cond) CHECK_AT(cond, -1)
+
+#endif
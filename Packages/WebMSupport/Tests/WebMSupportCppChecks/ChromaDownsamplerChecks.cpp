@@ -0,0 +1,94 @@
+#include "ChromaDownsampler.hpp"
+#include "Check.hpp"
+#include "WebMSupportCppChecks.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+namespace {
+struct FrameDeleter {
+  void operator()(AVFrame *frame) const { av_frame_free(&frame); }
+};
+using FramePtr = std::unique_ptr<AVFrame, FrameDeleter>;
+
+FramePtr make_frame(int format, int width, int height) {
+  FramePtr frame(av_frame_alloc());
+  if (!frame)
+    return nullptr;
+  frame->format = format;
+  frame->width = width;
+  frame->height = height;
+  if (av_frame_get_buffer(frame.get(), 0) < 0)
+    return nullptr;
+  return frame;
+}
+} // namespace
+
+// 8-bit 4:4:4 chroma goes through downsample_444_row: the kernel for the
+// inner columns, a clamped [1 2 1] for the first and last. Rows are paired
+// (row 2k + 1 repeats row 2k) so every tap sum is even and the 1-bit dither
+// cannot change the result; each output is exactly left + 2 * centre + right.
+static const char *check_444(int width, int height, int threads) {
+  std::unique_ptr<ChromaDownsampler> cd(ChromaDownsampler::create(
+      AV_PIX_FMT_YUV444P, AVCOL_SPC_BT709, AVCOL_RANGE_MPEG, AVCOL_PRI_BT709,
+      threads));
+  CHECK(cd);
+  FramePtr src = make_frame(AV_PIX_FMT_YUV444P, width, height);
+  FramePtr dst = make_frame(AV_PIX_FMT_YUV420P10LE, width, height);
+  CHECK(src && dst);
+
+  std::mt19937 rng((uint32_t)(width * 131 + height));
+  for (int p = 0; p < 3; p++) {
+    for (int y = 0; y < height; y++) {
+      uint8_t *row = src->data[p] + (ptrdiff_t)y * src->linesize[p];
+      if (y & 1) {
+        std::copy_n(row - src->linesize[p], width, row);
+        continue;
+      }
+      for (int x = 0; x < width; x++)
+        row[x] = (uint8_t)rng();
+    }
+  }
+  CHECK(cd->convert(src.get(), dst.get()));
+
+  for (int y = 0; y < height; y++) {
+    const uint8_t *in = src->data[0] + (ptrdiff_t)y * src->linesize[0];
+    const uint16_t *out =
+        (const uint16_t *)(dst->data[0] + (ptrdiff_t)y * dst->linesize[0]);
+    for (int x = 0; x < width; x++)
+      CHECK_AT(out[x] == in[x] << 2, width);
+  }
+  int cw = (width + 1) / 2, ch = (height + 1) / 2;
+  for (int p = 1; p < 3; p++) {
+    for (int cy = 0; cy < ch; cy++) {
+      const uint8_t *in = src->data[p] + (ptrdiff_t)(2 * cy) * src->linesize[p];
+      const uint16_t *out =
+          (const uint16_t *)(dst->data[p] + (ptrdiff_t)cy * dst->linesize[p]);
+      for (int x = 0; x < cw; x++) {
+        int l = std::max(2 * x - 1, 0), r = std::min(2 * x + 1, width - 1);
+        CHECK_AT(out[x] == in[l] + 2 * in[2 * x] + in[r], width);
+      }
+    }
+  }
+  return nullptr;
+}
+
+const char *CppCheck_ChromaDownsampler(void) {
+  // One to three chroma columns (edges only, or edges around a one-column
+  // kernel call), odd sizes, and rows sliced over several workers.
+  const int widths[] = {1, 2, 3, 4, 5, 6, 7, 17, 18, 33, 34, 65, 130, 1921};
+  for (int width : widths) {
+    for (int height : {1, 2, 7, 16}) {
+      for (int threads : {1, 3}) {
+        if (const char *failure = check_444(width, height, threads))
+          return failure;
+      }
+    }
+  }
+  return nullptr;
+}
@@ -0,0 +1,73 @@
+#include "Check.hpp"
+#include "DecodedFrameCache.hpp"
+#include "WebMSupportCppChecks.h"
+
+extern "C" {
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+}
+
+// A GOP of pictures at the given pts, each backed by `bytes` bytes.
+static std::vector<AVFrame *> make_gop(std::initializer_list<int64_t> pts,
+                                       int bytes) {
+  std::vector<AVFrame *> frames;
+  for (int64_t p : pts) {
+    AVFrame *frame = av_frame_alloc();
+    frame->pts = p;
+    frame->buf[0] = av_buffer_alloc(bytes);
+    frames.push_back(frame);
+  }
+  return frames;
+}
+
+const char *CppCheck_DecodedFrameCache(void) {
+  DecodedFrameCache cache(3000);
+  CHECK(cache.lookup(0) == nullptr);
+  CHECK(cache.misses() == 1);
+
+  // Three GOPs of 1000 bytes fill it: [0, 10), [10, 20), [20, 30).
+  CHECK(cache.insert(0, 10, make_gop({0, 3, 6}, 1000 / 3)));
+  CHECK(cache.insert(10, 20, make_gop({10, 15}, 500)));
+  CHECK(cache.insert(20, 30, make_gop({20}, 1000)));
+  CHECK(cache.sizeBytes() == 999 + 1000 + 1000);
+
+  // Any pts inside a GOP resolves to the picture on screen at that time.
+  const AVFrame *frame = cache.lookup(4);
+  CHECK(frame && frame->pts == 3);
+  frame = cache.lookup(9);
+  CHECK(frame && frame->pts == 6);
+  frame = cache.lookup(10);
+  CHECK(frame && frame->pts == 10);
+  CHECK(cache.lookup(30) == nullptr);
+  CHECK(cache.hits() == 3 && cache.misses() == 2);
+
+  // [20, 30) is now least recently used: inserting a fourth GOP evicts it
+  // and only it.
+  CHECK(cache.insert(30, 40, make_gop({30}, 1000)));
+  CHECK(cache.lookup(25) == nullptr);
+  CHECK(cache.lookup(5) && cache.lookup(12) && cache.lookup(35));
+  CHECK(cache.sizeBytes() == 999 + 1000 + 1000);
+
+  // Re-inserting a GOP replaces it rather than counting it twice.
+  CHECK(cache.insert(30, 40, make_gop({30, 32}, 500)));
+  CHECK(cache.sizeBytes() == 999 + 1000 + 1000);
+  frame = cache.lookup(33);
+  CHECK(frame && frame->pts == 32);
+
+  // A GOP larger than the whole cache is refused without evicting anything.
+  CHECK(!cache.insert(40, 50, make_gop({40}, 4000)));
+  CHECK(!cache.insert(40, 50, {}));
+  CHECK(cache.sizeBytes() == 999 + 1000 + 1000);
+
+  // Shrinking evicts least recently used first: [0, 10) was looked up
+  // before [10, 20) and [30, 40).
+  cache.setCapacity(2000);
+  CHECK(cache.sizeBytes() == 2000);
+  CHECK(cache.lookup(5) == nullptr);
+  CHECK(cache.lookup(12) && cache.lookup(33));
+
+  cache.setCapacity(0);
+  CHECK(cache.sizeBytes() == 0);
+  CHECK(!cache.insert(0, 10, make_gop({0}, 1)));
+  return nullptr;
+}
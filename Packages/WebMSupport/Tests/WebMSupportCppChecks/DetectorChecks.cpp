@@ -0,0 +1,203 @@
+#include "Check.hpp"
+#include "CropDetect.hpp"
+#include "DuplicateDetector.hpp"
+#include "WebMSupportCppChecks.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+// Planar 4:2:0 picture with `T` samples (uint8_t or uint16_t).
+template <typename T> struct Picture {
+  int width, height;
+  std::vector<T> planes[3];
+
+  Picture(int w, int h) : width(w), height(h) {
+    planes[0].resize((size_t)w * h);
+    planes[1].resize((size_t)((w + 1) / 2) * ((h + 1) / 2));
+    planes[2].resize(planes[1].size());
+  }
+  int stride(int p) const {
+    return (p ? (width + 1) / 2 : width) * (int)sizeof(T);
+  }
+  void fill(T luma, T chroma) {
+    std::fill(planes[0].begin(), planes[0].end(), luma);
+    std::fill(planes[1].begin(), planes[1].end(), chroma);
+    std::fill(planes[2].begin(), planes[2].end(), chroma);
+  }
+  // Noise in [lo, hi] over the luma rectangle [x0, x1) x [y0, y1), and
+  // colourful chroma under it.
+  void content(int x0, int y0, int x1, int y1, int lo, int hi, uint32_t seed) {
+    std::mt19937 rng(seed);
+    for (int y = y0; y < y1; y++) {
+      for (int x = x0; x < x1; x++) {
+        planes[0][(size_t)y * width + x] = (T)(lo + rng() % (hi - lo + 1));
+        size_t c = (size_t)(y / 2) * ((width + 1) / 2) + x / 2;
+        planes[1][c] = (T)(planes[0][(size_t)y * width + x] / 2);
+        planes[2][c] = (T)(hi - planes[1][c]);
+      }
+    }
+  }
+  // Without chroma the bars are judged on luma alone.
+  void add_to(CropDetector &detector, bool chroma = true) const {
+    const uint8_t *data[3] = {
+        (const uint8_t *)planes[0].data(),
+        chroma ? (const uint8_t *)planes[1].data() : nullptr,
+        chroma ? (const uint8_t *)planes[2].data() : nullptr};
+    const int strides[3] = {stride(0), stride(1), stride(2)};
+    detector.addFrame(data, strides);
+  }
+};
+} // namespace
+
+const char *CppCheck_CropDetector(void) {
+  CropRect rect;
+
+  // 2.39:1 letterboxed in 1920x1080, 8-bit limited range: 138 black rows
+  // above and below. Bars are judged per frame and unioned.
+  {
+    CropDetector detector(1920, 1080, 8, 1, 1, false);
+    Picture<uint8_t> frame(1920, 1080);
+    frame.fill(16, 128);
+    frame.content(0, 138, 1920, 942, 40, 235, 1);
+    frame.add_to(detector);
+    CHECK(!detector.result(&rect)); // One frame is not enough
+    frame.content(0, 138, 1920, 942, 20, 200, 2);
+    frame.add_to(detector);
+    CHECK(detector.result(&rect));
+    CHECK(rect.x == 0 && rect.width == 1920);
+    CHECK(rect.y == 138 && rect.height == 804);
+
+    // A fade to black says nothing about the bars.
+    frame.fill(16, 128);
+    frame.add_to(detector);
+    CHECK(detector.framesUsed() == 2);
+  }
+
+  // Pillarbox with odd bar widths, judged on luma: rounded outward onto the
+  // chroma grid so no content column is cut.
+  {
+    CropDetector detector(1920, 1080, 8, 1, 1, false);
+    Picture<uint8_t> frame(1920, 1080);
+    for (uint32_t seed = 3; seed < 5; seed++) {
+      frame.fill(16, 128);
+      frame.content(241, 0, 1677, 1080, 30, 220, seed);
+      frame.add_to(detector, false);
+    }
+    CHECK(detector.result(&rect));
+    CHECK(rect.x == 240 && rect.x + rect.width == 1678);
+    CHECK(rect.y == 0 && rect.height == 1080);
+  }
+
+  // Dark but coloured edges (a night sky) are content, not bars.
+  {
+    CropDetector detector(640, 480, 8, 1, 1, false);
+    Picture<uint8_t> frame(640, 480);
+    for (uint32_t seed = 5; seed < 7; seed++) {
+      frame.fill(16, 160);
+      frame.content(0, 60, 640, 420, 40, 235, seed);
+      frame.add_to(detector);
+    }
+    CHECK(!detector.result(&rect));
+  }
+
+  // Bars within 1% of the size are edge noise.
+  {
+    CropDetector detector(1920, 1080, 8, 1, 1, false);
+    Picture<uint8_t> frame(1920, 1080);
+    for (uint32_t seed = 7; seed < 9; seed++) {
+      frame.fill(16, 128);
+      frame.content(0, 4, 1920, 1076, 40, 235, seed);
+      frame.add_to(detector);
+    }
+    CHECK(!detector.result(&rect));
+  }
+
+  // 10-bit full range, luma only.
+  {
+    CropDetector detector(1280, 720, 10, 1, 1, true);
+    Picture<uint16_t> frame(1280, 720);
+    for (uint32_t seed = 9; seed < 11; seed++) {
+      frame.fill(0, 512);
+      frame.content(0, 90, 1280, 630, 200, 1000, seed);
+      frame.add_to(detector, false);
+    }
+    CHECK(detector.result(&rect));
+    CHECK(rect.y == 90 && rect.height == 540 && rect.width == 1280);
+  }
+  return nullptr;
+}
+
+const char *CppCheck_DuplicateDetector(void) {
+  const int width = 1000, height = 1080; // Last block is partial
+  std::mt19937 rng(11);
+  std::vector<uint8_t> ref((size_t)width * height);
+  for (uint8_t &v : ref)
+    v = (uint8_t)(16 + rng() % 200);
+
+  DuplicateDetector detector(width, height, 8);
+  CHECK(!detector.hasReference());
+  CHECK(!detector.matchesReference(ref.data(), width));
+  detector.setReference(ref.data(), width);
+  CHECK(detector.hasReference());
+  CHECK(detector.matchesReference(ref.data(), width));
+
+  // Encoder noise: every sample one code value off still matches.
+  std::vector<uint8_t> frame(ref);
+  for (size_t i = 0; i < frame.size(); i++)
+    frame[i] = (uint8_t)(ref[i] + (i & 1 ? 1 : -1));
+  CHECK(detector.matchesReference(frame.data(), width));
+
+  // A small object moving inside one block does not average away.
+  frame = ref;
+  for (int y = 500; y < 524; y++) {
+    for (int x = 300; x < 316; x++)
+      frame[(size_t)y * width + x] ^= 0x80;
+  }
+  CHECK(!detector.matchesReference(frame.data(), width));
+
+  // Nor does one in the partial block at the right edge.
+  frame = ref;
+  for (int y = 500; y < 524; y++) {
+    for (int x = 990; x < 1000; x++)
+      frame[(size_t)y * width + x] ^= 0x80;
+  }
+  CHECK(!detector.matchesReference(frame.data(), width));
+
+  // A slow fade: each step is within the limit of the previous frame, but
+  // the drift from the kept reference is not.
+  frame = ref;
+  int steps = 0;
+  do {
+    for (uint8_t &v : frame)
+      v = (uint8_t)(v - 1);
+    steps++;
+  } while (detector.matchesReference(frame.data(), width) && steps < 10);
+  CHECK(steps == 2);
+
+  // 10-bit words in a padded stride; the limit scales with the depth.
+  const int stride = 2 * width + 64;
+  std::vector<uint8_t> wide((size_t)stride * height);
+  for (int y = 0; y < height; y++) {
+    uint16_t *row = (uint16_t *)(wide.data() + (size_t)y * stride);
+    for (int x = 0; x < width; x++)
+      row[x] = (uint16_t)(64 + rng() % 800);
+  }
+  DuplicateDetector deep(width, height, 10);
+  deep.setReference(wide.data(), stride);
+  std::vector<uint8_t> moved(wide);
+  for (int y = 0; y < height; y++) {
+    uint16_t *row = (uint16_t *)(moved.data() + (size_t)y * stride);
+    for (int x = 0; x < width; x++)
+      row[x] = (uint16_t)(row[x] + 3);
+  }
+  CHECK(deep.matchesReference(moved.data(), stride));
+  for (int y = 0; y < height; y++) {
+    uint16_t *row = (uint16_t *)(moved.data() + (size_t)y * stride);
+    for (int x = 0; x < width; x++)
+      row[x] = (uint16_t)(row[x] + 3);
+  }
+  CHECK(!deep.matchesReference(moved.data(), stride));
+  return nullptr;
+}
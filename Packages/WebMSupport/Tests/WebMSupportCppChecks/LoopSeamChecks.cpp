@@ -0,0 +1,78 @@
+#include "Check.hpp"
+#include "LoopSeam.hpp"
+#include "WebMSupportCppChecks.h"
+
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/mem.h>
+}
+
+// Appends a NAL unit of the given type with a `length_size`-byte length
+// prefix and a few payload bytes.
+static void add_nal(std::vector<uint8_t> &au, int type, int length_size,
+                    int payload = 6) {
+  uint32_t length = 2 + payload;
+  for (int i = length_size - 1; i >= 0; i--)
+    au.push_back((uint8_t)(length >> (8 * i)));
+  au.push_back((uint8_t)(type << 1)); // forbidden_zero_bit, nuh_layer_id 0
+  au.push_back(1);                    // nuh_temporal_id_plus1
+  for (int i = 0; i < payload; i++)
+    au.push_back(0xA5);
+}
+
+static SeamPicture classify(std::initializer_list<int> types,
+                            int length_size = 4) {
+  std::vector<uint8_t> au;
+  for (int type : types)
+    add_nal(au, type, length_size);
+  return hevc_seam_picture(au.data(), (int)au.size(), length_size);
+}
+
+const char *CppCheck_HevcSeamPicture(void) {
+  // Parameter sets and SEI ahead of the first slice are skipped.
+  CHECK(classify({35, 32, 33, 34, 39, 19}) == SeamPicture::Idr); // IDR_W_RADL
+  CHECK(classify({20}) == SeamPicture::Idr);                     // IDR_N_LP
+  CHECK(classify({35, 39, 21}) == SeamPicture::Cra);
+  CHECK(classify({8}) == SeamPicture::Rasl);
+  CHECK(classify({9, 9}) == SeamPicture::Rasl);
+  CHECK(classify({1}) == SeamPicture::Other);  // TRAIL_R
+  CHECK(classify({7}) == SeamPicture::Other);  // RADL_R
+  CHECK(classify({16}) == SeamPicture::Other); // BLA_W_LP
+  // Only the first slice counts.
+  CHECK(classify({1, 19}) == SeamPicture::Other);
+  CHECK(classify({39}) == SeamPicture::Other);
+  CHECK(classify({}) == SeamPicture::Other);
+
+  // Other length prefix sizes.
+  CHECK(classify({32, 19}, 2) == SeamPicture::Idr);
+  CHECK(classify({39, 21}, 1) == SeamPicture::Cra);
+
+  // A truncated or corrupt unit stops the scan rather than reading past it.
+  std::vector<uint8_t> au;
+  add_nal(au, 39, 4);
+  add_nal(au, 19, 4);
+  CHECK(hevc_seam_picture(au.data(), (int)au.size() - 1, 4) ==
+        SeamPicture::Other);
+  au[3] = 0xFF; // SEI length past the end
+  CHECK(hevc_seam_picture(au.data(), (int)au.size(), 4) ==
+        SeamPicture::Other);
+  au[3] = 1; // Shorter than a NAL header
+  CHECK(hevc_seam_picture(au.data(), (int)au.size(), 4) ==
+        SeamPicture::Other);
+
+  // The prefix size comes from hvcC, and defaults to 4 without one.
+  AVCodecParameters *par = avcodec_parameters_alloc();
+  CHECK(par);
+  CHECK(hevc_nal_length_size(par) == 4);
+  par->extradata = (uint8_t *)av_mallocz(23 + AV_INPUT_BUFFER_PADDING_SIZE);
+  CHECK(par->extradata);
+  par->extradata_size = 23;
+  par->extradata[0] = 1;         // configurationVersion
+  par->extradata[21] = 0xFC | 1; // lengthSizeMinusOne = 1
+  int length_size = hevc_nal_length_size(par);
+  avcodec_parameters_free(&par);
+  CHECK(length_size == 2);
+  return nullptr;
+}
@@ -0,0 +1,225 @@
+#include "Check.hpp"
+#include "PixelKernels.hpp"
+#include "WebMSupportCppChecks.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// Widths around every vector length the kernels use (8, 16 and 32 samples)
+// plus a few full rows, each also started 1 to 3 samples past an aligned
+// address so the loads are unaligned and the scalar tails run.
+static const int kWidths[] = {0,  1,  2,  3,  5,  7,  8,   9,   15,   16,
+                              17, 23, 31, 32, 33, 63, 64,  65,  100,  127,
+                              129, 255, 257, 1000, 1921, 3840};
+static const int kMaxWidth = 3840 + 8;
+
+template <typename T> static std::vector<T> noise(int bits, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::vector<T> v(kMaxWidth);
+  for (T &x : v)
+    x = (T)(rng() & ((1u << bits) - 1));
+  return v;
+}
+
+static void noise_dither(uint16_t dither[8], int shift, uint32_t seed) {
+  std::mt19937 rng(seed);
+  for (int i = 0; i < 8; i++)
+    dither[i] = shift > 0 ? (uint16_t)(rng() % (1u << shift)) : 0;
+}
+
+template <typename T>
+static const char *check_sums(int bits, uint32_t seed) {
+  std::vector<T> a = noise<T>(bits, seed), b = noise<T>(bits, seed + 1);
+  T value = (T)((1u << bits) / 3);
+  for (int n : kWidths) {
+    for (int off = 0; off < 4; off++) {
+      const T *pa = a.data() + off, *pb = b.data() + off;
+      uint64_t sad_c = 0, sad = 0, sse = 0, ssim[5] = {0, 0, 0, 0, 0};
+      for (int i = 0; i < n; i++) {
+        sad_c += (uint64_t)std::abs((int64_t)pa[i] - value);
+        int64_t d = (int64_t)pa[i] - pb[i];
+        sad += (uint64_t)std::abs(d);
+        sse += (uint64_t)(d * d);
+        ssim[0] += pa[i];
+        ssim[1] += pb[i];
+        ssim[2] += (uint64_t)pa[i] * pa[i];
+        ssim[3] += (uint64_t)pb[i] * pb[i];
+        ssim[4] += (uint64_t)pa[i] * pb[i];
+      }
+      uint64_t sums[5];
+      if (sizeof(T) == 1) {
+        const uint8_t *a8 = (const uint8_t *)pa, *b8 = (const uint8_t *)pb;
+        CHECK_AT(pk_sad_const_u8(a8, n, (uint8_t)value) == sad_c, n);
+        CHECK_AT(pk_sad_u8(a8, b8, n) == sad, n);
+        CHECK_AT(pk_sse_u8(a8, b8, n) == sse, n);
+        pk_ssim_sums_u8(a8, b8, n, sums);
+      } else {
+        const uint16_t *a16 = (const uint16_t *)pa, *b16 = (const uint16_t *)pb;
+        CHECK_AT(pk_sad_const_u16(a16, n, (uint16_t)value) == sad_c, n);
+        CHECK_AT(pk_sad_u16(a16, b16, n) == sad, n);
+        CHECK_AT(pk_sse_u16(a16, b16, n) == sse, n);
+        pk_ssim_sums_u16(a16, b16, n, sums);
+      }
+      for (int k = 0; k < 5; k++)
+        CHECK_AT(sums[k] == ssim[k], n);
+    }
+  }
+  return nullptr;
+}
+
+template <typename T>
+static const char *check_blend_and_columns(int bits, uint32_t seed) {
+  std::vector<T> a = noise<T>(bits, seed), b = noise<T>(bits, seed + 1);
+  T value = (T)((1u << bits) / 5);
+  for (int weight : {0, 1, 77, 128, 255, 256}) {
+    for (int n : kWidths) {
+      int off = n & 3;
+      std::vector<T> dst(a.begin(), a.end());
+      if (sizeof(T) == 1)
+        pk_blend_u8((uint8_t *)dst.data() + off, (const uint8_t *)a.data() + off,
+                    (const uint8_t *)b.data() + off, n, weight);
+      else
+        pk_blend_u16((uint16_t *)dst.data() + off,
+                     (const uint16_t *)a.data() + off,
+                     (const uint16_t *)b.data() + off, n, weight);
+      for (int i = 0; i < n; i++) {
+        uint32_t want =
+            (a[off + i] * (256u - weight) + b[off + i] * (uint32_t)weight +
+             128) >>
+            8;
+        CHECK_AT(dst[off + i] == want, n);
+      }
+      // In place, as blend_frame_into uses it.
+      dst.assign(a.begin(), a.end());
+      if (sizeof(T) == 1)
+        pk_blend_u8((uint8_t *)dst.data() + off, (const uint8_t *)dst.data() + off,
+                    (const uint8_t *)b.data() + off, n, weight);
+      else
+        pk_blend_u16((uint16_t *)dst.data() + off,
+                     (const uint16_t *)dst.data() + off,
+                     (const uint16_t *)b.data() + off, n, weight);
+      for (int i = 0; i < n; i++) {
+        uint32_t want =
+            (a[off + i] * (256u - weight) + b[off + i] * (uint32_t)weight +
+             128) >>
+            8;
+        CHECK_AT(dst[off + i] == want, n);
+      }
+    }
+  }
+
+  for (int n : kWidths) {
+    int off = n & 3;
+    std::vector<uint32_t> acc(kMaxWidth), want(kMaxWidth);
+    for (int i = 0; i < kMaxWidth; i++)
+      acc[i] = want[i] = (uint32_t)i * 1000;
+    for (int row = 0; row < 3; row++) {
+      const T *src = (row & 1 ? b.data() : a.data()) + off;
+      if (sizeof(T) == 1)
+        pk_accumulate_absdiff_u8(acc.data(), (const uint8_t *)src, n,
+                                 (uint8_t)value);
+      else
+        pk_accumulate_absdiff_u16(acc.data(), (const uint16_t *)src, n,
+                                  (uint16_t)value);
+      for (int i = 0; i < n; i++)
+        want[i] += (uint32_t)std::abs((int)src[i] - (int)value);
+    }
+    CHECK_AT(acc == want, n);
+  }
+  return nullptr;
+}
+
+// The 10-bit 4:2:0 conversions, for source samples of `bits` bits.
+static const char *check_conversions(int bits, uint32_t seed) {
+  std::vector<uint8_t> a8 = noise<uint8_t>(8, seed);
+  std::vector<uint8_t> b8 = noise<uint8_t>(8, seed + 1);
+  std::vector<uint16_t> a16 = noise<uint16_t>(bits, seed + 2);
+  std::vector<uint16_t> b16 = noise<uint16_t>(bits, seed + 3);
+  std::vector<uint16_t> dst(kMaxWidth), want(kMaxWidth);
+  const uint16_t max = 1023;
+  uint16_t dither[8];
+
+  for (int n : kWidths) {
+    int off = n & 3;
+    pk_widen_u8(dst.data(), a8.data() + off, n, 2);
+    for (int i = 0; i < n; i++)
+      CHECK_AT(dst[i] == a8[off + i] << 2, n);
+
+    int shift = bits - 10;
+    noise_dither(dither, shift, seed + n);
+    pk_narrow_u16(dst.data(), a16.data() + off, n, shift, dither, max);
+    for (int i = 0; i < n; i++) {
+      uint32_t v = (a16[off + i] + dither[i & 7]) >> shift;
+      CHECK_AT(dst[i] == std::min<uint32_t>(v, max), n);
+    }
+
+    // 4:2:2: two vertical taps.
+    pk_chroma_422_to_420_u8(dst.data(), a8.data() + off, b8.data() + off, n);
+    for (int i = 0; i < n; i++)
+      CHECK_AT(dst[i] == (a8[off + i] + b8[off + i]) << 1, n);
+    shift = bits - 9;
+    noise_dither(dither, shift, seed + 2 * n);
+    pk_chroma_422_to_420_u16(dst.data(), a16.data() + off, b16.data() + off, n,
+                             shift, dither, max);
+    for (int i = 0; i < n; i++) {
+      uint32_t v = (a16[off + i] + b16[off + i] + dither[i & 7]) >> shift;
+      CHECK_AT(dst[i] == std::min<uint32_t>(v, max), n);
+    }
+
+    // 4:4:4: [1 2 1] around column 2i of both rows, which reads one sample
+    // before the row start (kept in bounds by starting at column 1 + off).
+    if (2 * n + 5 > kMaxWidth)
+      continue;
+    const uint8_t *r0 = a8.data() + 1 + off, *r1 = b8.data() + 1 + off;
+    noise_dither(dither, 1, seed + 3 * n);
+    pk_chroma_444_to_420_u8(dst.data(), r0, r1, n, 1, dither, max);
+    for (int i = 0; i < n; i++) {
+      int c = 2 * i;
+      uint32_t sum = r0[c - 1] + 2 * r0[c] + r0[c + 1] + r1[c - 1] +
+                     2 * r1[c] + r1[c + 1];
+      want[i] = (uint16_t)std::min<uint32_t>((sum + dither[i & 7]) >> 1, max);
+    }
+    CHECK_AT(std::equal(dst.begin(), dst.begin() + n, want.begin()), n);
+
+    const uint16_t *s0 = a16.data() + 1 + off, *s1 = b16.data() + 1 + off;
+    shift = bits - 7;
+    noise_dither(dither, shift, seed + 4 * n);
+    pk_chroma_444_to_420_u16(dst.data(), s0, s1, n, shift, dither, max);
+    for (int i = 0; i < n; i++) {
+      int c = 2 * i;
+      uint32_t sum = s0[c - 1] + 2 * s0[c] + s0[c + 1] + s1[c - 1] +
+                     2 * s1[c] + s1[c + 1];
+      want[i] =
+          (uint16_t)std::min<uint32_t>((sum + dither[i & 7]) >> shift, max);
+    }
+    CHECK_AT(std::equal(dst.begin(), dst.begin() + n, want.begin()), n);
+  }
+
+  // Clamping: full-scale samples with the largest dither overshoot 1023.
+  std::vector<uint16_t> white(kMaxWidth, (uint16_t)((1u << bits) - 1));
+  int shift = bits - 10;
+  for (int i = 0; i < 8; i++)
+    dither[i] = (uint16_t)((1u << shift) - 1);
+  for (int n : kWidths) {
+    pk_narrow_u16(dst.data(), white.data() + 1, n, shift, dither, max);
+    for (int i = 0; i < n; i++)
+      CHECK_AT(dst[i] == max, n);
+  }
+  return nullptr;
+}
+
+const char *CppCheck_PixelKernels(void) {
+  const char *failure;
+  if ((failure = check_sums<uint8_t>(8, 1)) ||
+      (failure = check_sums<uint16_t>(10, 2)) ||
+      (failure = check_sums<uint16_t>(16, 3)) ||
+      (failure = check_blend_and_columns<uint8_t>(8, 4)) ||
+      (failure = check_blend_and_columns<uint16_t>(10, 5)) ||
+      (failure = check_blend_and_columns<uint16_t>(16, 6)) ||
+      (failure = check_conversions(12, 7)) ||
+      (failure = check_conversions(10, 8)))
+    return failure;
+  return nullptr;
+}
@@ -0,0 +1,89 @@
+#include "Check.hpp"
+#include "SharedFrameRing.hpp"
+#include "WebMSupportCppChecks.h"
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// A one-plane 64x4 gray picture filled with `value`.
+static SharedFrameRing::Frame gray_frame(std::vector<uint8_t> &pixels,
+                                         uint8_t value) {
+  pixels.assign(64 * 4, value);
+  SharedFrameRing::Frame frame = {};
+  frame.width = 64;
+  frame.height = 4;
+  frame.format = 8; // AV_PIX_FMT_GRAY8
+  frame.planeCount = 1;
+  frame.planes[0] = pixels.data();
+  frame.strides[0] = 64;
+  frame.rows[0] = 4;
+  frame.timestampNs = value;
+  return frame;
+}
+
+static bool holds(const SharedFrameRing::Frame &frame, uint8_t value) {
+  for (int y = 0; y < frame.rows[0]; y++) {
+    const uint8_t *row = frame.planes[0] + (size_t)y * frame.strides[0];
+    for (int x = 0; x < frame.width; x++) {
+      if (row[x] != value)
+        return false;
+    }
+  }
+  return true;
+}
+
+const char *CppCheck_SharedFrameRing(void) {
+  std::unique_ptr<SharedFrameRing> producer(
+      SharedFrameRing::create(nullptr, 3, 64 * 4));
+  CHECK(producer);
+  // The consumer maps the region separately, as the app does with the
+  // descriptor the helper sends.
+  std::unique_ptr<SharedFrameRing> consumer(
+      SharedFrameRing::attach(producer->fd()));
+  CHECK(consumer);
+  CHECK(consumer->slotCount() == 3);
+
+  SharedFrameRing::Frame held;
+  CHECK(!consumer->acquireLatest(&held)); // Nothing published yet
+
+  std::vector<uint8_t> pixels;
+  for (uint8_t i = 0; i < 3; i++)
+    CHECK_AT(producer->publish(gray_frame(pixels, i)), i);
+
+  // The consumer skips to the newest frame, which reads back intact.
+  CHECK(consumer->acquireLatest(&held));
+  CHECK(held.frameNumber == 2 && held.timestampNs == 2);
+  CHECK(held.width == 64 && held.height == 4 && held.planeCount == 1);
+  CHECK(holds(held, 2));
+
+  // Frames 3 and 4 go to the other slots; frame 5 would overwrite the held
+  // one and is dropped instead, as is every retry until the release.
+  CHECK(producer->publish(gray_frame(pixels, 3)));
+  CHECK(producer->publish(gray_frame(pixels, 4)));
+  CHECK(!producer->publish(gray_frame(pixels, 5)));
+  CHECK(!producer->publish(gray_frame(pixels, 5)));
+  CHECK(producer->droppedFrames() == 2);
+  CHECK(producer->publishedFrames() == 5);
+  CHECK(holds(held, 2));
+  CHECK(consumer->release(held));
+
+  CHECK(producer->publish(gray_frame(pixels, 5)));
+  CHECK(consumer->acquireLatest(&held));
+  CHECK(held.frameNumber == 5 && holds(held, 5));
+  CHECK(consumer->release(held));
+  CHECK(!consumer->acquireLatest(&held)); // Already consumed
+
+  // A frame too big for a slot is dropped up front.
+  std::vector<uint8_t> big(64 * 4096, 9);
+  SharedFrameRing::Frame oversized = gray_frame(pixels, 9);
+  oversized.planes[0] = big.data();
+  oversized.rows[0] = 4096;
+  CHECK(!producer->publish(oversized));
+  CHECK(producer->droppedFrames() == 3);
+
+  CHECK(!consumer->isClosed());
+  producer->close();
+  CHECK(consumer->isClosed());
+  return nullptr;
+}
@@ -0,0 +1,31 @@
+#ifndef WEBM_SUPPORT_CPP_CHECKS_H
+#define WEBM_SUPPORT_CPP_CHECKS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Checks of the WebMSupportCpp helpers that need no media files, run by the
+// Swift test target. Each stops at its first failed check and returns a
+// description of it ("file:line: expression"), or NULL if all passed. The
+// string stays valid until the next check runs on the same thread.
+
+// SIMD kernels against a scalar reference, over odd widths and unaligned
+// starts.
+const char *CppCheck_PixelKernels(void);
+// 4:4:4 to 4:2:0 through ChromaDownsampler, including the edge columns.
+const char *CppCheck_ChromaDownsampler(void);
+const char *CppCheck_PlaybackLimits(void);
+const char *CppCheck_BitrateMeter(void);
+const char *CppCheck_MemoryBudget(void);
+const char *CppCheck_DecodedFrameCache(void);
+const char *CppCheck_CropDetector(void);
+const char *CppCheck_DuplicateDetector(void);
+const char *CppCheck_SharedFrameRing(void);
+const char *CppCheck_HevcSeamPicture(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
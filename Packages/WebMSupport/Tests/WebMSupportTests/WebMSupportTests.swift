@@ -1,6 +1,36 @@
 import Testing
 @testable import WebMSupport
+import WebMSupportCppChecks
 
-@Test func example() async throws {
-    // Write your test here and use APIs like `#expect(...)` to check expected conditions.
+/// Runs one of the C++ checks and records its first failure, if any.
+private func expectPasses(_ check: () -> UnsafePointer<CChar>?) {
+    if let failure = check() {
+        Issue.record("\(String(cString: failure))")
+    }
+}
+
+@Suite("Pixel kernels")
+struct PixelKernelTests {
+    @Test func simdMatchesScalar() { expectPasses(CppCheck_PixelKernels) }
+    @Test func chromaDownsamplerEdges() { expectPasses(CppCheck_ChromaDownsampler) }
+}
+
+@Suite("Playback and memory budgets")
+struct BudgetTests {
+    @Test func playbackLimits() { expectPasses(CppCheck_PlaybackLimits) }
+    @Test func bitrateMeter() { expectPasses(CppCheck_BitrateMeter) }
+    @Test func memoryBudget() { expectPasses(CppCheck_MemoryBudget) }
+}
+
+@Suite("Frame analysis")
+struct FrameAnalysisTests {
+    @Test func decodedFrameCache() { expectPasses(CppCheck_DecodedFrameCache) }
+    @Test func cropDetector() { expectPasses(CppCheck_CropDetector) }
+    @Test func duplicateDetector() { expectPasses(CppCheck_DuplicateDetector) }
+    @Test func hevcSeamPicture() { expectPasses(CppCheck_HevcSeamPicture) }
+}
+
+@Suite("Shared frame ring")
+struct SharedFrameRingTests {
+    @Test func fenceProtocol() { expectPasses(CppCheck_SharedFrameRing) }
 }